@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "simpledb/buffer_pool_manager.h"
+#include "simpledb/disk_manager.h"
+
+// Buffer pool hit throughput: every thread fetches and unpins resident pages
+// in a loop. Reports millions of hits per second for growing thread counts,
+// with one shard and with one shard per thread. Then times a cold
+// sequential scan with and without read-ahead, after asking the kernel to
+// drop the file from its page cache. Finally measures random-fetch latency
+// over a large resident pool with base pages and with huge pages; the pool
+// size in pages is the second argument.
+int main(int argc, char** argv) {
+  namespace fs = std::filesystem;
+  using namespace simpledb;
+
+  const size_t max_threads =
+      argc > 1 ? std::strtoul(argv[1], nullptr, 10)
+               : std::max(1U, std::thread::hardware_concurrency());
+  const size_t large_pool =
+      argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 65536;
+  constexpr size_t kPages = 1024;
+  constexpr size_t kHitsPerThread = 200000;
+
+  const fs::path path = fs::temp_directory_path() / "simpledb_buffer_pool_bench.db";
+  fs::remove(path);
+  DiskManager disk_manager;
+  if (!disk_manager.Open(path).ok()) {
+    std::cerr << "failed to open " << path << "\n";
+    return 1;
+  }
+  for (size_t i = 0; i < kPages; ++i) {
+    disk_manager.AllocatePage();
+  }
+
+  for (const bool sharded : {false, true}) {
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+      BufferPoolOptions options;
+      options.num_shards = sharded ? std::max<size_t>(threads, 16) : 1;
+      BufferPoolManager pool(kPages * 2, &disk_manager, options);
+      for (PageId id = 0; id < kPages; ++id) {
+        pool.FetchPage(id);
+        pool.UnpinPage(id, false);
+      }
+
+      const auto start = std::chrono::steady_clock::now();
+      std::vector<std::thread> workers;
+      for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&pool, t] {
+          PageId id = t * 97;
+          for (size_t i = 0; i < kHitsPerThread; ++i) {
+            id = (id * 31 + 7) % kPages;
+            pool.FetchPage(id);
+            pool.UnpinPage(id, false);
+          }
+        });
+      }
+      for (auto& worker : workers) {
+        worker.join();
+      }
+      const std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+
+      std::cout << "shards=" << pool.num_shards() << " threads=" << threads
+                << " Mhits/s="
+                << static_cast<double>(threads * kHitsPerThread) /
+                       elapsed.count() / 1e6
+                << "\n";
+    }
+  }
+
+  constexpr size_t kScanPages = 16384;
+  while (disk_manager.page_count() < kScanPages) {
+    disk_manager.AllocatePage();
+  }
+  for (const size_t read_ahead : {size_t{0}, size_t{32}}) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+      ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+      ::close(fd);
+    }
+
+    BufferPoolOptions options;
+    options.read_ahead_pages = read_ahead;
+    BufferPoolManager pool(kPages, &disk_manager, options);
+    const auto start = std::chrono::steady_clock::now();
+    for (PageId id = 0; id < kScanPages; ++id) {
+      pool.FetchPage(id);
+      pool.UnpinPage(id, false);
+    }
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    std::cout << "scan read_ahead=" << read_ahead << " MB/s="
+              << static_cast<double>(kScanPages * kPageSize) / elapsed.count() /
+                     1e6
+              << "\n";
+  }
+
+  while (disk_manager.page_count() < large_pool) {
+    disk_manager.AllocatePage();
+  }
+  for (const bool huge_pages : {false, true}) {
+    BufferPoolOptions options;
+    options.huge_pages = huge_pages;
+    options.page_cleaner = false;
+    options.read_ahead_pages = 0;
+    const auto build_start = std::chrono::steady_clock::now();
+    BufferPoolManager pool(large_pool, &disk_manager, options);
+    const std::chrono::duration<double> build =
+        std::chrono::steady_clock::now() - build_start;
+    if (!pool.Prefetch(0, large_pool).ok()) {
+      std::cerr << "prefetch failed\n";
+      return 1;
+    }
+
+    // Each fetch touches one byte of its page, so the page's memory and
+    // not only the frame metadata is reached.
+    constexpr size_t kFetches = 2000000;
+    size_t id = 1;
+    unsigned checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kFetches; ++i) {
+      id = (id * 6364136223846793005ULL + 1442695040888963407ULL);
+      const PageId page_id = (id >> 33) % large_pool;
+      auto res = pool.FetchPage(page_id);
+      checksum += static_cast<unsigned>(res.value()->data[(id >> 20) %
+                                                          kPageSize]);
+      pool.UnpinPage(page_id, false);
+    }
+    const std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    const char* backing = "base";
+    if (pool.memory_backing() == ArenaBacking::kHugeTlb) {
+      backing = "hugetlb";
+    } else if (pool.memory_backing() == ArenaBacking::kTransparentHugePages) {
+      backing = "thp";
+    }
+    std::cout << "random fetch pages=" << large_pool << " memory=" << backing
+              << " build_ms=" << build.count() * 1e3
+              << " ns/fetch=" << elapsed.count() / kFetches
+              << (checksum == 1 ? " " : "") << "\n";
+  }
+
+  fs::remove(path);
+  return 0;
+}
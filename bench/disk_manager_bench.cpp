@@ -0,0 +1,123 @@
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "simpledb/buffer_pool_manager.h"
+#include "simpledb/crc32c.h"
+#include "simpledb/disk_manager.h"
+#include "simpledb/page.h"
+
+// Random page reads over a file that fits in the page cache, per DiskManager
+// backend: ReadPage into a caller buffer, then FetchPage through a pool
+// holding a quarter of the file, and for kMmap also FetchPageView, which
+// skips the copy into a frame. Reports thousands of pages per second. First,
+// the cost of the page checksum every read verifies, in nanoseconds per
+// page, with the dispatched CRC-32C and with the portable one.
+int main(int argc, char** argv) {
+  namespace fs = std::filesystem;
+  using namespace simpledb;
+
+  const size_t pages = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 16384;
+  constexpr size_t kReads = 200000;
+
+  const fs::path path =
+      fs::temp_directory_path() / "simpledb_disk_manager_bench.db";
+  fs::remove(path);
+  {
+    DiskManager writer;
+    if (!writer.Open(path).ok() || !writer.AllocatePages(pages).ok()) {
+      std::cerr << "failed to create " << path << "\n";
+      return 1;
+    }
+    std::vector<char> image(kPageSize, 'x');
+    for (PageId id = 0; id < pages; ++id) {
+      writer.WritePage(id, image.data());
+    }
+  }
+
+  {
+    PageImage image;
+    image.bytes.fill(std::byte{'x'});
+    SealPage(image.bytes);
+    constexpr size_t kVerifies = 1000000;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kVerifies; ++i) {
+      if (!VerifyPage(image.bytes).ok()) {
+        return 1;
+      }
+    }
+    std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << "VerifyPage hardware=" << Crc32cHardwareAccelerated()
+              << " ns/page=" << elapsed.count() / kVerifies << "\n";
+
+    volatile std::uint32_t checksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kVerifies; ++i) {
+      checksum = Crc32cPortable(image.bytes.data(), kPageSize);
+    }
+    elapsed = std::chrono::steady_clock::now() - start;
+    if (checksum != Crc32c(image.bytes.data(), kPageSize)) {
+      std::cerr << "Crc32cPortable disagrees with Crc32c\n";
+      return 1;
+    }
+    std::cout << "Crc32cPortable ns/page=" << elapsed.count() / kVerifies
+              << "\n";
+  }
+
+  std::vector<PageId> order(kReads);
+  std::mt19937_64 rng(42);
+  for (auto& id : order) {
+    id = rng() % pages;
+  }
+
+  auto report = [](const char* backend, const char* path_name,
+                   std::chrono::steady_clock::time_point start) {
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << backend << " " << path_name
+              << " Kpages/s=" << kReads / elapsed.count() / 1e3 << "\n";
+  };
+
+  for (const auto backend : {IoBackend::kPositional, IoBackend::kMmap}) {
+    const char* name = backend == IoBackend::kMmap ? "mmap" : "pread";
+    DiskManagerOptions options;
+    options.backend = backend;
+    options.mmap_advice = MmapAdvice::kRandom;
+    DiskManager disk_manager;
+    if (!disk_manager.Open(path, options).ok()) {
+      std::cerr << "failed to open " << path << "\n";
+      return 1;
+    }
+
+    std::vector<char> buffer(kPageSize);
+    auto start = std::chrono::steady_clock::now();
+    for (const PageId id : order) {
+      disk_manager.ReadPage(id, buffer.data());
+    }
+    report(name, "ReadPage", start);
+
+    BufferPoolManager pool(pages / 4, &disk_manager);
+    start = std::chrono::steady_clock::now();
+    for (const PageId id : order) {
+      pool.FetchPage(id);
+      pool.UnpinPage(id, false);
+    }
+    report(name, "FetchPage", start);
+
+    if (backend == IoBackend::kMmap) {
+      BufferPoolManager view_pool(pages / 4, &disk_manager);
+      start = std::chrono::steady_clock::now();
+      for (const PageId id : order) {
+        auto view = view_pool.FetchPageView(id);
+      }
+      report(name, "FetchPageView", start);
+    }
+  }
+
+  fs::remove(path);
+  return 0;
+}
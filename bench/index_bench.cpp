@@ -0,0 +1,113 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "simpledb/b_plus_tree.h"
+#include "simpledb/buffer_pool_manager.h"
+#include "simpledb/disk_manager.h"
+#include "simpledb/extendible_hash_index.h"
+
+// Random point lookups of keys that are present, through a B+ tree built by
+// BulkLoad and through an extendible hash index, each on its own file and a
+// pool large enough to hold it. Reports thousands of lookups per second,
+// and the tree's height; a hash lookup always fetches two pages.
+int main(int argc, char** argv) {
+  namespace fs = std::filesystem;
+  using namespace simpledb;
+
+  const size_t keys = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+  constexpr size_t kLookups = 500000;
+  constexpr size_t kPoolPages = 16384;
+
+  // Zero-padded, so that string order is numeric order for BulkLoad.
+  std::vector<std::string> names(keys);
+  for (size_t n = 0; n < keys; ++n) {
+    // The prefix, up to 20 digits and the terminator.
+    char digits[sizeof("customer:") + 20];
+    std::snprintf(digits, sizeof(digits), "customer:%012zu", n);
+    names[n] = digits;
+  }
+  auto bytes = [](const std::string& s) {
+    return std::span<const std::byte>(
+        reinterpret_cast<const std::byte*>(s.data()), s.size());
+  };
+  std::vector<size_t> order(kLookups);
+  std::mt19937_64 rng(42);
+  for (auto& n : order) {
+    n = rng() % keys;
+  }
+
+  auto report = [](const char* index,
+                   std::chrono::steady_clock::time_point start) {
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << index << " Klookups/s=" << kLookups / elapsed.count() / 1e3
+              << "\n";
+  };
+
+  const fs::path path = fs::temp_directory_path() / "simpledb_index_bench.db";
+  {
+    fs::remove(path);
+    DiskManager disk_manager;
+    if (!disk_manager.Open(path).ok()) {
+      std::cerr << "failed to open " << path << "\n";
+      return 1;
+    }
+    BufferPoolManager pool(kPoolPages, &disk_manager);
+    BPlusTree tree(&pool);
+    std::vector<BPlusTree::Entry> entries;
+    entries.reserve(keys);
+    for (size_t n = 0; n < keys; ++n) {
+      entries.push_back({bytes(names[n]), RecordId{n, 0}});
+    }
+    if (!tree.Create().ok() || !tree.BulkLoad(entries).ok()) {
+      std::cerr << "failed to build the b+ tree\n";
+      return 1;
+    }
+    std::cout << "b+tree height=" << tree.height().value() << "\n";
+    const auto start = std::chrono::steady_clock::now();
+    for (const size_t n : order) {
+      if (!tree.Get(bytes(names[n])).ok()) {
+        return 1;
+      }
+    }
+    report("b+tree", start);
+  }
+
+  {
+    fs::remove(path);
+    DiskManager disk_manager;
+    if (!disk_manager.Open(path).ok()) {
+      std::cerr << "failed to open " << path << "\n";
+      return 1;
+    }
+    BufferPoolManager pool(kPoolPages, &disk_manager);
+    ExtendibleHashIndex index(&pool);
+    if (!index.Create().ok()) {
+      std::cerr << "failed to create the hash index\n";
+      return 1;
+    }
+    for (size_t n = 0; n < keys; ++n) {
+      if (!index.Insert(bytes(names[n]), RecordId{n, 0}).ok()) {
+        std::cerr << "failed to fill the hash index\n";
+        return 1;
+      }
+    }
+    std::cout << "hash global_depth=" << index.global_depth() << "\n";
+    const auto start = std::chrono::steady_clock::now();
+    for (const size_t n : order) {
+      if (!index.Get(bytes(names[n])).ok()) {
+        return 1;
+      }
+    }
+    report("hash", start);
+  }
+
+  fs::remove(path);
+  return 0;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "simpledb/buffer_pool_manager.h"
+#include "simpledb/page.h"
+#include "simpledb/page_guard.h"
+#include "simpledb/status.h"
+#include "simpledb/table_heap.h"
+
+namespace simpledb {
+
+// A B+ tree index from variable-length byte-string keys, compared like
+// memcmp with shorter prefixes first, to RecordIds. Keys are unique. Every
+// node is a buffer pool page in a slotted layout: a directory of key
+// offsets kept in key order, growing up from the node header, and the key
+// bytes with their values growing down from the end of the page. Leaves
+// are linked left to right for range scans. A header page holds the root's
+// page id, so the tree is found again by the header's id alone.
+//
+// Safe for concurrent use. Lookups and scans crab read latches down from
+// the header page. Inserts first go down the same way and write-latch only
+// the leaf; if the leaf would have to split, they start over, crabbing
+// write latches and keeping those of the nodes a split could reach.
+// Deletes never restructure the tree: a leaf may be left underfull or
+// empty, and is reused by later inserts in its key range.
+class BPlusTree {
+ public:
+  struct Entry {
+    std::span<const std::byte> key;
+    RecordId value;
+  };
+
+  // Forward scan over the entries in key order. Holds a read guard on the
+  // current leaf only; key() is valid until the next call to Next(). A
+  // thread must let go of its iterators before it writes to the tree.
+  class Iterator {
+   public:
+    Iterator() = default;
+
+    // False once the scan has passed the last entry.
+    bool Valid() const { return guard_.valid(); }
+    std::span<const std::byte> key() const;
+    RecordId value() const;
+
+    Status Next();
+
+   private:
+    friend class BPlusTree;
+
+    Iterator(BufferPoolManager* pool, ReadPageGuard leaf, std::uint16_t index);
+    // Moves right past the end of the current leaf and any empty ones.
+    Status SkipExhausted();
+
+    BufferPoolManager* pool_{nullptr};
+    ReadPageGuard guard_;
+    std::uint16_t index_{0};
+  };
+
+  // Large enough for four entries per node, so that splits always leave
+  // each half at least one.
+  static constexpr std::size_t kMaxKeySize = 900;
+
+  explicit BPlusTree(BufferPoolManager* pool);
+
+  BPlusTree(const BPlusTree&) = delete;
+  BPlusTree& operator=(const BPlusTree&) = delete;
+
+  // Starts a new, empty tree: a header page and an empty root leaf.
+  Status Create();
+
+  // Attaches to the tree whose header page is header_page_id.
+  Status Open(PageId header_page_id);
+
+  // InvalidArgument for a key that is already present or longer than
+  // kMaxKeySize.
+  Status Insert(std::span<const std::byte> key, RecordId value);
+
+  // NotFound if the key is absent.
+  Result<RecordId> Get(std::span<const std::byte> key);
+
+  // NotFound if the key is absent.
+  Status Delete(std::span<const std::byte> key);
+
+  // Fills an empty tree from entries sorted by strictly ascending key.
+  // Leaves are written left to right, each filled to about nine tenths so
+  // that later inserts do not split them at once, and then each level of
+  // internal nodes above them. A tree whose entries were all deleted is
+  // empty too; its old nodes are freed. InvalidArgument if the tree holds
+  // an entry or the entries are out of order, with the tree unchanged.
+  Status BulkLoad(std::span<const Entry> entries);
+
+  // An iterator at the first entry, or at the first entry not less than
+  // key; invalid if there is none.
+  Result<Iterator> Begin();
+  Result<Iterator> LowerBound(std::span<const std::byte> key);
+
+  // Levels from the root to the leaves; 1 while the root is a leaf.
+  Result<std::size_t> height();
+  PageId header_page_id() const { return header_page_id_; }
+
+ private:
+  // Read-crabs from the header down to the leaf that would hold key, or to
+  // the leftmost leaf if key is empty and leftmost is set.
+  Result<ReadPageGuard> FindLeafRead(std::span<const std::byte> key,
+                                     bool leftmost);
+  // As FindLeafRead, but write-latches the leaf.
+  Result<WritePageGuard> FindLeafWrite(std::span<const std::byte> key);
+  Status InsertPessimistic(std::span<const std::byte> key, RecordId value);
+
+  BufferPoolManager* pool_;
+  PageId header_page_id_{kInvalidPageId};
+};
+
+}  // namespace simpledb
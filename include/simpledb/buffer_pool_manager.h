@@ -1,55 +1,247 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <list>
 #include <memory>
 #include <mutex>
-#include <unordered_map>
+#include <optional>
+#include <shared_mutex>
+#include <thread>
 #include <vector>
 
 #include "simpledb/disk_manager.h"
+#include "simpledb/frame_arena.h"
+#include "simpledb/log_manager.h"
 #include "simpledb/page.h"
+#include "simpledb/page_guard.h"
+#include "simpledb/page_table.h"
+#include "simpledb/replacer.h"
 
 namespace simpledb {
 
+// How the caller expects to use a fetched page.
+enum class AccessHint {
+  // Point access; the page competes for the pool like any other.
+  kNormal,
+  // Part of a forward scan: reads ahead immediately and, on a miss, loads
+  // into the calling thread's ring of frames.
+  kSequential,
+  // Touched once, in no particular order: ring frames, no read-ahead.
+  kOneShot,
+};
+
+struct BufferPoolOptions {
+  ReplacerPolicy replacer{ReplacerPolicy::kClock};
+  // History depth for ReplacerPolicy::kLruK.
+  std::size_t lru_k{2};
+  // Number of independent partitions. Each has its own latch, page table,
+  // free list and replacer, and owns an equal share of the frames; a page
+  // always lives in the shard its id hashes to.
+  std::size_t num_shards{1};
+  // Pages read in one batch once a thread is seen fetching ascending page
+  // ids. 0 disables read-ahead; Prefetch still works.
+  std::size_t read_ahead_pages{32};
+  // Frames each thread's kSequential and kOneShot misses recycle, split
+  // evenly across the shards and capped at a quarter of each shard. Pages
+  // fetched that way leave the rest of the pool, and the replacer's view of
+  // it, untouched.
+  std::size_t ring_frames{16};
+  // Background page cleaner. It wakes every cleaner_interval, or sooner when
+  // a miss had to write its victim back. A shard is cleaned when fewer than
+  // clean_low_watermark of its frames are free or clean at the eviction end
+  // of its replacer. Dirty frames found there are then written back in page
+  // id order until clean_high_watermark of the shard is clean, or
+  // cleaner_batch pages have been written.
+  bool page_cleaner{true};
+  double clean_low_watermark{0.1};
+  double clean_high_watermark{0.2};
+  std::chrono::milliseconds cleaner_interval{50};
+  std::size_t cleaner_batch{64};
+  // Back the frames with 2 MB pages, faulted in when the pool is built.
+  // Worth it for large pools under random access, where base pages cost a
+  // TLB miss on nearly every fetch. Falls back to transparent huge pages
+  // when none are reserved; memory_backing() reports what was obtained.
+  bool huge_pages{false};
+  // Write-ahead log for the pages in this pool. When set, no page is
+  // written back, by eviction, the cleaner or a flush, before the log is
+  // durable up to the LSN in the page's header. Written pages are reported
+  // back to the log's dirty page table.
+  LogManager* log_manager{nullptr};
+};
+
+// Caches disk pages in a fixed set of frames. A fetch of a resident page
+// (a hit) takes no mutex: it finds the frame through the shard's lock-free
+// page table, pins it with a CAS on the frame's pin count, and then checks
+// that the frame still holds the page. Misses, evictions and flushes take
+// the shard latch. UnpinPage is lock-free as well. Unless disabled, a
+// background thread writes back dirty pages that are close to eviction, so
+// that misses rarely find a dirty victim. The thread stops before the
+// destructor's final flush.
 class BufferPoolManager {
  public:
-  BufferPoolManager(size_t pool_size, DiskManager* disk_manager);
+  BufferPoolManager(size_t pool_size, DiskManager* disk_manager,
+                    const BufferPoolOptions& options = {});
 
   ~BufferPoolManager();
 
   BufferPoolManager(const BufferPoolManager&) = delete;
   BufferPoolManager& operator=(const BufferPoolManager&) = delete;
 
-  Result<Page*> FetchPage(PageId page_id);
+  Result<Page*> FetchPage(PageId page_id,
+                          AccessHint hint = AccessHint::kNormal);
+
+  // Fetch and pin the page, then latch its frame shared (read) or exclusive
+  // (write). The guard unpins on destruction; a write guard unpins dirty.
+  // Latches are per frame, so readers of one page never block each other.
+  Result<ReadPageGuard> FetchPageRead(PageId page_id,
+                                      AccessHint hint = AccessHint::kNormal);
+
+  Result<WritePageGuard> FetchPageWrite(PageId page_id,
+                                        AccessHint hint = AccessHint::kNormal);
+
+  Result<WritePageGuard> NewPageWrite();
+
+  // Zero-copy read. With an mmap DiskManager, a page the pool does not hold
+  // is served straight from the file mapping: no frame is used and nothing
+  // is pinned. A resident page, which may be newer than the file, comes
+  // from its frame as with FetchPageRead, as does every page with other
+  // backends. Meant for read-mostly data: a mapped view changes if the page
+  // is written back while it is held.
+  Result<PageViewGuard> FetchPageView(PageId page_id);
 
   Status UnpinPage(PageId page_id, bool is_dirty);
 
+  // Flushes copy each page out under its frame's shared latch, so the
+  // calling thread must hold no guard on a page the flush writes: this
+  // page, or for FlushAllPages any dirty page. A write guard held by the
+  // caller deadlocks the call.
   Status FlushPage(PageId page_id);
 
   Result<Page*> NewPage();
 
+  // Frees the page on disk for reuse by a later NewPage. A resident copy is
+  // dropped without being written. A page pinned by anything other than
+  // a write-back cannot be deleted; write-backs are waited for.
   Status DeletePage(PageId page_id);
 
+  // See FlushPage for the guards the caller may hold.
   Status FlushAllPages();
 
+  // Hint that pages [first, first + count) will be fetched soon. Missing
+  // pages are read into free frames, or into frames that earlier read-ahead
+  // filled and no kNormal fetch has hit since, with one vectored read per
+  // run of consecutive ids; pages the pool already holds are left alone, so
+  // the hot set is never evicted.
+  // Stops early, without error, when no such frame is left. Pages past the
+  // end of the file are ignored.
+  Status Prefetch(PageId first, size_t count);
+
+  size_t pool_size() const { return pool_size_; }
+  size_t num_shards() const { return shards_.size(); }
+  ArenaBacking memory_backing() const { return arena_.backing(); }
+
  private:
-  using frame_id_t = size_t;
+  // pin_count value of a frame that a shard-latch holder owns exclusively
+  // while it changes which page the frame holds. Optimistic pins never
+  // succeed against it.
+  static constexpr int kClaimed = -1;
 
+  // Per-frame metadata. The page bytes are the frame's slice of arena_.
   struct Frame {
+    // page.id only changes while the frame is claimed, so a reader holding
+    // a pin can read it without further synchronization.
     Page page;
-    bool is_dirty{false};
-    int pin_count{0};
+    std::atomic<bool> is_dirty{false};
+    std::atomic<int> pin_count{0};
+    // Lock-free hits since the replacer last heard of the frame, counted
+    // instead of calling into it and capped at max_replayed_hits_. The next
+    // eviction sweep to offer the frame skips it and replays them as
+    // accesses.
+    std::atomic<std::uint32_t> hits{0};
+    // Set while the page is being read from disk without the shard latch
+    // held. The frame is already in the page table; other fetchers wait for
+    // it to clear.
+    std::atomic<bool> io_in_progress{false};
+    // Pins held by WriteBack, taken under the shard latch together with
+    // the pin itself. DeletePage waits these out rather than failing.
+    std::atomic<int> write_backs{0};
+    // The page was loaded by read-ahead and has had no kNormal fetch since,
+    // making the frame fair game for later read-ahead. Set under the shard
+    // latch; cleared by the first such fetch, latched or not.
+    std::atomic<bool> prefetched{false};
+    // Protects page contents for guard holders. Never acquired while a
+    // shard latch is held.
+    std::shared_mutex latch;
   };
 
-  Result<frame_id_t> GetVictim();
+  // Frame ids inside a shard are local: frames[0, size) are the shard's
+  // slice of frames_. Resident frames are always evictable in the replacer;
+  // pinned ones are refused when it offers them.
+  struct Shard {
+    Shard(Frame* frames, size_t size, const BufferPoolOptions& options);
+
+    Frame* frames;
+    size_t size;
+    PageTable page_table;
+    std::unique_ptr<Replacer> replacer;
+    std::list<frame_id_t> free_list;
+    // Frames loaded by read-ahead, oldest first. Entries whose frame has
+    // since been reused for a demand fetch are skipped.
+    std::deque<frame_id_t> prefetched;
+    std::mutex latch;
+  };
 
+  Frame* TryPinResident(Shard& shard, PageId page_id, bool record_access);
+  Result<Frame*> FetchFrame(PageId page_id, AccessHint hint);
+  Result<Frame*> NewFrame();
+  static void PinForWriteBack(Frame& frame);
+  Status WriteBack(std::vector<Frame*> frames);
+  size_t ShardIndex(PageId page_id) const;
+  Shard& ShardFor(PageId page_id);
+  Result<frame_id_t> GetVictim(Shard& shard, bool prefetch = false);
+  Result<frame_id_t> GetRingVictim(PageId page_id);
+  Result<frame_id_t> Evacuate(Shard& shard, frame_id_t frame_id);
+  std::optional<frame_id_t> TakePrefetched(Shard& shard);
+  void Install(Shard& shard, frame_id_t frame_id, PageId page_id,
+               bool record_access = true);
+  void CompleteRead(Shard& shard, frame_id_t frame_id, PageId page_id,
+                    const Status& status);
+  Status ReadRun(PageId first, const std::vector<Frame*>& frames);
+  void MaybeReadAhead(PageId page_id, AccessHint hint);
+  void CleanerLoop();
+  Status CleanShard(Shard& shard);
+  void WakeCleaner();
+  void ResetFrame(Shard& shard, frame_id_t frame_id);
+  Status FlushLogFor(Lsn lsn);
+
+  // Unique for the life of the process; keys per-thread read-ahead state.
+  const std::uint64_t id_;
   size_t pool_size_;
+  // The accesses the replacer remembers per frame: K for LRU-K, 1 for
+  // CLOCK. Replaying more hits than that changes nothing.
+  std::uint32_t max_replayed_hits_;
+  size_t read_ahead_pages_;
+  size_t ring_frames_;
+  double clean_low_watermark_;
+  double clean_high_watermark_;
+  std::chrono::milliseconds cleaner_interval_;
+  size_t cleaner_batch_;
+  FrameArena arena_;
   std::vector<Frame> frames_;
   DiskManager* disk_manager_;
-  std::unordered_map<PageId, frame_id_t> page_table_;
-  std::list<frame_id_t> replacer_;
-  std::list<frame_id_t> free_list_;
-  std::mutex latch_;
+  LogManager* log_manager_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+
+  std::mutex cleaner_mutex_;
+  std::condition_variable cleaner_cv_;
+  bool cleaner_stop_{false};
+  bool cleaner_wake_{false};
+  // Started last, once every shard exists.
+  std::thread cleaner_;
 };
 
 }  // namespace simpledb
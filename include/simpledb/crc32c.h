@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace simpledb {
+
+// CRC-32C (Castagnoli), as used by iSCSI and ext4. `crc` is the checksum of
+// the bytes before `data`, so Crc32c(b, nb, Crc32c(a, na)) is the checksum
+// of a followed by b. Runs on the SSE4.2 crc32 instruction when the CPU has
+// it, chosen once at run time, and on lookup tables otherwise.
+std::uint32_t Crc32c(const void* data, std::size_t size,
+                     std::uint32_t crc = 0);
+
+// The table-driven implementation Crc32c falls back to.
+std::uint32_t Crc32cPortable(const void* data, std::size_t size,
+                             std::uint32_t crc = 0);
+
+// Whether Crc32c uses the crc32 instruction.
+bool Crc32cHardwareAccelerated();
+
+}  // namespace simpledb
@@ -1,14 +1,105 @@
 #ifndef SIMPLEDB_DISK_MANAGER_H
 #define SIMPLEDB_DISK_MANAGER_H
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <filesystem>
-#include <fstream>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
 
+#include "simpledb/io_uring.h"
 #include "simpledb/page.h"
 #include "simpledb/status.h"
 
 namespace simpledb {
 
+enum class IoBackend {
+  // Synchronous pread/pwrite on the calling thread.
+  kPositional,
+  // Requests go through an io_uring queue; callers block only on the future.
+  kIoUring,
+  // The file is mapped read-only; reads are a memcpy from the mapping and
+  // MappedPage() hands out pointers into it. Writes stay pwrite, which the
+  // kernel keeps coherent with the mapping.
+  kMmap,
+};
+
+// madvise hints for the kMmap mapping.
+enum class MmapAdvice {
+  kNormal,
+  kSequential,
+  kRandom,
+  // Start reading the range in now.
+  kWillNeed,
+};
+
+// What DiskManager does to make writes survive power loss.
+enum class Durability {
+  // Nothing: writes reach the kernel and Sync() returns at once. A crash
+  // may lose any write, and a checkpoint no longer vouches for pages.
+  kNone,
+  // A background thread syncs every sync_interval, bounding how much a
+  // crash can lose; Sync() is still a barrier.
+  kPeriodic,
+  // Only Sync() syncs. Concurrent callers share one fdatasync.
+  kOnSync,
+};
+
+// One page of a DiskManager::WriteBatch.
+struct PageWrite {
+  PageId id;
+  const char* data;
+};
+
+struct DiskManagerOptions {
+  IoBackend backend{IoBackend::kPositional};
+  unsigned io_queue_depth{64};
+  // The file grows, with its disk space reserved, in extents of this many
+  // pages, so allocating a page inside the last extent is just a counter
+  // bump. Close trims the unused rest of the extent; after a crash it
+  // stays, as zero-filled pages past the old end.
+  std::size_t extent_pages{256};
+  // Address space mapped for kMmap. The mapping is made once and covers the
+  // file as it grows; pages past this limit are read with pread.
+  std::size_t mmap_bytes{std::size_t{1} << 36};
+  // Applied to the whole mapping at open.
+  MmapAdvice mmap_advice{MmapAdvice::kNormal};
+  // Open the file with O_DIRECT so page I/O bypasses the kernel page cache
+  // and the buffer pool is the only cache. Ignored with kMmap; dropped if
+  // the filesystem refuses it (direct_io() reports what is in effect).
+  // Caller buffers not aligned to kPageSize are bounced through an aligned
+  // copy, so the buffer pool's arena frames are the fast path.
+  bool direct_io{false};
+  Durability durability{Durability::kOnSync};
+  // Period of the kPeriodic background sync.
+  std::chrono::milliseconds sync_interval{100};
+  // Torn-page protection. Every page write goes, together with the rest of
+  // its batch, to a sidecar double-write file, double_write_path(), which
+  // is synced before the pages are written in place; the data file is then
+  // synced before the sidecar is reused. Open restores any page whose
+  // in-place copy differs from an intact sidecar copy. Costs two syncs per
+  // batch whatever the durability policy, so write through WriteBatch.
+  bool double_write{false};
+  // Pages per double-write batch; larger batches are split.
+  std::size_t double_write_pages{64};
+  // Seal every page written with its version and CRC-32C (see PageHeader),
+  // and verify every page read, failing the read with Internal if it does
+  // not match. Pages handed out by MappedPage() are not verified.
+  bool page_checksums{true};
+};
+
+// Page-granular access to the database file. Reads and writes are positional
+// (pread/pwrite) on a single file descriptor, so any number of threads may
+// read and write distinct pages concurrently; only allocation is serialized.
+// With page_checksums, writes seal a copy of each page, never the caller's
+// buffer.
 class DiskManager {
  public:
   DiskManager() = default;
@@ -17,24 +108,168 @@ class DiskManager {
   DiskManager(const DiskManager&) = delete;
   DiskManager& operator=(const DiskManager&) = delete;
 
-  Status Open(const std::filesystem::path& path);
+  // If io_uring or mmap is requested but unavailable, falls back to
+  // kPositional; backend() reports what is in effect.
+  Status Open(const std::filesystem::path& path,
+              const DiskManagerOptions& options = {});
 
+  // Zero-filled new pages. The lowest free page is reused first; otherwise
+  // the id comes from the end of the file, which grows a whole extent at a
+  // time with fallocate, so most allocations make no system call.
   Result<PageId> AllocatePage();
 
+  // Allocates `count` consecutive pages at the end of the file and returns
+  // the first id. One call costs the same as AllocatePage.
+  Result<PageId> AllocatePages(std::size_t count);
+
+  // Returns the page to the free-page map for reuse and releases its disk
+  // blocks (punching a hole where supported), so it reads back as zeros.
+  // The map is persisted in a sidecar file of bitmap pages, free_map_path(),
+  // created on the first deallocation.
+  Status DeallocatePage(PageId id);
+
+  // Shrinks the file past any free pages at its end. Returns how many pages
+  // were released. Safe to call online: no live page moves.
+  Result<std::size_t> TruncateFreeTail();
+
   Status ReadPage(PageId id, char* data) const;
 
   Status WritePage(PageId id, const char* data);
 
-  std::size_t page_count() const { return page_count_; }
-  bool is_open() const { return file_.is_open(); }
+  // Vectored variants: transfer the consecutive pages starting at `first`
+  // into/out of `buffers` (one kPageSize buffer per page) with preadv/pwritev.
+  Status ReadPages(PageId first, std::span<char* const> buffers) const;
+
+  Status WritePages(PageId first, std::span<const char* const> buffers);
+
+  // Writes any set of pages. Runs of consecutive ids, in the order given,
+  // go out as one vectored write each; with double_write the whole batch
+  // shares one double-write round.
+  Status WriteBatch(std::span<const PageWrite> writes);
+
+  // Makes every write that completed before the call, and the file's size,
+  // durable with fdatasync on the data file and the free-page map. Callers
+  // that arrive while a sync is running wait for it and then share the next
+  // one, so a burst of callers costs at most two syncs. A no-op under
+  // Durability::kNone.
+  Status Sync();
+
+  // Asynchronous variants. With kIoUring the request is queued and the
+  // future resolves from the completion thread; with kPositional the I/O is
+  // done inline and the returned future is already ready. `data` must stay
+  // valid until the future resolves.
+  std::future<Status> ReadPageAsync(PageId id, char* data) const;
+
+  std::future<Status> WritePageAsync(PageId id, const char* data);
+
+  // With kMmap, the page's bytes inside the mapping; std::nullopt for other
+  // backends or pages out of range. The span stays valid until the file is
+  // closed or truncated below the page, and changes when the page is
+  // written.
+  std::optional<std::span<const std::byte>> MappedPage(PageId id) const;
+
+  // madvise over pages [first, first + count) of the mapping; a no-op for
+  // other backends.
+  Status Advise(PageId first, std::size_t count, MmapAdvice advice) const;
+
+  IoBackend backend() const {
+    if (mapping_ != nullptr) {
+      return IoBackend::kMmap;
+    }
+    return ring_ ? IoBackend::kIoUring : IoBackend::kPositional;
+  }
+
+  std::size_t page_count() const {
+    return page_count_.load(std::memory_order_acquire);
+  }
+  bool is_open() const { return fd_ >= 0; }
+  bool direct_io() const { return direct_io_; }
+  bool page_checksums() const { return page_checksums_; }
+  bool double_write() const { return double_write_fd_ >= 0; }
+  // Pages the last Open restored from the double-write file.
+  std::size_t repaired_pages() const { return repaired_pages_; }
+  Durability durability() const { return durability_; }
+  // fdatasync rounds run so far, by Sync() and the periodic thread.
+  std::size_t sync_count() const {
+    return sync_count_.load(std::memory_order_relaxed);
+  }
   const std::filesystem::path& path() const { return path_; }
+  std::filesystem::path free_map_path() const;
+  std::filesystem::path double_write_path() const;
 
  private:
   Status EnsureOpen() const;
+  Status CheckRange(PageId first, std::size_t count) const;
+  void Close();
+
+  Status WritePageInPlace(PageId id, const char* data);
+  Status WritePagesInPlace(PageId first, std::span<const char* const> buffers);
+  Status WriteRuns(std::span<const PageWrite> writes);
+  Status DoubleWrite(std::span<const PageWrite> writes);
+  Status RepairFromDoubleWrite(bool keep);
+  Status ForgetDoubleWrite(PageId id);
+  std::future<Status> SubmitWrite(PageId id, const char* data,
+                                  std::shared_ptr<const PageImage> owner = {});
+
+  // With page_checksums, copies data into staging, seals the copy and
+  // returns it; otherwise returns data.
+  const char* Sealed(const char* data, PageImage& staging) const;
+  Status Verify(const char* data) const;
+
+  bool NeedsBounce(const void* buffer) const;
+  Status ReadBounced(PageId id, char* data) const;
+  Status WriteBounced(PageId id, const char* data);
+
+  Status SyncFiles();
+  void SyncerLoop();
+
+  Status LoadFreeMap();
+  Status OpenFreeMap();
+  Status WriteFreeMapPages(std::size_t first_page, std::size_t end_page);
+  bool IsFree(PageId id) const;
+  std::optional<PageId> LowestFree() const;
 
   std::filesystem::path path_;
-  mutable std::fstream file_;
-  std::size_t page_count_{0};
+  int fd_{-1};
+  bool direct_io_{false};
+  bool page_checksums_{true};
+  std::atomic<std::size_t> page_count_{0};
+  // Pages the file's size covers: page_count_ rounded up to a whole extent
+  // while the file is open. Guarded by allocation_latch_.
+  std::size_t reserved_pages_{0};
+  std::size_t extent_pages_{1};
+  // One bit per page, set while the page is free, in whole bitmap pages.
+  // map_fd_ is the sidecar holding the same bits. All guarded by
+  // allocation_latch_.
+  std::vector<std::uint64_t> free_map_;
+  std::size_t free_pages_{0};
+  int map_fd_{-1};
+  std::mutex allocation_latch_;
+  std::unique_ptr<IoUring> ring_;
+  std::byte* mapping_{nullptr};
+  std::size_t mapping_bytes_{0};
+
+  // The double-write sidecar and the pages of its current batch; writes
+  // are serialized on double_write_latch_ while it is in use.
+  int double_write_fd_{-1};
+  std::size_t double_write_pages_{0};
+  std::vector<PageId> double_write_ids_;
+  std::mutex double_write_latch_;
+  std::size_t repaired_pages_{0};
+
+  Durability durability_{Durability::kOnSync};
+  std::chrono::milliseconds sync_interval_{0};
+  // Sync() coalescing: a caller needs a sync round that started after it
+  // arrived. Guarded by sync_latch_.
+  std::mutex sync_latch_;
+  std::condition_variable sync_cv_;
+  std::uint64_t syncs_started_{0};
+  std::uint64_t syncs_finished_{0};
+  bool sync_running_{false};
+  Status last_sync_;
+  bool syncer_stop_{false};
+  std::atomic<std::size_t> sync_count_{0};
+  std::thread syncer_;
 };
 
 }  // namespace simpledb
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+#include <span>
+#include <vector>
+
+#include "simpledb/buffer_pool_manager.h"
+#include "simpledb/page.h"
+#include "simpledb/page_guard.h"
+#include "simpledb/status.h"
+#include "simpledb/table_heap.h"
+
+namespace simpledb {
+
+// An extendible hash index from byte-string keys to RecordIds, for point
+// lookups. Keys are unique. The directory maps the low global_depth bits
+// of a key's hash to a bucket page, and spans as many directory pages as
+// it needs; their ids, with the global depth, live on a header page and
+// are cached here, so a lookup fetches one directory page and one bucket.
+// A bucket that overflows splits on its own, moving the entries that
+// differ in the next hash bit to a new bucket; only when it already uses
+// every directory bit does the directory double, by copying pointers.
+// Nothing is ever rehashed as a whole.
+//
+// Each bucket keeps a one-byte fingerprint per entry, from hash bits the
+// directory does not use, in an array probed sixteen at a time before any
+// key is compared.
+//
+// Safe for concurrent use. Lookups, deletes and inserts that fit share
+// the directory and latch just the bucket; splits take the directory
+// exclusively. Buckets are not merged when deletes empty them.
+class ExtendibleHashIndex {
+ public:
+  static constexpr std::size_t kMaxKeySize = 900;
+  // 2^16 buckets, on 256 directory pages.
+  static constexpr std::uint32_t kMaxGlobalDepth = 16;
+
+  explicit ExtendibleHashIndex(BufferPoolManager* pool);
+
+  ExtendibleHashIndex(const ExtendibleHashIndex&) = delete;
+  ExtendibleHashIndex& operator=(const ExtendibleHashIndex&) = delete;
+
+  // Starts a new, empty index: a header page, a directory page and one
+  // bucket.
+  Status Create();
+
+  // Attaches to the index whose header page is header_page_id.
+  Status Open(PageId header_page_id);
+
+  // InvalidArgument for a key that is already present or longer than
+  // kMaxKeySize; Internal if the key's bucket is full and cannot split
+  // past kMaxGlobalDepth.
+  Status Insert(std::span<const std::byte> key, RecordId value);
+
+  // NotFound if the key is absent.
+  Result<RecordId> Get(std::span<const std::byte> key);
+
+  // NotFound if the key is absent.
+  Status Delete(std::span<const std::byte> key);
+
+  std::uint32_t global_depth();
+  PageId header_page_id() const { return header_page_id_; }
+
+ private:
+  // Caller holds directory_latch_, shared or exclusive.
+  Result<PageId> BucketFor(std::uint32_t hash);
+  // Caller holds directory_latch_ exclusively.
+  Status SplitBucket(std::uint32_t hash, WritePageGuard& bucket);
+  Status GrowDirectory();
+  Status WriteHeader(std::uint32_t global_depth,
+                     const std::vector<PageId>& directory_pages);
+
+  BufferPoolManager* pool_;
+  PageId header_page_id_{kInvalidPageId};
+
+  // Guards the directory's shape: the global depth, the directory pages,
+  // and which buckets their entries point to.
+  std::shared_mutex directory_latch_;
+  std::uint32_t global_depth_{0};
+  std::vector<PageId> directory_pages_;
+};
+
+}  // namespace simpledb
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+
+namespace simpledb {
+
+// What the arena's memory is actually backed by.
+enum class ArenaBacking {
+  // Ordinary base pages.
+  kBasePages,
+  // Reserved huge pages (MAP_HUGETLB).
+  kHugeTlb,
+  // A 2 MB-aligned mapping marked MADV_HUGEPAGE; the kernel backs it with
+  // transparent huge pages when it can.
+  kTransparentHugePages,
+};
+
+// The buffer pool's page memory: one contiguous, page-aligned allocation
+// with the frames' pages back to back. Frame metadata lives elsewhere, so
+// every page buffer is suitable for direct I/O and the pool's footprint is
+// exactly pages * kPageSize. Memory starts out zeroed.
+//
+// With huge_pages set, the arena asks for 2 MB pages so that random access
+// across a large pool does not miss the TLB on every page: MAP_HUGETLB if
+// the system has enough reserved, otherwise transparent huge pages. Either
+// way the memory is faulted in up front rather than on first use.
+class FrameArena {
+ public:
+  static constexpr std::size_t kHugePageSize = std::size_t{2} << 20;
+
+  explicit FrameArena(std::size_t pages, bool huge_pages = false);
+  ~FrameArena();
+
+  FrameArena(const FrameArena&) = delete;
+  FrameArena& operator=(const FrameArena&) = delete;
+
+  std::span<std::byte> page(std::size_t index) const;
+
+  std::size_t pages() const { return pages_; }
+  ArenaBacking backing() const { return backing_; }
+
+ private:
+  void Prefault();
+
+  std::byte* memory_{nullptr};
+  std::size_t pages_{0};
+  // Bytes mapped at mapping_, which may start before and extend past the
+  // pages themselves.
+  void* mapping_{nullptr};
+  std::size_t mapping_bytes_{0};
+  ArenaBacking backing_{ArenaBacking::kBasePages};
+};
+
+}  // namespace simpledb
@@ -0,0 +1,80 @@
+#ifndef SIMPLEDB_IO_URING_H
+#define SIMPLEDB_IO_URING_H
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <semaphore>
+#include <thread>
+
+#include "simpledb/status.h"
+
+struct io_uring_sqe;
+
+namespace simpledb {
+
+// Minimal io_uring queue driven through the raw syscalls. Reads and writes are
+// submitted from any thread; a reaper thread drains the completion ring,
+// resubmits short transfers, and invokes each request's completion callback.
+// At most `queue_depth` requests are in flight; further submitters block.
+class IoUring {
+ public:
+  using Completion = std::function<void(Status)>;
+
+  static Result<std::unique_ptr<IoUring>> Create(unsigned queue_depth);
+
+  ~IoUring();
+
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+
+  Status SubmitRead(int fd, char* data, std::size_t size, off_t offset,
+                    Completion done);
+
+  Status SubmitWrite(int fd, const char* data, std::size_t size, off_t offset,
+                     Completion done);
+
+ private:
+  struct Request;
+
+  IoUring(int ring_fd, unsigned queue_depth);
+
+  Status Map();
+  Status Submit(Request* request);
+  Status Enqueue(std::uint8_t opcode, int fd, std::uint64_t addr,
+                 std::size_t len, off_t offset, std::uint64_t user_data);
+  void Reap();
+  void Complete(Request* request, int result);
+
+  int ring_fd_;
+
+  void* sq_ring_{nullptr};
+  std::size_t sq_ring_size_{0};
+  void* cq_ring_{nullptr};
+  std::size_t cq_ring_size_{0};
+  io_uring_sqe* sqes_{nullptr};
+  std::size_t sqes_size_{0};
+
+  unsigned* sq_tail_{nullptr};
+  unsigned sq_mask_{0};
+  unsigned* sq_array_{nullptr};
+  unsigned* cq_head_{nullptr};
+  unsigned* cq_tail_{nullptr};
+  unsigned cq_mask_{0};
+  void* cqes_{nullptr};
+
+  std::mutex submit_latch_;
+  std::counting_semaphore<> slots_;
+  std::atomic<std::size_t> in_flight_{0};
+  std::atomic<bool> stopping_{false};
+  std::thread reaper_;
+};
+
+}  // namespace simpledb
+
+#endif  // SIMPLEDB_IO_URING_H
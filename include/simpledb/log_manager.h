@@ -0,0 +1,207 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "simpledb/page.h"
+#include "simpledb/status.h"
+
+namespace simpledb {
+
+class DiskManager;
+
+enum class LogRecordType : std::uint8_t {
+  // Redo information: `data` is the new contents of bytes
+  // [offset, offset + data.size()) of page_id.
+  kUpdate = 1,
+  // txn_id's changes are durable once this record is.
+  kCommit = 2,
+  // A fuzzy checkpoint is these records in this order, possibly with other
+  // records between them: a begin, the dirty page table and the active
+  // transactions (each split over as many records as needed), and an end
+  // whose data is the log position the begin record starts at.
+  kCheckpointBegin = 3,
+  kCheckpointDirtyPages = 4,
+  kCheckpointTxns = 5,
+  kCheckpointEnd = 6,
+};
+
+struct LogRecord {
+  LogRecordType type{LogRecordType::kUpdate};
+  // Assigned by Append; filled in by ReadLog.
+  Lsn lsn{kInvalidLsn};
+  std::uint64_t txn_id{0};
+  PageId page_id{kInvalidPageId};
+  std::uint16_t offset{0};
+  std::vector<std::byte> data;
+};
+
+struct DirtyPageEntry {
+  PageId page_id;
+  // Log position the page's oldest unwritten change starts at.
+  Lsn rec_lsn;
+};
+
+// What a completed checkpoint recorded.
+struct CheckpointRecord {
+  // Log position the checkpoint's begin record starts at. Every change
+  // logged before it was on disk when the checkpoint completed, except
+  // changes to the pages in dirty_pages.
+  Lsn begin_lsn{kInvalidLsn};
+  // Pages with logged changes that had not been written back when the
+  // checkpoint began.
+  std::vector<DirtyPageEntry> dirty_pages;
+  // Transactions with logged updates and no commit record yet.
+  std::vector<std::uint64_t> active_txns;
+};
+
+struct LogManagerOptions {
+  // Appends go to an in-memory buffer of this size. An append that does not
+  // fit waits for the buffer to be written out first.
+  std::size_t buffer_bytes{std::size_t{1} << 20};
+  // Group commit. Once a committer is waiting, the log writer holds the
+  // fdatasync back for up to group_commit_delay so that more commits share
+  // it, or until group_commit_batch committers are waiting. Zero delay
+  // syncs at once. Flushes for page write-back never wait.
+  std::chrono::microseconds group_commit_delay{100};
+  std::size_t group_commit_batch{32};
+};
+
+// Write-ahead log in a single append-only file. Records are buffered in
+// memory and made durable by one writer thread, which writes everything
+// appended so far with a single pwrite and fdatasync, so concurrent
+// committers share a sync. Pages changed through Update carry the LSN of
+// their last record; a buffer pool given this log calls Flush with that LSN
+// before it writes the page, which keeps the log ahead of the data file.
+//
+// The log also keeps the dirty page table: for each page with logged
+// changes that have not been written back, where its oldest such change
+// starts. The buffer pool reports page writes through NotePageWritten,
+// and deleted pages through NotePageFreed.
+// Checkpoint records that table without flushing any page, and a master
+// record next to the log, master_path(), points to the latest checkpoint.
+class LogManager {
+ public:
+  LogManager() = default;
+  ~LogManager();
+
+  LogManager(const LogManager&) = delete;
+  LogManager& operator=(const LogManager&) = delete;
+
+  // Opens or creates the log. A torn record at the end of an existing log,
+  // left by a crash mid-write, is cut off.
+  Status Open(const std::filesystem::path& path,
+              const LogManagerOptions& options = {});
+
+  // Buffers the record and returns its LSN. Not durable until a Flush or
+  // Commit covers the LSN.
+  Result<Lsn> Append(const LogRecord& record);
+
+  // Copies `bytes` into the page at `offset`, logs them as a kUpdate record
+  // and stamps the page with the record's LSN. The caller holds the page's
+  // write latch. The page header itself cannot be updated this way.
+  Result<Lsn> Update(std::uint64_t txn_id, Page& page, std::size_t offset,
+                     std::span<const std::byte> bytes);
+
+  // Logs txn_id's commit and waits until it is durable.
+  Result<Lsn> Commit(std::uint64_t txn_id);
+
+  // Waits until every record up to `lsn` is durable. LSNs past the end of
+  // the log are clamped to it.
+  Status Flush(Lsn lsn);
+
+  // Tells the log that the image of `page_id` stamped with `lsn` has been
+  // written to the data file.
+  void NotePageWritten(PageId page_id, Lsn lsn);
+
+  // Tells the log that `page_id` was freed; its unwritten changes died
+  // with it and no longer hold back where recovery starts.
+  void NotePageFreed(PageId page_id);
+
+  // Fuzzy checkpoint: logs the dirty page table and the active
+  // transactions as of now, while appends carry on, syncs data_file so that
+  // pages already dropped from the table are durable, and then makes the
+  // checkpoint the one master_path() points to. Returns its begin_lsn.
+  // Run recovery before the first checkpoint after a crash; the table
+  // starts out empty.
+  Result<Lsn> Checkpoint(DiskManager& data_file);
+
+  // The checkpoint the master record points to; NotFound if there is none.
+  Result<CheckpointRecord> LastCheckpoint() const;
+
+  // Visits, in order, the durable records with an LSN greater than `from`,
+  // until `fn` returns false. kInvalidLsn starts at the beginning.
+  Status ReadLog(Lsn from,
+                 const std::function<bool(const LogRecord&)>& fn) const;
+
+  // LSN the next record will end past; everything before it is appended.
+  Lsn end_lsn() const;
+  Lsn flushed_lsn() const {
+    return flushed_lsn_.load(std::memory_order_acquire);
+  }
+  // fdatasync calls made so far.
+  std::size_t sync_count() const {
+    return sync_count_.load(std::memory_order_relaxed);
+  }
+  bool is_open() const { return fd_ >= 0; }
+  const std::filesystem::path& path() const { return path_; }
+  std::filesystem::path master_path() const;
+
+ private:
+  void Close();
+  Status TrimTornTail();
+  Result<Lsn> AppendLocked(std::unique_lock<std::mutex>& lock,
+                           const LogRecord& record);
+  Status WriteMaster(Lsn begin_lsn);
+  void WriterLoop();
+  void RequestFlush(Lsn lsn, bool urgent);
+  Status WaitFlushed(std::unique_lock<std::mutex>& lock, Lsn lsn);
+
+  std::filesystem::path path_;
+  int fd_{-1};
+  std::size_t buffer_bytes_{0};
+  std::chrono::microseconds group_commit_delay_{0};
+  std::size_t group_commit_batch_{1};
+
+  // Everything below is guarded by latch_. buffer_ holds the bytes of
+  // [buffer_lsn_, end_lsn_), not yet handed to the writer.
+  mutable std::mutex latch_;
+  std::condition_variable writer_cv_;
+  std::condition_variable flushed_cv_;
+  std::vector<std::byte> buffer_;
+  Lsn buffer_lsn_{kInvalidLsn};
+  Lsn end_lsn_{kInvalidLsn};
+  // Highest LSN somebody is waiting on; the writer runs while it is ahead
+  // of flushed_lsn_.
+  Lsn flush_target_{kInvalidLsn};
+  bool urgent_{false};
+  std::size_t waiting_commits_{0};
+  // The first write or sync failure. The log accepts nothing after it.
+  Status error_;
+  bool stop_{false};
+
+  struct DirtyPage {
+    // Where the oldest unwritten change starts, and where the newest ends.
+    Lsn rec_lsn;
+    Lsn last_lsn;
+  };
+  std::unordered_map<PageId, DirtyPage> dirty_pages_;
+  std::unordered_set<std::uint64_t> active_txns_;
+
+  std::atomic<Lsn> flushed_lsn_{kInvalidLsn};
+  std::atomic<std::size_t> sync_count_{0};
+  std::thread writer_;
+};
+
+}  // namespace simpledb
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "simpledb/buffer_pool_manager.h"
+#include "simpledb/page.h"
+#include "simpledb/status.h"
+
+namespace simpledb {
+
+// Where the bytes of a value too large for its page went: a chain of
+// overflow pages, each linked to the next. A layout such as TableHeap
+// keeps the reference in place of the value.
+struct OverflowRef {
+  std::uint64_t size{0};
+  PageId first_page_id{kInvalidPageId};
+  std::uint32_t page_count{0};
+  // Whether the chain is the run of page_count consecutive ids from
+  // first_page_id, as it is unless reused free pages broke it up.
+  std::uint32_t contiguous{0};
+};
+
+// Value bytes each overflow page holds after its headers.
+extern const std::size_t kOverflowPageCapacity;
+
+// Overflow pages ReadOverflow asks the pool to prefetch at a time.
+inline constexpr std::size_t kOverflowPrefetchPages = 32;
+
+// Writes data to new pages from BufferPoolManager::NewPageWrite, which
+// reuses the lowest free pages first and otherwise extends the file, so
+// chains are mostly contiguous. On failure the pages are freed again.
+Result<OverflowRef> WriteOverflow(BufferPoolManager* pool,
+                                  std::span<const std::byte> data);
+
+// Copies the value into out, which must hold ref.size bytes, straight
+// from each page's frame as the chain is followed. A contiguous chain is
+// prefetched kOverflowPrefetchPages at a time, each batch with one
+// vectored read. Internal if a page is not the one the chain expects.
+Status ReadOverflow(BufferPoolManager* pool, const OverflowRef& ref,
+                    std::span<std::byte> out);
+
+// Frees every page of the chain it can, carrying on past pages that fail
+// to be deleted; returns the first failure. What is left, as chains this
+// can be called on again, is appended to *left_over if given.
+Status FreeOverflow(BufferPoolManager* pool, const OverflowRef& ref,
+                    std::vector<OverflowRef>* left_over = nullptr);
+
+}  // namespace simpledb
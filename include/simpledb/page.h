@@ -4,6 +4,9 @@
 #include <cstddef>
 #include <cstdint>
 #include <limits>
+#include <span>
+
+#include "simpledb/status.h"
 
 namespace simpledb {
 
@@ -12,11 +15,78 @@ using PageId = std::uint64_t;
 inline constexpr PageId kInvalidPageId = std::numeric_limits<PageId>::max();
 inline constexpr std::size_t kPageSize = 4096;
 
-struct alignas(std::max_align_t) Page {
+// Log sequence number: the log's size in bytes just past a record, so LSNs
+// grow with every append and "durable up to lsn" is a byte count.
+using Lsn = std::uint64_t;
+
+inline constexpr Lsn kInvalidLsn = 0;
+
+// What a page holds, for the layout that formats it.
+enum class PageType : std::uint8_t {
+  // Never formatted by a page layout; raw bytes after the header.
+  kRaw = 0,
+  kSlotted = 1,
+  kBPlusTreeHeader = 2,
+  kBPlusTreeLeaf = 3,
+  kBPlusTreeInternal = 4,
+  kHashIndexHeader = 5,
+  kHashDirectory = 6,
+  kHashBucket = 7,
+  kOverflow = 8,
+};
+
+// Version of the header layout below, stamped by SealPage. A page that
+// has never been written has version 0 and is all zeros.
+inline constexpr std::uint16_t kPageFormatVersion = 1;
+
+// Every page starts with this header; page layouts such as SlottedPage
+// begin after it. The checksum and version belong to the disk manager,
+// which seals each page as it writes it and verifies it as it reads it;
+// raw users of Page may ignore the rest, but then must not mix their pages
+// with a LogManager.
+struct PageHeader {
+  // CRC-32C of the page past this field.
+  std::uint32_t checksum;
+  std::uint16_t version;
+  PageType type;
+  std::uint8_t reserved;
+  // LSN of the last logged change to the page. The buffer pool flushes the
+  // log up to here before writing the page.
+  Lsn lsn;
+};
+
+inline constexpr std::size_t kPageHeaderSize = sizeof(PageHeader);
+static_assert(kPageHeaderSize == 16);
+
+// A page id and a view of the page's kPageSize bytes. Page does not own the
+// bytes: in the buffer pool they live in the frame arena, elsewhere in a
+// PageImage or any other caller buffer.
+struct Page {
   PageId id{kInvalidPageId};
-  std::array<std::byte, kPageSize> data{};
+  std::span<std::byte> data;
+};
+
+// Page-sized storage for a page image outside the buffer pool, aligned so
+// that it can be handed to direct I/O.
+struct alignas(kPageSize) PageImage {
+  std::array<std::byte, kPageSize> bytes{};
 };
 
 void ClearPage(Page& page);
 
+Lsn PageLsn(std::span<const std::byte> page);
+
+void SetPageLsn(std::span<std::byte> page, Lsn lsn);
+
+PageType PageTypeOf(std::span<const std::byte> page);
+
+void SetPageType(std::span<std::byte> page, PageType type);
+
+// Stamps the page with kPageFormatVersion and its checksum.
+void SealPage(std::span<std::byte> page);
+
+// Checks a page image read from disk: it must be sealed and intact, or all
+// zeros. Internal on a checksum mismatch or an unknown version.
+Status VerifyPage(std::span<const std::byte> page);
+
 }  // namespace simpledb
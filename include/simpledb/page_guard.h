@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <shared_mutex>
+#include <span>
+
+#include "simpledb/page.h"
+
+namespace simpledb {
+
+class BufferPoolManager;
+
+// Pins a page and holds its frame latch shared for the guard's lifetime.
+// Destroying (or Release()-ing) the guard drops the latch and then the pin.
+class ReadPageGuard {
+ public:
+  ReadPageGuard() = default;
+  ReadPageGuard(BufferPoolManager* bpm, Page* page, std::shared_mutex* latch);
+  ~ReadPageGuard();
+
+  ReadPageGuard(ReadPageGuard&& other) noexcept;
+  ReadPageGuard& operator=(ReadPageGuard&& other) noexcept;
+  ReadPageGuard(const ReadPageGuard&) = delete;
+  ReadPageGuard& operator=(const ReadPageGuard&) = delete;
+
+  void Release();
+
+  bool valid() const { return page_ != nullptr; }
+  PageId page_id() const { return page_->id; }
+  const Page& page() const { return *page_; }
+  std::span<const std::byte> data() const { return page_->data; }
+
+ private:
+  BufferPoolManager* bpm_{nullptr};
+  Page* page_{nullptr};
+  std::shared_mutex* latch_{nullptr};
+};
+
+// Pins a page and holds its frame latch exclusively. Releasing the guard
+// unpins the page as dirty.
+class WritePageGuard {
+ public:
+  WritePageGuard() = default;
+  WritePageGuard(BufferPoolManager* bpm, Page* page, std::shared_mutex* latch);
+  ~WritePageGuard();
+
+  WritePageGuard(WritePageGuard&& other) noexcept;
+  WritePageGuard& operator=(WritePageGuard&& other) noexcept;
+  WritePageGuard(const WritePageGuard&) = delete;
+  WritePageGuard& operator=(const WritePageGuard&) = delete;
+
+  void Release();
+
+  bool valid() const { return page_ != nullptr; }
+  PageId page_id() const { return page_->id; }
+  Page& page() { return *page_; }
+  const Page& page() const { return *page_; }
+  std::span<std::byte> data() { return page_->data; }
+
+ private:
+  BufferPoolManager* bpm_{nullptr};
+  Page* page_{nullptr};
+  std::shared_mutex* latch_{nullptr};
+};
+
+// Read-only view of a page from BufferPoolManager::FetchPageView. Either
+// wraps a ReadPageGuard on a pool frame, or points straight into the
+// DiskManager's file mapping without pinning anything.
+class PageViewGuard {
+ public:
+  PageViewGuard() = default;
+  explicit PageViewGuard(ReadPageGuard guard);
+  PageViewGuard(PageId page_id, std::span<const std::byte> mapped);
+
+  PageViewGuard(PageViewGuard&& other) noexcept;
+  PageViewGuard& operator=(PageViewGuard&& other) noexcept;
+  PageViewGuard(const PageViewGuard&) = delete;
+  PageViewGuard& operator=(const PageViewGuard&) = delete;
+
+  void Release();
+
+  bool valid() const { return page_id_ != kInvalidPageId; }
+  // True when the bytes are the mapping's rather than a frame's.
+  bool mapped() const { return valid() && !guard_.valid(); }
+  PageId page_id() const { return page_id_; }
+  std::span<const std::byte> data() const { return data_; }
+
+ private:
+  ReadPageGuard guard_;
+  PageId page_id_{kInvalidPageId};
+  std::span<const std::byte> data_;
+};
+
+}  // namespace simpledb
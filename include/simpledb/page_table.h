@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+#include "simpledb/page.h"
+#include "simpledb/replacer.h"
+
+namespace simpledb {
+
+// Fixed-capacity open-addressing map from page id to frame id with lock-free
+// lookups. Insert and Erase must be serialized by the caller (the buffer pool
+// shard latch); Find may run concurrently with them. A concurrent Find can
+// miss an entry that is being moved, so callers treat a miss as "take the
+// latch and look again". A hit is only trustworthy for a page the caller has
+// pinned, or after validating the frame it points to.
+class PageTable {
+ public:
+  // Sized so that `max_entries` live pages keep the load factor at or below
+  // one half.
+  explicit PageTable(std::size_t max_entries);
+
+  std::optional<frame_id_t> Find(PageId page_id) const;
+
+  // `page_id` must not already be present. False, with nothing inserted,
+  // if every slot is taken, which cannot happen while the table holds no
+  // more than `max_entries`.
+  bool Insert(PageId page_id, frame_id_t frame_id);
+
+  bool Erase(PageId page_id);
+
+  std::size_t size() const { return size_; }
+
+  // Caller holds the writer latch.
+  template <typename Fn>
+  void ForEach(Fn&& fn) const {
+    for (std::size_t i = 0; i < capacity_; ++i) {
+      const PageId key = slots_[i].key.load(std::memory_order_relaxed);
+      if (key != kEmpty && key != kTombstone) {
+        fn(key, slots_[i].frame.load(std::memory_order_relaxed));
+      }
+    }
+  }
+
+ private:
+  static constexpr PageId kEmpty = kInvalidPageId;
+  static constexpr PageId kTombstone = kInvalidPageId - 1;
+
+  struct Slot {
+    std::atomic<PageId> key{kEmpty};
+    std::atomic<frame_id_t> frame{0};
+  };
+
+  std::size_t Home(PageId page_id) const;
+  void Rebuild();
+
+  std::size_t capacity_;
+  std::size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  std::size_t size_{0};
+  std::size_t tombstones_{0};
+};
+
+}  // namespace simpledb
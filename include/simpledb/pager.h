@@ -18,9 +18,11 @@ class Pager {
 
   Status Open(const std::filesystem::path& path);
 
-  Result<Page> Allocate();
+  // Appends a zeroed page and returns its id.
+  Result<PageId> Allocate();
 
-  Result<Page> Load(PageId id) const;
+  // Reads page.id into page.data.
+  Status Load(Page& page) const;
 
   Status Flush(const Page& page);
 
@@ -11,37 +11,126 @@ namespace simpledb {
 
 struct RecordView {
   std::span<const std::byte> data;
+  // Set for a record stored with SlottedPage's overflow flag: the bytes
+  // in the page only refer to the record, which lives elsewhere.
+  bool overflow{false};
 };
 
-class SlottedPage {
+// Slotted page layout, after the PageHeader: a small header, record bytes
+// growing up from it, and the slot directory growing down from the end of
+// the page. A slot id names a record for as long as it lives; deleting it
+// leaves a tombstone slot that a later insert reuses. The bytes of deleted
+// and shrunk records stay where they are, counted as fragmented space,
+// until the page is compacted.
+//
+// Read-only access to a slotted page, e.g. through a ReadPageGuard, or over
+// any page image such as a PageViewGuard's.
+class SlottedPageView {
  public:
-  explicit SlottedPage(Page& page);
-
-  Result<std::uint16_t> Insert(std::span<const std::byte> record);
+  explicit SlottedPageView(const Page& page);
+  explicit SlottedPageView(std::span<const std::byte> data);
 
+  // NotFound for ids past the directory and for deleted records.
   Result<RecordView> Get(std::uint16_t slot_id) const;
 
+  // Whether slot_id holds a record rather than a tombstone.
+  bool IsLive(std::uint16_t slot_id) const;
+
+  // Slots in the directory, tombstones included.
   std::uint16_t slot_count() const;
 
+  // The largest record an insert can take, counting fragmented space.
   std::size_t free_space() const;
 
- private:
+  // Bytes of deleted and shrunk records not yet reclaimed by compaction.
+  std::size_t fragmented_space() const;
+
+  // Link to the next page of a chain of slotted pages, such as a
+  // TableHeap's; kInvalidPageId at the end.
+  PageId next_page_id() const;
+
+  // The largest record an empty page can take.
+  static const std::size_t kMaxRecordSize;
+
+ protected:
   struct Header {
     std::uint16_t free_start;
     std::uint16_t slot_count;
+    // Tombstones in the directory.
+    std::uint16_t free_slots;
+    std::uint16_t fragmented_bytes;
+    PageId next_page_id;
   };
 
   struct Slot {
+    // kTombstone for a deleted record; record bytes never start there.
     std::uint16_t offset;
+    // The record's size, with kOverflowFlag or-ed in for overflow records.
     std::uint16_t size;
   };
 
-  Header& header();
+  static constexpr std::uint16_t kTombstone = 0;
+  static constexpr std::uint16_t kOverflowFlag = 0x8000;
+
+  static std::size_t SizeOf(const Slot& slot) {
+    return slot.size & ~kOverflowFlag;
+  }
+
   const Header& header() const;
-  Slot* slot_ptr(std::uint16_t index);
   const Slot* slot_ptr(std::uint16_t index) const;
+  // Bytes between the records and the slot directory.
+  std::size_t contiguous_space() const;
+
+  std::span<const std::byte> data_;
+};
+
+class SlottedPage : public SlottedPageView {
+ public:
+  // Formats the page if it is still all zeros.
+  explicit SlottedPage(Page& page);
+
+  // Stores the record in the lowest tombstone slot, or in a new one.
+  // Compacts the page first if the record only fits in fragmented space.
+  // `overflow` is kept with the record and comes back in its RecordView;
+  // the page itself gives it no meaning.
+  Result<std::uint16_t> Insert(std::span<const std::byte> record,
+                               bool overflow = false);
+
+  // Tombstones the slot. The record's bytes become fragmented space.
+  Status Delete(std::uint16_t slot_id);
+
+  // Replaces the record, keeping its slot id. A record that shrinks, or
+  // that can grow into the free space right after it, is rewritten in
+  // place; otherwise it is moved to the end of the records, compacting the
+  // page first if need be. InvalidArgument, with the record unchanged, if
+  // it cannot fit. The overflow flag is replaced too.
+  Status Update(std::uint16_t slot_id, std::span<const std::byte> record,
+                bool overflow = false);
+
+  void set_next_page_id(PageId page_id);
+
+  // Slides the live records together so all free space is contiguous.
+  // Slot ids are unchanged.
+  void Compact();
+
+  // Fragmented space beyond which Delete and Update compact the page
+  // straight away. Below it, compaction waits until an insert or update
+  // needs the space.
+  static constexpr std::size_t kCompactionThreshold = kPageSize / 4;
+
+ private:
+  Header& mutable_header();
+  Slot* mutable_slot_ptr(std::uint16_t index);
+  // Reserves `size` bytes after the last record, compacting first if they
+  // fit only that way, and room for the directory to grow by `slot_bytes`.
+  // Returns their offset, or kTombstone if the page is too full.
+  std::uint16_t Allocate(std::size_t size, std::size_t slot_bytes);
+  // Gives back record bytes: to the contiguous free space if they end at
+  // free_start, to the fragmented space otherwise.
+  void Release(std::size_t offset, std::size_t size);
+  void CompactIfFragmented();
 
-  Page& page_;
+  Page& mutable_page_;
 };
 
 }  // namespace simpledb
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "simpledb/buffer_pool_manager.h"
+#include "simpledb/disk_manager.h"
+#include "simpledb/log_manager.h"
+#include "simpledb/page.h"
+#include "simpledb/status.h"
+
+namespace simpledb {
+
+struct RecoveryOptions {
+  // Worker threads replaying records. Each owns a share of the pages, so
+  // records for one page are always applied by the same thread, in order.
+  std::size_t threads{4};
+  // Pages a worker prefetches together before applying their records.
+  std::size_t prefetch_batch{64};
+};
+
+struct RecoveryStats {
+  // Where the redo pass started reading the log.
+  Lsn redo_lsn{kInvalidLsn};
+  std::size_t records_scanned{0};
+  // Update records written into pages; the rest were already on disk.
+  std::size_t records_applied{0};
+  std::size_t pages{0};
+  // Transactions with updates and no commit. Their updates are redone
+  // like any other; the log holds no undo information.
+  std::vector<std::uint64_t> uncommitted_txns;
+};
+
+// Crash recovery: the redo pass of ARIES. Reads the log from the oldest
+// change the last checkpoint could not vouch for, or from the beginning
+// without a checkpoint, so restart time follows the log written since the
+// checkpoint rather than the database size. Update records are split by
+// page across options.threads workers; each prefetches its pages in
+// batches of runs of consecutive ids and applies, in LSN order, the
+// records newer than each page's LSN. Pages are then flushed and the data
+// file synced. Run it on an otherwise idle pool, before new updates.
+Result<RecoveryStats> Recover(LogManager& log, DiskManager& disk_manager,
+                              BufferPoolManager& pool,
+                              const RecoveryOptions& options = {});
+
+}  // namespace simpledb
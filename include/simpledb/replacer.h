@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace simpledb {
+
+using frame_id_t = std::size_t;
+
+enum class ReplacerPolicy {
+  // Second-chance CLOCK over the evictable frames.
+  kClock,
+  // LRU-K: evicts the frame whose K-th most recent access is oldest. Frames
+  // seen fewer than K times go first, earliest first access first, so
+  // one-pass scans do not displace the hot set.
+  kLruK,
+};
+
+// Chooses which frame the buffer pool gives up on a miss. Only frames marked
+// evictable are candidates. CLOCK's operations are O(1), amortized for its
+// sweep; LRU-K's are O(log n) in the evictable frames. Not internally
+// synchronized; the buffer pool calls it under its shard latch.
+class Replacer {
+ public:
+  virtual ~Replacer() = default;
+
+  // Notes a use of the frame (a hit, or a page being loaded into it).
+  virtual void RecordAccess(frame_id_t frame_id) = 0;
+
+  // Adds the frame to, or withdraws it from, the eviction candidates.
+  virtual void SetEvictable(frame_id_t frame_id, bool evictable) = 0;
+
+  // Picks a victim among the evictable frames and forgets its history.
+  std::optional<frame_id_t> Evict() {
+    return Evict([](frame_id_t) { return true; });
+  }
+
+  // As above, but each candidate is offered to `try_evict` in eviction
+  // order. A refused frame stays evictable and moves behind the others
+  // (CLOCK also marks it referenced); the refusal is not an access. Gives
+  // up after at most 2 * size() + 1 refusals, which is enough for every
+  // unrefusable frame to come up.
+  virtual std::optional<frame_id_t> Evict(
+      const std::function<bool(frame_id_t)>& try_evict) = 0;
+
+  // Forgets the frame entirely, e.g. when its page leaves the pool.
+  virtual void Remove(frame_id_t frame_id) = 0;
+
+  // Visits the evictable frames roughly in the order Evict would offer
+  // them, until `fn` returns false. Changes nothing; the page cleaner uses
+  // it to find the pages about to be evicted.
+  virtual void ForEachCandidate(
+      const std::function<bool(frame_id_t)>& fn) const = 0;
+
+  // Number of evictable frames.
+  virtual std::size_t size() const = 0;
+};
+
+std::unique_ptr<Replacer> MakeReplacer(ReplacerPolicy policy,
+                                       std::size_t num_frames,
+                                       std::size_t k = 2);
+
+// Doubly linked list of frame ids threaded through per-frame link arrays, so
+// insertion, removal and membership tests never allocate or scan.
+class FrameList {
+ public:
+  explicit FrameList(std::size_t num_frames);
+
+  void PushBack(frame_id_t frame_id);
+  void Remove(frame_id_t frame_id);
+  frame_id_t front() const { return head_; }
+  bool Contains(frame_id_t frame_id) const { return linked_[frame_id] != 0; }
+  bool empty() const { return size_ == 0; }
+  std::size_t size() const { return size_; }
+
+  // Visits frames front to back until `fn` returns false; returns whether
+  // it got to the end.
+  template <typename Fn>
+  bool ForEach(Fn&& fn) const {
+    for (frame_id_t f = head_; f != kNil; f = next_[f]) {
+      if (!fn(f)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  static constexpr frame_id_t kNil = static_cast<frame_id_t>(-1);
+
+  std::vector<frame_id_t> prev_;
+  std::vector<frame_id_t> next_;
+  std::vector<std::uint8_t> linked_;
+  frame_id_t head_{kNil};
+  frame_id_t tail_{kNil};
+  std::size_t size_{0};
+};
+
+class ClockReplacer : public Replacer {
+ public:
+  explicit ClockReplacer(std::size_t num_frames);
+
+  void RecordAccess(frame_id_t frame_id) override;
+  void SetEvictable(frame_id_t frame_id, bool evictable) override;
+  using Replacer::Evict;
+  std::optional<frame_id_t> Evict(
+      const std::function<bool(frame_id_t)>& try_evict) override;
+  void Remove(frame_id_t frame_id) override;
+  void ForEachCandidate(
+      const std::function<bool(frame_id_t)>& fn) const override;
+  std::size_t size() const override { return ring_.size(); }
+
+ private:
+  // The front of the ring is the clock hand; frames given a second chance
+  // and newly evictable frames go to the back.
+  FrameList ring_;
+  std::vector<std::uint8_t> referenced_;
+};
+
+// LRU-K. Each frame keeps the times of its last K accesses, on a logical
+// clock. Evictable frames with fewer than K accesses sit in the history set,
+// ordered by first access, and are always evicted before those in the cache
+// set, ordered by backward K-distance: the time of the K-th most recent
+// access. Each frame's set node is allocated once and then moved between
+// the sets, so no operation allocates after warm-up.
+class LruKReplacer : public Replacer {
+ public:
+  LruKReplacer(std::size_t num_frames, std::size_t k);
+
+  void RecordAccess(frame_id_t frame_id) override;
+  void SetEvictable(frame_id_t frame_id, bool evictable) override;
+  using Replacer::Evict;
+  std::optional<frame_id_t> Evict(
+      const std::function<bool(frame_id_t)>& try_evict) override;
+  void Remove(frame_id_t frame_id) override;
+  void ForEachCandidate(
+      const std::function<bool(frame_id_t)>& fn) const override;
+  std::size_t size() const override { return history_.size() + cache_.size(); }
+
+ private:
+  // Evictable frames by (key, frame id), front first.
+  using FrameSet = std::set<std::pair<std::uint64_t, frame_id_t>>;
+
+  FrameSet& SetFor(frame_id_t frame_id);
+  // Puts the frame into, or takes it out of, the set its access count
+  // calls for, at key_[frame_id].
+  void Link(frame_id_t frame_id);
+  void Unlink(frame_id_t frame_id);
+
+  std::size_t k_;
+  std::uint64_t now_{0};
+  // Frame f's access times are times_[f * k_, (f + 1) * k_): in order while
+  // there are fewer than k_, then a ring whose oldest entry is at oldest_[f].
+  std::vector<std::uint64_t> times_;
+  std::vector<std::size_t> accesses_;
+  std::vector<std::size_t> oldest_;
+  // The frame's sort key: its oldest recorded access (0 for none), or a
+  // later time if Evict has since moved it to the back.
+  std::vector<std::uint64_t> key_;
+  std::vector<std::uint8_t> evictable_;
+  FrameSet history_;
+  FrameSet cache_;
+  // Each frame's set node while it is not evictable, and its place in the
+  // set while it is.
+  std::vector<FrameSet::node_type> nodes_;
+  std::vector<FrameSet::iterator> positions_;
+};
+
+}  // namespace simpledb
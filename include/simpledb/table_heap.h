@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "simpledb/buffer_pool_manager.h"
+#include "simpledb/overflow.h"
+#include "simpledb/page.h"
+#include "simpledb/page_guard.h"
+#include "simpledb/record.h"
+#include "simpledb/status.h"
+
+namespace simpledb {
+
+// Where a record lives: its page and its slot there. Stable for the life
+// of the record.
+struct RecordId {
+  PageId page_id{kInvalidPageId};
+  std::uint16_t slot{0};
+
+  friend bool operator==(const RecordId&, const RecordId&) = default;
+};
+
+// An unordered collection of records in a chain of slotted pages, read and
+// written through a buffer pool. Inserts go to the page with the least free
+// space that still fits the record, found through an in-memory free-space
+// map, and a new page is chained on only when no page has room. The map is
+// rebuilt by Open from one pass over the pages. Safe for concurrent use;
+// each operation latches only the pages it touches.
+//
+// Records larger than kMaxInlineSize are split: their first
+// kOverflowPrefixSize bytes stay in the slotted page, next to an
+// OverflowRef to the rest, which goes to a run of overflow pages. Reads
+// put such records together without an intermediate copy.
+class TableHeap {
+ public:
+  // Forward scan over the live records, in page chain and then slot
+  // order. Holds a read guard on the page of the current record, and on no
+  // other page; the view record() returns is valid until the next call to
+  // Next(). Pages are fetched with AccessHint::kSequential, so a scan
+  // reads ahead and does not flush the pool. A record's overflow pages
+  // are read only if Read() asks for them.
+  class Iterator {
+   public:
+    Iterator() = default;
+
+    // False once the scan has passed the last record.
+    bool Valid() const { return guard_.valid(); }
+    RecordId record_id() const { return {guard_.page_id(), slot_}; }
+    // The record in place; for a record in overflow pages, just its
+    // prefix, with overflow set.
+    RecordView record() const;
+    std::size_t record_size() const;
+    // Copies the whole record into out, which must hold record_size()
+    // bytes.
+    Status Read(std::span<std::byte> out) const;
+
+    Status Next();
+
+   private:
+    friend class TableHeap;
+
+    Iterator(BufferPoolManager* pool, ReadPageGuard guard);
+    // Moves to the first live record at or after slot `from`, following
+    // the chain past pages with none.
+    Status Seek(std::uint16_t from);
+
+    BufferPoolManager* pool_{nullptr};
+    ReadPageGuard guard_;
+    std::uint16_t slot_{0};
+  };
+
+  explicit TableHeap(BufferPoolManager* pool);
+
+  TableHeap(const TableHeap&) = delete;
+  TableHeap& operator=(const TableHeap&) = delete;
+
+  // Starts a new, empty heap on a fresh page.
+  Status Create();
+
+  // Attaches to the heap whose chain starts at first_page_id.
+  Status Open(PageId first_page_id);
+
+  // Records above this size go to overflow pages.
+  static constexpr std::size_t kMaxInlineSize = kPageSize / 2;
+  // Bytes of such a record kept in the slotted page.
+  static constexpr std::size_t kOverflowPrefixSize = 256;
+
+  Result<RecordId> Insert(std::span<const std::byte> record);
+
+  // A copy of the record; NotFound if it has been deleted.
+  Result<std::vector<std::byte>> Get(RecordId record_id);
+
+  Result<std::size_t> RecordSize(RecordId record_id);
+
+  // Copies the record into out, straight from the pages that hold it, and
+  // returns its size. InvalidArgument if out is smaller than the record.
+  Result<std::size_t> Read(RecordId record_id, std::span<std::byte> out);
+
+  // Rewrites the record on its page, moving it into or out of overflow
+  // pages as its size requires. InvalidArgument if the page cannot hold
+  // the new size; the record is not moved to another page.
+  Status Update(RecordId record_id, std::span<const std::byte> record);
+
+  // Also frees the record's overflow pages. Pages that cannot be freed
+  // yet are retried by later updates and deletes.
+  Status Delete(RecordId record_id);
+
+  // An iterator at the first live record, or an invalid one for an empty
+  // heap.
+  Result<Iterator> Begin();
+
+  PageId first_page_id() const { return first_page_id_; }
+  std::size_t page_count();
+
+ private:
+  // Stores bytes as they are in a slotted page.
+  Result<RecordId> InsertInline(std::span<const std::byte> bytes,
+                                bool overflow);
+  Result<RecordId> AppendPage(std::span<const std::byte> bytes,
+                              bool overflow);
+  Status CheckPage(PageId page_id);
+  // CheckPage, then FetchPageRead.
+  Result<ReadPageGuard> FetchRead(PageId page_id);
+  void NoteFreeSpace(PageId page_id, std::size_t free_space);
+  // Frees ref's chain, and what earlier calls could not free.
+  void FreeOverflowPages(const OverflowRef& ref);
+
+  BufferPoolManager* pool_;
+  PageId first_page_id_{kInvalidPageId};
+
+  // Serializes chaining on new pages; guards last_page_id_.
+  std::mutex append_latch_;
+  PageId last_page_id_{kInvalidPageId};
+
+  // Free-space map: each page's free space, and the same pairs ordered by
+  // free space for best-fit lookups. Taken after any page latch, never
+  // before one.
+  std::mutex latch_;
+  std::unordered_map<PageId, std::size_t> free_space_;
+  std::set<std::pair<std::size_t, PageId>> by_free_space_;
+  // Overflow pages a delete or update could not free, typically because a
+  // reader had them pinned. Retried by the next one, not leaked.
+  std::vector<OverflowRef> unfreed_overflow_;
+};
+
+}  // namespace simpledb
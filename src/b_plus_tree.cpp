@@ -0,0 +1,771 @@
+#include "simpledb/b_plus_tree.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <utility>
+
+namespace simpledb {
+
+namespace {
+
+// Node layout, after the PageHeader: this header, then the key directory
+// growing up, and cells of key bytes and value growing down from the end
+// of the page. The directory is kept in key order; cells are in no order.
+struct NodeHeader {
+  std::uint16_t key_count;
+  // Where the cells start; they run to the end of the page.
+  std::uint16_t cell_start;
+  // Bytes of removed cells not yet reclaimed by compaction.
+  std::uint16_t fragmented_bytes;
+  // 0 for a leaf; one more than its children's level for an internal node.
+  std::uint16_t level;
+  // A leaf's right sibling, or kInvalidPageId for the last leaf. An
+  // internal node's child for keys below its first key; the child after
+  // each key, for keys from it up to the next, is that key's value.
+  PageId link;
+};
+
+struct KeySlot {
+  std::uint16_t offset;
+  std::uint16_t key_size;
+};
+
+// The header page holds the root's page id and level after its PageHeader.
+struct TreeHeader {
+  PageId root_page_id;
+  std::uint16_t root_level;
+};
+
+constexpr std::size_t kDirectoryStart = kPageHeaderSize + sizeof(NodeHeader);
+constexpr std::size_t kNodeCapacity = kPageSize - kDirectoryStart;
+// A leaf value is a RecordId, an internal one a child page id.
+constexpr std::size_t kLeafValueSize = sizeof(PageId) + sizeof(std::uint16_t);
+constexpr std::size_t kChildValueSize = sizeof(PageId);
+constexpr std::size_t kMaxEntrySize =
+    BPlusTree::kMaxKeySize + kLeafValueSize + sizeof(KeySlot);
+static_assert(4 * kMaxEntrySize <= kNodeCapacity);
+// Space BulkLoad leaves free in each node.
+constexpr std::size_t kBulkLoadSlack = kNodeCapacity / 10;
+
+int Compare(std::span<const std::byte> a, std::span<const std::byte> b) {
+  const std::size_t common = std::min(a.size(), b.size());
+  if (common > 0) {
+    const int order = std::memcmp(a.data(), b.data(), common);
+    if (order != 0) {
+      return order;
+    }
+  }
+  return a.size() < b.size() ? -1 : (a.size() > b.size() ? 1 : 0);
+}
+
+using LeafValue = std::array<std::byte, kLeafValueSize>;
+using ChildValue = std::array<std::byte, kChildValueSize>;
+
+LeafValue EncodeValue(RecordId value) {
+  LeafValue bytes;
+  std::memcpy(bytes.data(), &value.page_id, sizeof(value.page_id));
+  std::memcpy(bytes.data() + sizeof(value.page_id), &value.slot,
+              sizeof(value.slot));
+  return bytes;
+}
+
+ChildValue EncodeChild(PageId child) {
+  ChildValue bytes;
+  std::memcpy(bytes.data(), &child, sizeof(child));
+  return bytes;
+}
+
+PageId DecodeChild(std::span<const std::byte> value) {
+  PageId child;
+  std::memcpy(&child, value.data(), sizeof(child));
+  return child;
+}
+
+TreeHeader ReadTreeHeader(std::span<const std::byte> page) {
+  TreeHeader header;
+  std::memcpy(&header, page.data() + kPageHeaderSize, sizeof(header));
+  return header;
+}
+
+void WriteTreeHeader(std::span<std::byte> page, const TreeHeader& header) {
+  std::memcpy(page.data() + kPageHeaderSize, &header, sizeof(header));
+}
+
+class NodeView {
+ public:
+  explicit NodeView(std::span<const std::byte> data) : data_(data) {}
+
+  bool is_leaf() const {
+    return PageTypeOf(data_) == PageType::kBPlusTreeLeaf;
+  }
+  std::uint16_t key_count() const { return header().key_count; }
+  std::uint16_t level() const { return header().level; }
+  PageId link() const { return header().link; }
+
+  std::span<const std::byte> KeyAt(std::uint16_t index) const {
+    const KeySlot slot = SlotAt(index);
+    return data_.subspan(slot.offset, slot.key_size);
+  }
+
+  std::span<const std::byte> ValueAt(std::uint16_t index) const {
+    const KeySlot slot = SlotAt(index);
+    return data_.subspan(slot.offset + slot.key_size, value_size());
+  }
+
+  RecordId RecordAt(std::uint16_t index) const {
+    RecordId value;
+    const auto bytes = ValueAt(index);
+    std::memcpy(&value.page_id, bytes.data(), sizeof(value.page_id));
+    std::memcpy(&value.slot, bytes.data() + sizeof(value.page_id),
+                sizeof(value.slot));
+    return value;
+  }
+
+  // The first index whose key is not less than key.
+  std::uint16_t LowerBound(std::span<const std::byte> key) const {
+    std::uint16_t low = 0;
+    std::uint16_t high = key_count();
+    while (low < high) {
+      const auto mid = static_cast<std::uint16_t>((low + high) / 2);
+      if (Compare(KeyAt(mid), key) < 0) {
+        low = static_cast<std::uint16_t>(mid + 1);
+      } else {
+        high = mid;
+      }
+    }
+    return low;
+  }
+
+  bool HasKeyAt(std::uint16_t index, std::span<const std::byte> key) const {
+    return index < key_count() && Compare(KeyAt(index), key) == 0;
+  }
+
+  // The child of an internal node whose subtree would hold key.
+  PageId ChildFor(std::span<const std::byte> key) const {
+    std::uint16_t index = LowerBound(key);
+    if (HasKeyAt(index, key)) {
+      ++index;
+    }
+    return index == 0 ? link() : DecodeChild(ValueAt(index - 1));
+  }
+
+  std::size_t value_size() const {
+    return is_leaf() ? kLeafValueSize : kChildValueSize;
+  }
+
+  // Bytes an entry can use, counting fragmented space.
+  std::size_t free_space() const {
+    return contiguous_space() + header().fragmented_bytes;
+  }
+
+  // Whether the node can take any one more entry, so that no split from
+  // below can reach its parent.
+  bool Safe() const { return free_space() >= kMaxEntrySize; }
+
+ protected:
+  const NodeHeader& header() const {
+    return *reinterpret_cast<const NodeHeader*>(data_.data() +
+                                                kPageHeaderSize);
+  }
+
+  KeySlot SlotAt(std::uint16_t index) const {
+    KeySlot slot;
+    std::memcpy(&slot, data_.data() + kDirectoryStart + index * sizeof(slot),
+                sizeof(slot));
+    return slot;
+  }
+
+  std::size_t contiguous_space() const {
+    const std::size_t directory_end =
+        kDirectoryStart + key_count() * sizeof(KeySlot);
+    return header().cell_start - directory_end;
+  }
+
+  std::span<const std::byte> data_;
+};
+
+class Node : public NodeView {
+ public:
+  explicit Node(std::span<std::byte> data)
+      : NodeView(data), mutable_data_(data) {}
+
+  void Format(PageType type, std::uint16_t level, PageId link) {
+    SetPageType(mutable_data_, type);
+    auto& hdr = mutable_header();
+    hdr.key_count = 0;
+    hdr.cell_start = static_cast<std::uint16_t>(kPageSize);
+    hdr.fragmented_bytes = 0;
+    hdr.level = level;
+    hdr.link = link;
+  }
+
+  void set_link(PageId link) { mutable_header().link = link; }
+
+  // False, with the node unchanged, if the entry does not fit.
+  bool InsertAt(std::uint16_t index, std::span<const std::byte> key,
+                std::span<const std::byte> value) {
+    const std::size_t cell_size = key.size() + value.size();
+    if (contiguous_space() < cell_size + sizeof(KeySlot)) {
+      if (free_space() < cell_size + sizeof(KeySlot)) {
+        return false;
+      }
+      Compact();
+    }
+    auto& hdr = mutable_header();
+    hdr.cell_start = static_cast<std::uint16_t>(hdr.cell_start - cell_size);
+    std::byte* const cell = mutable_data_.data() + hdr.cell_start;
+    std::memcpy(cell, key.data(), key.size());
+    std::memcpy(cell + key.size(), value.data(), value.size());
+
+    std::byte* const slots = mutable_data_.data() + kDirectoryStart;
+    std::memmove(slots + (index + 1) * sizeof(KeySlot),
+                 slots + index * sizeof(KeySlot),
+                 (hdr.key_count - index) * sizeof(KeySlot));
+    const KeySlot slot{hdr.cell_start, static_cast<std::uint16_t>(key.size())};
+    std::memcpy(slots + index * sizeof(KeySlot), &slot, sizeof(slot));
+    ++hdr.key_count;
+    return true;
+  }
+
+  bool Append(std::span<const std::byte> key,
+              std::span<const std::byte> value) {
+    return InsertAt(key_count(), key, value);
+  }
+
+  void RemoveAt(std::uint16_t index) {
+    const KeySlot slot = SlotAt(index);
+    const std::size_t cell_size = slot.key_size + value_size();
+    auto& hdr = mutable_header();
+    if (slot.offset == hdr.cell_start) {
+      hdr.cell_start = static_cast<std::uint16_t>(hdr.cell_start + cell_size);
+    } else {
+      hdr.fragmented_bytes =
+          static_cast<std::uint16_t>(hdr.fragmented_bytes + cell_size);
+    }
+    std::byte* const slots = mutable_data_.data() + kDirectoryStart;
+    std::memmove(slots + index * sizeof(KeySlot),
+                 slots + (index + 1) * sizeof(KeySlot),
+                 (hdr.key_count - index - 1) * sizeof(KeySlot));
+    --hdr.key_count;
+  }
+
+ private:
+  NodeHeader& mutable_header() {
+    return *reinterpret_cast<NodeHeader*>(mutable_data_.data() +
+                                          kPageHeaderSize);
+  }
+
+  // Rewrites the cells, in directory order, to the end of the page.
+  void Compact() {
+    PageImage scratch;
+    std::size_t end = kPageSize;
+    std::byte* const slots = mutable_data_.data() + kDirectoryStart;
+    for (std::uint16_t index = 0; index < key_count(); ++index) {
+      KeySlot slot = SlotAt(index);
+      const std::size_t cell_size = slot.key_size + value_size();
+      end -= cell_size;
+      std::memcpy(scratch.bytes.data() + end,
+                  mutable_data_.data() + slot.offset, cell_size);
+      slot.offset = static_cast<std::uint16_t>(end);
+      std::memcpy(slots + index * sizeof(KeySlot), &slot, sizeof(slot));
+    }
+    std::memcpy(mutable_data_.data() + end, scratch.bytes.data() + end,
+                kPageSize - end);
+    auto& hdr = mutable_header();
+    hdr.cell_start = static_cast<std::uint16_t>(end);
+    hdr.fragmented_bytes = 0;
+  }
+
+  std::span<std::byte> mutable_data_;
+};
+
+// What a split hands to the parent: the first key of the new right node's
+// subtree, and the right node.
+struct Separator {
+  std::vector<std::byte> key;
+  PageId right{kInvalidPageId};
+};
+
+// Splits a full node around a new entry at index, moving about half of
+// the bytes to a new right sibling. A leaf keeps a copy of the separator
+// as its right half's first key; an internal node gives it up to the
+// parent, and its value becomes the right node's link.
+Result<Separator> Split(BufferPoolManager* pool, WritePageGuard& guard,
+                        std::uint16_t index, std::span<const std::byte> key,
+                        std::span<const std::byte> value) {
+  auto right_res = pool->NewPageWrite();
+  if (!right_res.ok()) {
+    return right_res.status();
+  }
+  WritePageGuard right_guard = std::move(right_res).value();
+
+  PageImage scratch;
+  std::memcpy(scratch.bytes.data(), guard.data().data(), kPageSize);
+  const NodeView old(scratch.bytes);
+
+  struct Cell {
+    std::span<const std::byte> key;
+    std::span<const std::byte> value;
+  };
+  std::vector<Cell> cells;
+  cells.reserve(old.key_count() + 1);
+  for (std::uint16_t i = 0; i < old.key_count(); ++i) {
+    if (i == index) {
+      cells.push_back({key, value});
+    }
+    cells.push_back({old.KeyAt(i), old.ValueAt(i)});
+  }
+  if (index == old.key_count()) {
+    cells.push_back({key, value});
+  }
+
+  std::size_t total = 0;
+  for (const auto& cell : cells) {
+    total += cell.key.size() + cell.value.size() + sizeof(KeySlot);
+  }
+  std::size_t mid = 0;
+  for (std::size_t left = 0; mid < cells.size() && left < total / 2; ++mid) {
+    left += cells[mid].key.size() + cells[mid].value.size() + sizeof(KeySlot);
+  }
+  const bool leaf = old.is_leaf();
+  mid = std::clamp<std::size_t>(mid, 1, cells.size() - (leaf ? 1 : 2));
+
+  Node left_node(guard.data());
+  Node right_node(right_guard.data());
+  if (leaf) {
+    right_node.Format(PageType::kBPlusTreeLeaf, 0, old.link());
+    left_node.Format(PageType::kBPlusTreeLeaf, 0, right_guard.page_id());
+  } else {
+    right_node.Format(PageType::kBPlusTreeInternal, old.level(),
+                      DecodeChild(cells[mid].value));
+    left_node.Format(PageType::kBPlusTreeInternal, old.level(), old.link());
+  }
+  for (std::size_t i = 0; i < mid; ++i) {
+    left_node.Append(cells[i].key, cells[i].value);
+  }
+  for (std::size_t i = leaf ? mid : mid + 1; i < cells.size(); ++i) {
+    right_node.Append(cells[i].key, cells[i].value);
+  }
+  return Separator{{cells[mid].key.begin(), cells[mid].key.end()},
+                   right_guard.page_id()};
+}
+
+}  // namespace
+
+BPlusTree::Iterator::Iterator(BufferPoolManager* pool, ReadPageGuard leaf,
+                              std::uint16_t index)
+    : pool_(pool), guard_(std::move(leaf)), index_(index) {}
+
+std::span<const std::byte> BPlusTree::Iterator::key() const {
+  return NodeView(guard_.data()).KeyAt(index_);
+}
+
+RecordId BPlusTree::Iterator::value() const {
+  return NodeView(guard_.data()).RecordAt(index_);
+}
+
+Status BPlusTree::Iterator::Next() {
+  if (!Valid()) {
+    return Status::InvalidArgument("iterator is past the end");
+  }
+  ++index_;
+  return SkipExhausted();
+}
+
+Status BPlusTree::Iterator::SkipExhausted() {
+  while (index_ >= NodeView(guard_.data()).key_count()) {
+    const PageId next = NodeView(guard_.data()).link();
+    if (next == kInvalidPageId) {
+      guard_.Release();
+      return Status::OK();
+    }
+    // The next leaf is latched before this one is let go, so a split
+    // cannot move entries past the scan.
+    auto next_res = pool_->FetchPageRead(next, AccessHint::kSequential);
+    if (!next_res.ok()) {
+      guard_.Release();
+      return next_res.status();
+    }
+    guard_ = std::move(next_res).value();
+    index_ = 0;
+  }
+  return Status::OK();
+}
+
+BPlusTree::BPlusTree(BufferPoolManager* pool) : pool_(pool) {}
+
+Status BPlusTree::Create() {
+  auto header_res = pool_->NewPageWrite();
+  if (!header_res.ok()) {
+    return header_res.status();
+  }
+  WritePageGuard header = std::move(header_res).value();
+  auto root_res = pool_->NewPageWrite();
+  if (!root_res.ok()) {
+    return root_res.status();
+  }
+  WritePageGuard root = std::move(root_res).value();
+
+  Node(root.data()).Format(PageType::kBPlusTreeLeaf, 0, kInvalidPageId);
+  SetPageType(header.data(), PageType::kBPlusTreeHeader);
+  WriteTreeHeader(header.data(), {root.page_id(), 0});
+  header_page_id_ = header.page_id();
+  return Status::OK();
+}
+
+Status BPlusTree::Open(PageId header_page_id) {
+  auto header_res = pool_->FetchPageRead(header_page_id);
+  if (!header_res.ok()) {
+    return header_res.status();
+  }
+  if (PageTypeOf(header_res.value().data()) != PageType::kBPlusTreeHeader) {
+    return Status::InvalidArgument("not a b+ tree header page");
+  }
+  header_page_id_ = header_page_id;
+  return Status::OK();
+}
+
+Result<ReadPageGuard> BPlusTree::FindLeafRead(std::span<const std::byte> key,
+                                              bool leftmost) {
+  if (header_page_id_ == kInvalidPageId) {
+    return Status::InvalidArgument("b+ tree is not open");
+  }
+  auto header_res = pool_->FetchPageRead(header_page_id_);
+  if (!header_res.ok()) {
+    return header_res.status();
+  }
+  ReadPageGuard parent = std::move(header_res).value();
+  PageId page_id = ReadTreeHeader(parent.data()).root_page_id;
+  for (;;) {
+    auto child_res = pool_->FetchPageRead(page_id);
+    if (!child_res.ok()) {
+      return child_res.status();
+    }
+    parent = std::move(child_res).value();
+    const NodeView node(parent.data());
+    if (node.is_leaf()) {
+      return parent;
+    }
+    page_id = leftmost ? node.link() : node.ChildFor(key);
+  }
+}
+
+// Internal nodes are read-latched; a node's level says whether its
+// children are leaves, and the header says whether the root is one.
+Result<WritePageGuard> BPlusTree::FindLeafWrite(
+    std::span<const std::byte> key) {
+  if (header_page_id_ == kInvalidPageId) {
+    return Status::InvalidArgument("b+ tree is not open");
+  }
+  auto header_res = pool_->FetchPageRead(header_page_id_);
+  if (!header_res.ok()) {
+    return header_res.status();
+  }
+  ReadPageGuard parent = std::move(header_res).value();
+  const TreeHeader tree = ReadTreeHeader(parent.data());
+  PageId page_id = tree.root_page_id;
+  for (std::uint16_t level = tree.root_level; level > 0; --level) {
+    auto child_res = pool_->FetchPageRead(page_id);
+    if (!child_res.ok()) {
+      return child_res.status();
+    }
+    parent = std::move(child_res).value();
+    page_id = NodeView(parent.data()).ChildFor(key);
+  }
+  return pool_->FetchPageWrite(page_id);
+}
+
+Status BPlusTree::Insert(std::span<const std::byte> key, RecordId value) {
+  if (key.size() > kMaxKeySize) {
+    return Status::InvalidArgument("key too large");
+  }
+  {
+    auto leaf_res = FindLeafWrite(key);
+    if (!leaf_res.ok()) {
+      return leaf_res.status();
+    }
+    WritePageGuard leaf = std::move(leaf_res).value();
+    Node node(leaf.data());
+    const std::uint16_t index = node.LowerBound(key);
+    if (node.HasKeyAt(index, key)) {
+      return Status::InvalidArgument("duplicate key");
+    }
+    if (node.InsertAt(index, key, EncodeValue(value))) {
+      return Status::OK();
+    }
+  }
+  return InsertPessimistic(key, value);
+}
+
+// Write-crabs from the header, letting go of every latch above a node that
+// can absorb a split below it. What is left latched is exactly the path a
+// split can climb.
+Status BPlusTree::InsertPessimistic(std::span<const std::byte> key,
+                                    RecordId value) {
+  auto header_res = pool_->FetchPageWrite(header_page_id_);
+  if (!header_res.ok()) {
+    return header_res.status();
+  }
+  WritePageGuard header = std::move(header_res).value();
+  const TreeHeader tree = ReadTreeHeader(header.data());
+
+  std::vector<WritePageGuard> path;
+  PageId page_id = tree.root_page_id;
+  for (;;) {
+    auto child_res = pool_->FetchPageWrite(page_id);
+    if (!child_res.ok()) {
+      return child_res.status();
+    }
+    WritePageGuard child = std::move(child_res).value();
+    const NodeView node(child.data());
+    if (node.Safe()) {
+      header.Release();
+      path.clear();
+    }
+    const bool leaf = node.is_leaf();
+    if (!leaf) {
+      page_id = node.ChildFor(key);
+    }
+    path.push_back(std::move(child));
+    if (leaf) {
+      break;
+    }
+  }
+
+  Node leaf(path.back().data());
+  std::uint16_t index = leaf.LowerBound(key);
+  if (leaf.HasKeyAt(index, key)) {
+    return Status::InvalidArgument("duplicate key");
+  }
+  const LeafValue encoded = EncodeValue(value);
+  if (leaf.InsertAt(index, key, encoded)) {
+    return Status::OK();
+  }
+  auto split_res = Split(pool_, path.back(), index, key, encoded);
+  for (std::size_t i = path.size() - 1; i > 0; --i) {
+    if (!split_res.ok()) {
+      return split_res.status();
+    }
+    const Separator separator = std::move(split_res).value();
+    Node parent(path[i - 1].data());
+    index = parent.LowerBound(separator.key);
+    const ChildValue child = EncodeChild(separator.right);
+    if (parent.InsertAt(index, separator.key, child)) {
+      return Status::OK();
+    }
+    split_res = Split(pool_, path[i - 1], index, separator.key, child);
+  }
+  if (!split_res.ok()) {
+    return split_res.status();
+  }
+
+  // The root split, so it was not safe and the header is still latched.
+  const Separator separator = std::move(split_res).value();
+  auto root_res = pool_->NewPageWrite();
+  if (!root_res.ok()) {
+    return root_res.status();
+  }
+  WritePageGuard root = std::move(root_res).value();
+  const auto level = static_cast<std::uint16_t>(tree.root_level + 1);
+  Node node(root.data());
+  node.Format(PageType::kBPlusTreeInternal, level, path.front().page_id());
+  node.Append(separator.key, EncodeChild(separator.right));
+  WriteTreeHeader(header.data(), {root.page_id(), level});
+  return Status::OK();
+}
+
+Result<RecordId> BPlusTree::Get(std::span<const std::byte> key) {
+  auto leaf_res = FindLeafRead(key, false);
+  if (!leaf_res.ok()) {
+    return leaf_res.status();
+  }
+  const ReadPageGuard leaf = std::move(leaf_res).value();
+  const NodeView node(leaf.data());
+  const std::uint16_t index = node.LowerBound(key);
+  if (!node.HasKeyAt(index, key)) {
+    return Status::NotFound("key not found");
+  }
+  return node.RecordAt(index);
+}
+
+Status BPlusTree::Delete(std::span<const std::byte> key) {
+  auto leaf_res = FindLeafWrite(key);
+  if (!leaf_res.ok()) {
+    return leaf_res.status();
+  }
+  WritePageGuard leaf = std::move(leaf_res).value();
+  Node node(leaf.data());
+  const std::uint16_t index = node.LowerBound(key);
+  if (!node.HasKeyAt(index, key)) {
+    return Status::NotFound("key not found");
+  }
+  node.RemoveAt(index);
+  return Status::OK();
+}
+
+// Builds the new tree on fresh pages and swaps it in at the header, so a
+// failure part way leaves the empty tree as it was. The pages written by
+// then are deleted again.
+Status BPlusTree::BulkLoad(std::span<const Entry> entries) {
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    if (entries[i].key.size() > kMaxKeySize) {
+      return Status::InvalidArgument("key too large");
+    }
+    if (i > 0 && Compare(entries[i - 1].key, entries[i].key) >= 0) {
+      return Status::InvalidArgument("keys are not strictly ascending");
+    }
+  }
+  if (header_page_id_ == kInvalidPageId) {
+    return Status::InvalidArgument("b+ tree is not open");
+  }
+
+  auto header_res = pool_->FetchPageWrite(header_page_id_);
+  if (!header_res.ok()) {
+    return header_res.status();
+  }
+  WritePageGuard header = std::move(header_res).value();
+  const TreeHeader tree = ReadTreeHeader(header.data());
+  // Deletes leave empty leaves and the internal nodes above them behind, so
+  // every leaf is checked. The old pages, gathered a level at a time, are
+  // freed once the new tree is in place.
+  std::vector<PageId> old_pages;
+  for (std::vector<PageId> level_pages{tree.root_page_id};
+       !level_pages.empty();) {
+    std::vector<PageId> children;
+    for (const PageId page_id : level_pages) {
+      auto node_res = pool_->FetchPageRead(page_id, AccessHint::kOneShot);
+      if (!node_res.ok()) {
+        return node_res.status();
+      }
+      const NodeView node(node_res.value().data());
+      if (node.is_leaf()) {
+        if (node.key_count() > 0) {
+          return Status::InvalidArgument("bulk load needs an empty tree");
+        }
+        continue;
+      }
+      children.push_back(node.link());
+      for (std::uint16_t index = 0; index < node.key_count(); ++index) {
+        children.push_back(DecodeChild(node.ValueAt(index)));
+      }
+    }
+    old_pages.insert(old_pages.end(), level_pages.begin(), level_pages.end());
+    level_pages = std::move(children);
+  }
+  if (entries.empty()) {
+    return Status::OK();
+  }
+
+  // Every page of the new tree so far, and the node being filled.
+  std::vector<PageId> created;
+  WritePageGuard guard;
+  const auto abandon = [&](const Status& status) {
+    guard.Release();
+    for (const PageId page_id : created) {
+      static_cast<void>(pool_->DeletePage(page_id));
+    }
+    return status;
+  };
+
+  // Each level as the first key under each node, and the node.
+  std::vector<std::pair<std::span<const std::byte>, PageId>> nodes;
+  for (const Entry& entry : entries) {
+    const LeafValue value = EncodeValue(entry.value);
+    const std::size_t need =
+        entry.key.size() + value.size() + sizeof(KeySlot) + kBulkLoadSlack;
+    if (!guard.valid() || NodeView(guard.data()).free_space() < need) {
+      auto next_res = pool_->NewPageWrite();
+      if (!next_res.ok()) {
+        return abandon(next_res.status());
+      }
+      WritePageGuard next = std::move(next_res).value();
+      created.push_back(next.page_id());
+      Node(next.data()).Format(PageType::kBPlusTreeLeaf, 0, kInvalidPageId);
+      if (guard.valid()) {
+        Node(guard.data()).set_link(next.page_id());
+      }
+      nodes.emplace_back(entry.key, next.page_id());
+      guard = std::move(next);
+    }
+    Node(guard.data()).Append(entry.key, value);
+  }
+
+  std::uint16_t level = 0;
+  while (nodes.size() > 1) {
+    ++level;
+    std::vector<std::pair<std::span<const std::byte>, PageId>> parents;
+    guard.Release();
+    for (const auto& [key, child] : nodes) {
+      const std::size_t need =
+          key.size() + kChildValueSize + sizeof(KeySlot) + kBulkLoadSlack;
+      if (guard.valid() && NodeView(guard.data()).free_space() >= need) {
+        Node(guard.data()).Append(key, EncodeChild(child));
+        continue;
+      }
+      auto next_res = pool_->NewPageWrite();
+      if (!next_res.ok()) {
+        return abandon(next_res.status());
+      }
+      guard = std::move(next_res).value();
+      created.push_back(guard.page_id());
+      Node(guard.data()).Format(PageType::kBPlusTreeInternal, level, child);
+      parents.emplace_back(key, guard.page_id());
+    }
+    nodes = std::move(parents);
+  }
+
+  guard.Release();
+  WriteTreeHeader(header.data(), {nodes.front().second, level});
+  Status result;
+  for (const PageId page_id : old_pages) {
+    const auto status = pool_->DeletePage(page_id);
+    if (!status.ok() && result.ok()) {
+      result = status;
+    }
+  }
+  return result;
+}
+
+Result<BPlusTree::Iterator> BPlusTree::Begin() {
+  auto leaf_res = FindLeafRead({}, true);
+  if (!leaf_res.ok()) {
+    return leaf_res.status();
+  }
+  Iterator it(pool_, std::move(leaf_res).value(), 0);
+  const auto status = it.SkipExhausted();
+  if (!status.ok()) {
+    return status;
+  }
+  return it;
+}
+
+Result<BPlusTree::Iterator> BPlusTree::LowerBound(
+    std::span<const std::byte> key) {
+  auto leaf_res = FindLeafRead(key, false);
+  if (!leaf_res.ok()) {
+    return leaf_res.status();
+  }
+  ReadPageGuard leaf = std::move(leaf_res).value();
+  const std::uint16_t index = NodeView(leaf.data()).LowerBound(key);
+  Iterator it(pool_, std::move(leaf), index);
+  const auto status = it.SkipExhausted();
+  if (!status.ok()) {
+    return status;
+  }
+  return it;
+}
+
+Result<std::size_t> BPlusTree::height() {
+  if (header_page_id_ == kInvalidPageId) {
+    return Status::InvalidArgument("b+ tree is not open");
+  }
+  auto header_res = pool_->FetchPageRead(header_page_id_);
+  if (!header_res.ok()) {
+    return header_res.status();
+  }
+  return std::size_t{ReadTreeHeader(header_res.value().data()).root_level} +
+         1;
+}
+
+}  // namespace simpledb
@@ -1,197 +1,915 @@
 #include "simpledb/buffer_pool_manager.h"
 
+#include <algorithm>
+#include <cstring>
+#include <thread>
 #include <utility>
 
 namespace simpledb {
 
+namespace {
+
+// Spins until the frame's pin count moves from `from` to `to`. Used by latch
+// holders to claim a frame that may carry transient optimistic pins; those
+// are dropped as soon as their owner sees the frame no longer matches.
+void ClaimFrom(std::atomic<int>& pin_count, int from, int to) {
+  int expected = from;
+  while (!pin_count.compare_exchange_weak(expected, to,
+                                          std::memory_order_acquire,
+                                          std::memory_order_relaxed)) {
+    expected = from;
+    std::this_thread::yield();
+  }
+}
+
+// Upper bound on the pages WriteBack copies out and writes in one call.
+constexpr size_t kWriteBackBatch = 64;
+
+// Consecutive ascending fetches by one thread before read-ahead kicks in.
+constexpr size_t kSequentialRun = 4;
+
+// Frames one thread's kSequential/kOneShot misses cycle through within a
+// shard, each with the page it was last loaded with.
+struct Ring {
+  std::vector<std::pair<frame_id_t, PageId>> slots;
+  size_t next{0};
+};
+
+// Per-thread scan detector and rings. Keyed by pool so that one thread
+// alternating between pools does not confuse them. Keys are never reused,
+// unlike pool addresses, so rings whose frame ids belong to a destroyed
+// pool are always reset rather than used on a new one.
+struct ThreadState {
+  std::uint64_t pool{0};
+  PageId last{kInvalidPageId};
+  size_t run{0};
+  PageId read_ahead_end{0};
+  std::vector<Ring> rings;
+};
+
+thread_local ThreadState thread_state;
+
+std::atomic<std::uint64_t> next_pool_id{1};
+
+ThreadState& StateFor(std::uint64_t pool) {
+  if (thread_state.pool != pool) {
+    thread_state = ThreadState{};
+    thread_state.pool = pool;
+  }
+  return thread_state;
+}
+
+}  // namespace
+
+BufferPoolManager::Shard::Shard(Frame* frames, size_t size,
+                                const BufferPoolOptions& options)
+    : frames(frames),
+      size(size),
+      page_table(size),
+      replacer(MakeReplacer(options.replacer, size, options.lru_k)) {
+  for (size_t i = 0; i < size; ++i) {
+    free_list.emplace_back(i);
+  }
+}
+
 BufferPoolManager::BufferPoolManager(size_t pool_size,
-                                     DiskManager* disk_manager)
-    : pool_size_(pool_size), disk_manager_(disk_manager) {
-  frames_.resize(pool_size_);
+                                     DiskManager* disk_manager,
+                                     const BufferPoolOptions& options)
+    : id_(next_pool_id.fetch_add(1, std::memory_order_relaxed)),
+      pool_size_(pool_size),
+      max_replayed_hits_(static_cast<std::uint32_t>(
+          options.replacer == ReplacerPolicy::kLruK
+              ? std::clamp<size_t>(options.lru_k, 1, 64)
+              : 1)),
+      read_ahead_pages_(options.read_ahead_pages),
+      ring_frames_(options.ring_frames),
+      clean_low_watermark_(options.clean_low_watermark),
+      clean_high_watermark_(options.clean_high_watermark),
+      cleaner_interval_(options.cleaner_interval),
+      cleaner_batch_(options.cleaner_batch),
+      arena_(pool_size, options.huge_pages),
+      frames_(pool_size),
+      disk_manager_(disk_manager),
+      log_manager_(options.log_manager) {
   for (size_t i = 0; i < pool_size_; ++i) {
-    free_list_.emplace_back(i);
+    frames_[i].page.data = arena_.page(i);
+  }
+
+  const size_t num_shards =
+      std::max<size_t>(1, std::min(options.num_shards, pool_size_));
+  size_t first = 0;
+  for (size_t i = 0; i < num_shards; ++i) {
+    const size_t size =
+        pool_size_ / num_shards + (i < pool_size_ % num_shards ? 1 : 0);
+    shards_.push_back(
+        std::make_unique<Shard>(frames_.data() + first, size, options));
+    first += size;
+  }
+
+  if (options.page_cleaner) {
+    cleaner_ = std::thread([this] { CleanerLoop(); });
   }
 }
 
-BufferPoolManager::~BufferPoolManager() { FlushAllPages(); }
+BufferPoolManager::~BufferPoolManager() {
+  if (cleaner_.joinable()) {
+    {
+      std::scoped_lock lock(cleaner_mutex_);
+      cleaner_stop_ = true;
+    }
+    cleaner_cv_.notify_one();
+    cleaner_.join();
+  }
+  FlushAllPages();
+}
 
-Result<Page*> BufferPoolManager::FetchPage(PageId page_id) {
-  std::scoped_lock lock(latch_);
+Result<Page*> BufferPoolManager::FetchPage(PageId page_id,
+                                           AccessHint hint) {
+  auto frame_res = FetchFrame(page_id, hint);
+  if (!frame_res.ok()) {
+    return frame_res.status();
+  }
+  return &frame_res.value()->page;
+}
 
-  if (page_table_.count(page_id) > 0) {
-    const auto frame_id = page_table_[page_id];
-    frames_[frame_id].pin_count++;
-    replacer_.remove(frame_id);
-    return &frames_[frame_id].page;
+Result<ReadPageGuard> BufferPoolManager::FetchPageRead(PageId page_id,
+                                                       AccessHint hint) {
+  auto frame_res = FetchFrame(page_id, hint);
+  if (!frame_res.ok()) {
+    return frame_res.status();
   }
+  Frame* frame = frame_res.value();
+  frame->latch.lock_shared();
+  return ReadPageGuard(this, &frame->page, &frame->latch);
+}
 
-  auto victim_res = GetVictim();
-  if (!victim_res.ok()) {
-    return victim_res.status();
+Result<WritePageGuard> BufferPoolManager::FetchPageWrite(PageId page_id,
+                                                         AccessHint hint) {
+  auto frame_res = FetchFrame(page_id, hint);
+  if (!frame_res.ok()) {
+    return frame_res.status();
   }
-  const auto frame_id = victim_res.value();
+  Frame* frame = frame_res.value();
+  frame->latch.lock();
+  return WritePageGuard(this, &frame->page, &frame->latch);
+}
 
-  auto& victim_frame = frames_[frame_id];
-  if (victim_frame.page.id != kInvalidPageId) {
-    if (victim_frame.is_dirty) {
-      auto status = disk_manager_->WritePage(
-          victim_frame.page.id,
-          reinterpret_cast<char*>(victim_frame.page.data.data()));
-      if (!status.ok()) {
-        replacer_.emplace_front(frame_id);
-        return status;
+Result<WritePageGuard> BufferPoolManager::NewPageWrite() {
+  auto frame_res = NewFrame();
+  if (!frame_res.ok()) {
+    return frame_res.status();
+  }
+  Frame* frame = frame_res.value();
+  frame->latch.lock();
+  return WritePageGuard(this, &frame->page, &frame->latch);
+}
+
+Result<PageViewGuard> BufferPoolManager::FetchPageView(PageId page_id) {
+  if (disk_manager_->backend() == IoBackend::kMmap) {
+    auto& shard = ShardFor(page_id);
+    bool resident = shard.page_table.Find(page_id).has_value();
+    if (!resident) {
+      // A lock-free miss can be a table rebuild in progress; confirm it.
+      std::scoped_lock lock(shard.latch);
+      resident = shard.page_table.Find(page_id).has_value();
+    }
+    if (!resident) {
+      if (const auto mapped = disk_manager_->MappedPage(page_id)) {
+        return PageViewGuard(page_id, *mapped);
       }
     }
-    page_table_.erase(victim_frame.page.id);
   }
 
-  auto status = disk_manager_->ReadPage(
+  auto guard_res = FetchPageRead(page_id);
+  if (!guard_res.ok()) {
+    return guard_res.status();
+  }
+  return PageViewGuard(std::move(guard_res).value());
+}
+
+// The hit path. Returns nullptr whenever it cannot cheaply prove the page is
+// resident and loaded; the caller then takes the latched path.
+BufferPoolManager::Frame* BufferPoolManager::TryPinResident(
+    Shard& shard, PageId page_id, bool record_access) {
+  const auto frame_id = shard.page_table.Find(page_id);
+  if (!frame_id) {
+    return nullptr;
+  }
+
+  auto& frame = shard.frames[*frame_id];
+  int pins = frame.pin_count.load(std::memory_order_relaxed);
+  do {
+    if (pins == kClaimed) {
+      return nullptr;
+    }
+  } while (!frame.pin_count.compare_exchange_weak(
+      pins, pins + 1, std::memory_order_acquire, std::memory_order_relaxed));
+
+  // The pin keeps the frame from being claimed, so page.id is stable now.
+  if (frame.io_in_progress.load(std::memory_order_acquire) ||
+      frame.page.id != page_id) {
+    frame.pin_count.fetch_sub(1, std::memory_order_release);
+    return nullptr;
+  }
+
+  if (record_access) {
+    if (frame.hits.load(std::memory_order_relaxed) < max_replayed_hits_) {
+      frame.hits.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Demanded, so no longer read-ahead's to recycle. The pin keeps
+    // TakePrefetched off the frame until this store is visible.
+    if (frame.prefetched.load(std::memory_order_relaxed)) {
+      frame.prefetched.store(false, std::memory_order_relaxed);
+    }
+  }
+  return &frame;
+}
+
+Result<BufferPoolManager::Frame*> BufferPoolManager::FetchFrame(
+    PageId page_id, AccessHint hint) {
+  MaybeReadAhead(page_id, hint);
+
+  // Scan pages neither count as accesses nor take frames from the hot set.
+  const bool normal = hint == AccessHint::kNormal;
+  auto& shard = ShardFor(page_id);
+  if (Frame* frame = TryPinResident(shard, page_id, normal)) {
+    return frame;
+  }
+
+  std::unique_lock lock(shard.latch);
+
+  while (const auto resident = shard.page_table.Find(page_id)) {
+    const auto frame_id = *resident;
+    auto& frame = shard.frames[frame_id];
+    if (frame.io_in_progress.load(std::memory_order_acquire)) {
+      // Another fetch is reading this page in. Wait for its completion
+      // without the latch, then look the page up again: the read may have
+      // failed and released the frame.
+      lock.unlock();
+      frame.io_in_progress.wait(true, std::memory_order_acquire);
+      lock.lock();
+      continue;
+    }
+    // Frames reachable from the page table are never claimed outside the
+    // latch, so a plain increment is safe here.
+    frame.pin_count.fetch_add(1, std::memory_order_acquire);
+    if (normal) {
+      shard.replacer->RecordAccess(frame_id);
+      frame.prefetched.store(false, std::memory_order_relaxed);
+    }
+    return &frame;
+  }
+
+  auto victim_res = normal ? GetVictim(shard) : GetRingVictim(page_id);
+  if (!victim_res.ok()) {
+    return victim_res.status();
+  }
+  const auto frame_id = victim_res.value();
+  auto& victim_frame = shard.frames[frame_id];
+
+  // Publish the frame before the read so concurrent fetches of this page
+  // wait on it instead of issuing a second read, then drop the latch for
+  // the duration of the I/O.
+  victim_frame.io_in_progress.store(true, std::memory_order_relaxed);
+  Install(shard, frame_id, page_id, normal);
+
+  lock.unlock();
+  auto read = disk_manager_->ReadPageAsync(
       page_id, reinterpret_cast<char*>(victim_frame.page.data.data()));
+  const auto status = read.get();
+  CompleteRead(shard, frame_id, page_id, status);
+
   if (!status.ok()) {
-    victim_frame.page.id = kInvalidPageId;
-    victim_frame.pin_count = 0;
-    victim_frame.is_dirty = false;
-    ClearPage(victim_frame.page);
-    free_list_.emplace_front(frame_id);
     return status;
   }
+  return &victim_frame;
+}
+
+// Finishes a read issued without the shard latch into a frame installed
+// with io_in_progress set and one pin held by the reader. On failure the
+// frame goes back to the free list and the pin with it.
+void BufferPoolManager::CompleteRead(Shard& shard, frame_id_t frame_id,
+                                     PageId page_id, const Status& status) {
+  auto& frame = shard.frames[frame_id];
+  if (!status.ok()) {
+    std::scoped_lock lock(shard.latch);
+    shard.page_table.Erase(page_id);
+    // Only transient optimistic pins can be present besides ours, and they
+    // back off on seeing io_in_progress.
+    ClaimFrom(frame.pin_count, 1, kClaimed);
+    ResetFrame(shard, frame_id);
+  }
+  frame.io_in_progress.store(false, std::memory_order_release);
+  frame.io_in_progress.notify_all();
+}
 
-  victim_frame.page.id = page_id;
-  victim_frame.pin_count = 1;
-  victim_frame.is_dirty = false;
+Status BufferPoolManager::Prefetch(PageId first, size_t count) {
+  const PageId end =
+      std::min<PageId>(first + count, disk_manager_->page_count());
+
+  Status result;
+  PageId run_first = first;
+  std::vector<Frame*> run;
+  auto flush_run = [&] {
+    if (!run.empty()) {
+      auto status = ReadRun(run_first, run);
+      if (!status.ok() && result.ok()) {
+        result = status;
+      }
+      run.clear();
+    }
+  };
+
+  for (PageId page_id = first; page_id < end; ++page_id) {
+    auto& shard = ShardFor(page_id);
+    std::unique_lock lock(shard.latch);
+    if (shard.page_table.Find(page_id)) {
+      lock.unlock();
+      flush_run();
+      continue;
+    }
 
-  page_table_[page_id] = frame_id;
+    auto victim_res = GetVictim(shard, /*prefetch=*/true);
+    if (!victim_res.ok()) {
+      break;
+    }
+    const auto frame_id = victim_res.value();
+    auto& frame = shard.frames[frame_id];
+    frame.io_in_progress.store(true, std::memory_order_relaxed);
+    Install(shard, frame_id, page_id);
+    frame.prefetched.store(true, std::memory_order_relaxed);
+    shard.prefetched.push_back(frame_id);
+    lock.unlock();
+
+    if (run.empty()) {
+      run_first = page_id;
+    }
+    run.push_back(&frame);
+  }
+  flush_run();
 
-  return &victim_frame.page;
+  return result;
 }
 
-Status BufferPoolManager::UnpinPage(PageId page_id, bool is_dirty) {
-  std::scoped_lock lock(latch_);
+// Reads consecutive pages starting at `first` into frames Prefetch has
+// installed, then completes each frame and drops Prefetch's pin.
+Status BufferPoolManager::ReadRun(PageId first,
+                                  const std::vector<Frame*>& frames) {
+  std::vector<char*> buffers;
+  buffers.reserve(frames.size());
+  for (Frame* frame : frames) {
+    buffers.push_back(reinterpret_cast<char*>(frame->page.data.data()));
+  }
+  const auto status = disk_manager_->ReadPages(first, buffers);
+
+  for (size_t i = 0; i < frames.size(); ++i) {
+    const PageId page_id = first + i;
+    auto& shard = ShardFor(page_id);
+    const auto frame_id = static_cast<frame_id_t>(frames[i] - shard.frames);
+    CompleteRead(shard, frame_id, page_id, status);
+    if (status.ok()) {
+      frames[i]->pin_count.fetch_sub(1, std::memory_order_release);
+    }
+  }
+  return status;
+}
 
-  if (page_table_.count(page_id) == 0) {
-    return Status::Internal("page not in buffer pool");
+// Tracks each thread's fetches and, once they form an ascending run, reads
+// the next read_ahead_pages_ pages in one batch whenever the scan reaches
+// the end of what was read ahead last time. A kSequential hint skips the
+// detection; kOneShot fetches never read ahead.
+void BufferPoolManager::MaybeReadAhead(PageId page_id, AccessHint hint) {
+  if (read_ahead_pages_ == 0 || hint == AccessHint::kOneShot) {
+    return;
   }
 
-  const auto frame_id = page_table_[page_id];
-  auto& frame = frames_[frame_id];
+  auto& state = StateFor(id_);
+  if (page_id == state.last) {
+    return;
+  }
+  state.run = page_id == state.last + 1 ? state.run + 1 : 1;
+  state.last = page_id;
+  if (state.run == 1) {
+    state.read_ahead_end = 0;
+  }
 
-  if (frame.pin_count <= 0) {
-    return Status::Internal("unpinning a page with pin count 0");
+  const bool sequential =
+      hint == AccessHint::kSequential || state.run >= kSequentialRun;
+  if (sequential && page_id >= state.read_ahead_end) {
+    state.read_ahead_end = page_id + read_ahead_pages_;
+    // Best effort: a failed read surfaces again on the demand fetch.
+    static_cast<void>(Prefetch(page_id, read_ahead_pages_));
   }
+}
 
-  frame.pin_count--;
-  if (is_dirty) {
-    frame.is_dirty = true;
+Status BufferPoolManager::UnpinPage(PageId page_id, bool is_dirty) {
+  auto& shard = ShardFor(page_id);
+
+  // The caller's pin keeps the mapping in place, so the lock-free lookup is
+  // exact unless it races with a table rebuild; retry that under the latch.
+  auto frame_id = shard.page_table.Find(page_id);
+  if (!frame_id) {
+    std::scoped_lock lock(shard.latch);
+    frame_id = shard.page_table.Find(page_id);
+  }
+  if (!frame_id) {
+    return Status::Internal("page not in buffer pool");
   }
 
-  if (frame.pin_count == 0) {
-    replacer_.emplace_front(frame_id);
+  auto& frame = shard.frames[*frame_id];
+  if (is_dirty) {
+    frame.is_dirty.store(true, std::memory_order_relaxed);
   }
 
+  int pins = frame.pin_count.load(std::memory_order_relaxed);
+  do {
+    if (pins <= 0) {
+      return Status::Internal("unpinning a page with pin count 0");
+    }
+  } while (!frame.pin_count.compare_exchange_weak(
+      pins, pins - 1, std::memory_order_release, std::memory_order_relaxed));
+
   return Status::OK();
 }
 
 Status BufferPoolManager::FlushPage(PageId page_id) {
-  std::scoped_lock lock(latch_);
+  auto& shard = ShardFor(page_id);
+  frame_id_t frame_id;
+  {
+    std::scoped_lock lock(shard.latch);
+
+    const auto resident = shard.page_table.Find(page_id);
+    if (!resident) {
+      return Status::Internal("page not in buffer pool");
+    }
 
-  if (page_table_.count(page_id) == 0) {
-    return Status::Internal("page not in buffer pool");
-  }
+    frame_id = *resident;
+    auto& frame = shard.frames[frame_id];
 
-  const auto frame_id = page_table_[page_id];
-  auto& frame = frames_[frame_id];
+    // A page still being read in has nothing newer than the disk copy.
+    if (frame.io_in_progress.load(std::memory_order_acquire)) {
+      return Status::OK();
+    }
 
-  auto status =
-      disk_manager_->WritePage(frame.page.id, reinterpret_cast<char*>(frame.page.data.data()));
-  if (status.ok()) {
-    frame.is_dirty = false;
+    PinForWriteBack(frame);
   }
 
-  return status;
+  return WriteBack({&shard.frames[frame_id]});
 }
 
 Result<Page*> BufferPoolManager::NewPage() {
-  std::scoped_lock lock(latch_);
-
-  auto victim_res = GetVictim();
-  if (!victim_res.ok()) {
-    return victim_res.status();
-  }
-  const auto frame_id = victim_res.value();
-  auto& new_frame = frames_[frame_id];
-  if (new_frame.page.id != kInvalidPageId) {
-    if (new_frame.is_dirty) {
-      auto status = disk_manager_->WritePage(
-          new_frame.page.id,
-          reinterpret_cast<char*>(new_frame.page.data.data()));
-      if (!status.ok()) {
-        replacer_.emplace_front(frame_id);
-        return status;
-      }
-    }
-    page_table_.erase(new_frame.page.id);
+  auto frame_res = NewFrame();
+  if (!frame_res.ok()) {
+    return frame_res.status();
   }
+  return &frame_res.value()->page;
+}
 
+Result<BufferPoolManager::Frame*> BufferPoolManager::NewFrame() {
+  // The page id decides the shard, so it has to be allocated first. If the
+  // shard then has no frame to give, the allocation is undone.
+  const size_t pages_before = disk_manager_->page_count();
   auto page_id_res = disk_manager_->AllocatePage();
   if (!page_id_res.ok()) {
-    // If we can't allocate a new page, put the frame back on the free list
-    new_frame.page.id = kInvalidPageId;
-    new_frame.pin_count = 0;
-    new_frame.is_dirty = false;
-    ClearPage(new_frame.page);
-    free_list_.emplace_front(frame_id);
     return page_id_res.status();
   }
   const auto page_id = page_id_res.value();
-  
-  new_frame.page.id = page_id;
-  new_frame.pin_count = 1;
-  new_frame.is_dirty = false;
+
+  auto& shard = ShardFor(page_id);
+  std::scoped_lock lock(shard.latch);
+
+  auto victim_res = GetVictim(shard);
+  if (!victim_res.ok()) {
+    // Best effort: the out-of-frames error is the one worth reporting. A
+    // page from past the old end of the file was not taken from the
+    // free-page map, so the file shrinks back instead.
+    if (disk_manager_->DeallocatePage(page_id).ok() &&
+        page_id >= pages_before) {
+      static_cast<void>(disk_manager_->TruncateFreeTail());
+    }
+    return victim_res.status();
+  }
+  const auto frame_id = victim_res.value();
+  auto& new_frame = shard.frames[frame_id];
+
   ClearPage(new_frame.page);
-  
-  page_table_[page_id] = frame_id;
+  Install(shard, frame_id, page_id);
 
-  return &new_frame.page;
+  return &new_frame;
 }
 
 Status BufferPoolManager::DeletePage(PageId page_id) {
-  static_cast<void>(page_id);
-  return Status::Unimplemented("DeletePage not implemented");
+  auto& shard = ShardFor(page_id);
+  // Deallocating under the latch keeps the page from being fetched back in
+  // before the free-page map has it.
+  std::unique_lock lock(shard.latch);
+
+  auto resident = shard.page_table.Find(page_id);
+  while (resident) {
+    auto& frame = shard.frames[*resident];
+    // Write-backs only start under the latch, so this can only drop while
+    // it is held.
+    const int write_backs = frame.write_backs.load(std::memory_order_acquire);
+    int unpinned = 0;
+    if (frame.pin_count.compare_exchange_strong(unpinned, kClaimed,
+                                                std::memory_order_acquire,
+                                                std::memory_order_relaxed)) {
+      break;
+    }
+    if (write_backs == 0) {
+      return Status::Internal("cannot delete a pinned page");
+    }
+    // A flush or the page cleaner is writing the page out. Its pin goes
+    // away with the write, so wait for that and look the page up again.
+    lock.unlock();
+    frame.write_backs.wait(write_backs, std::memory_order_acquire);
+    lock.lock();
+    resident = shard.page_table.Find(page_id);
+  }
+
+  const auto status = disk_manager_->DeallocatePage(page_id);
+  if (resident) {
+    if (!status.ok()) {
+      shard.frames[*resident].pin_count.store(0, std::memory_order_release);
+      return status;
+    }
+    // The page's contents, dirty or not, die with it.
+    shard.page_table.Erase(page_id);
+    ResetFrame(shard, *resident);
+  }
+  if (status.ok() && log_manager_ != nullptr) {
+    log_manager_->NotePageFreed(page_id);
+  }
+  return status;
 }
 
+// Collects the dirty frames of every shard, each shard latched only while it
+// is scanned, and writes them back together so that pages adjacent on disk
+// go out in one write regardless of the shard they live in.
 Status BufferPoolManager::FlushAllPages() {
-  std::scoped_lock lock(latch_);
-  for (auto const& [page_id, frame_id] : page_table_) {
-    auto& frame = frames_[frame_id];
-    if (frame.is_dirty) {
-      auto status = disk_manager_->WritePage(
-          frame.page.id, reinterpret_cast<char*>(frame.page.data.data()));
-      if (status.ok()) {
-        frame.is_dirty = false;
-      } else {
-        return status;
+  std::vector<Frame*> dirty;
+  for (auto& shard : shards_) {
+    std::scoped_lock lock(shard->latch);
+    shard->page_table.ForEach([&](PageId, frame_id_t frame_id) {
+      auto& frame = shard->frames[frame_id];
+      if (frame.is_dirty.load(std::memory_order_relaxed)) {
+        PinForWriteBack(frame);
+        dirty.push_back(&frame);
+      }
+    });
+  }
+
+  return WriteBack(std::move(dirty));
+}
+
+// Pins a resident frame for WriteBack and marks it clean. Caller holds the
+// frame's shard latch.
+void BufferPoolManager::PinForWriteBack(Frame& frame) {
+  frame.pin_count.fetch_add(1, std::memory_order_acquire);
+  frame.write_backs.fetch_add(1, std::memory_order_relaxed);
+  frame.is_dirty.store(false, std::memory_order_relaxed);
+}
+
+// Writes out frames pinned with PinForWriteBack, in page id
+// order, kWriteBackBatch pages at a time. A batch is copied out under the
+// frames' shared latches, so a write guard waits for a memcpy rather than
+// for the disk, and then goes to the disk manager as one WriteBatch: one
+// vectored write per run of consecutive ids, and a single double-write
+// round when that is enabled. Clearing the dirty bit before the copy means
+// a modification that races with it re-dirties the frame rather than being
+// lost. Failed frames are re-marked dirty; all frames are unpinned.
+Status BufferPoolManager::WriteBack(std::vector<Frame*> frames) {
+  std::sort(frames.begin(), frames.end(), [](const Frame* a, const Frame* b) {
+    return a->page.id < b->page.id;
+  });
+
+  // Page-aligned, so the copies can go to an O_DIRECT file as they are.
+  std::vector<PageImage> staging(std::min(frames.size(), kWriteBackBatch));
+  std::vector<PageWrite> writes;
+  Status result;
+  for (size_t begin = 0; begin < frames.size(); begin += kWriteBackBatch) {
+    const size_t end = std::min(begin + kWriteBackBatch, frames.size());
+
+    writes.clear();
+    Lsn max_lsn = kInvalidLsn;
+    for (size_t i = begin; i < end; ++i) {
+      auto& image = staging[i - begin].bytes;
+      {
+        std::shared_lock frame_lock(frames[i]->latch);
+        std::memcpy(image.data(), frames[i]->page.data.data(), kPageSize);
+      }
+      max_lsn = std::max(max_lsn, PageLsn(image));
+      writes.push_back({frames[i]->page.id,
+                        reinterpret_cast<const char*>(image.data())});
+    }
+
+    // Write-ahead: the images' log records go to disk first.
+    auto status = FlushLogFor(max_lsn);
+    if (status.ok()) {
+      status = disk_manager_->WriteBatch(writes);
+    }
+    for (size_t i = begin; i < end; ++i) {
+      if (!status.ok()) {
+        frames[i]->is_dirty.store(true, std::memory_order_relaxed);
+      } else if (log_manager_ != nullptr) {
+        log_manager_->NotePageWritten(frames[i]->page.id,
+                                      PageLsn(staging[i - begin].bytes));
       }
+      frames[i]->pin_count.fetch_sub(1, std::memory_order_release);
+      frames[i]->write_backs.fetch_sub(1, std::memory_order_release);
+      frames[i]->write_backs.notify_all();
+    }
+    if (!status.ok() && result.ok()) {
+      result = status;
     }
   }
-  return Status::OK();
+  return result;
+}
+
+size_t BufferPoolManager::ShardIndex(PageId page_id) const {
+  if (shards_.size() == 1) {
+    return 0;
+  }
+  // Fibonacci hashing spreads both sequential and strided ids evenly.
+  const PageId mixed = page_id * 0x9E3779B97F4A7C15ULL;
+  return (mixed >> 32) % shards_.size();
+}
+
+BufferPoolManager::Shard& BufferPoolManager::ShardFor(PageId page_id) {
+  return *shards_[ShardIndex(page_id)];
 }
 
-Result<BufferPoolManager::frame_id_t> BufferPoolManager::GetVictim() {
-  if (!free_list_.empty()) {
-    auto frame_id = free_list_.front();
-    free_list_.pop_front();
+// Returns a claimed frame of `shard` that holds no page: a free one if
+// possible, otherwise the replacer's victim, written back first if dirty.
+// For `prefetch`, the victim is instead the oldest unpinned frame filled by
+// read-ahead. Caller holds shard.latch.
+Result<frame_id_t> BufferPoolManager::GetVictim(Shard& shard, bool prefetch) {
+  if (!shard.free_list.empty()) {
+    auto frame_id = shard.free_list.front();
+    shard.free_list.pop_front();
+    ClaimFrom(shard.frames[frame_id].pin_count, 0, kClaimed);
     return frame_id;
   }
 
-  if (replacer_.empty()) {
+  if (prefetch) {
+    const auto victim = TakePrefetched(shard);
+    if (!victim) {
+      return Status::Internal("out of memory");
+    }
+    return Evacuate(shard, *victim);
+  }
+
+  // Frames with lock-free hits are skipped, and their hits replayed into
+  // the replacer once the sweep is over; it cannot take them during one.
+  std::vector<std::pair<frame_id_t, std::uint32_t>> replay;
+  const auto victim = shard.replacer->Evict([&](frame_id_t frame_id) {
+    auto& frame = shard.frames[frame_id];
+    if (const auto hits = frame.hits.exchange(0, std::memory_order_relaxed);
+        hits != 0) {
+      replay.emplace_back(frame_id, hits);
+      return false;
+    }
+    int unpinned = 0;
+    return frame.pin_count.compare_exchange_strong(
+        unpinned, kClaimed, std::memory_order_acquire,
+        std::memory_order_relaxed);
+  });
+  for (const auto& [frame_id, hits] : replay) {
+    // A frame skipped on the first pass can still be taken on the second.
+    if (frame_id == victim) {
+      continue;
+    }
+    for (std::uint32_t i = 0; i < hits; ++i) {
+      shard.replacer->RecordAccess(frame_id);
+    }
+  }
+  if (!victim) {
     return Status::Internal("out of memory");
   }
+  return Evacuate(shard, *victim);
+}
 
-  // The replacer stores pages in MRU order, so the LRU is at the back
-  auto frame_id = replacer_.back();
-  replacer_.pop_back();
+// Empties a claimed frame that still holds its page: writes the page back if
+// dirty and unmaps it. On a failed write the claim is dropped and the frame
+// stays resident. Caller holds shard.latch.
+Result<frame_id_t> BufferPoolManager::Evacuate(Shard& shard,
+                                               frame_id_t frame_id) {
+  auto& frame = shard.frames[frame_id];
+  if (frame.is_dirty.load(std::memory_order_relaxed)) {
+    // The cleaner has fallen behind; this miss pays for a write.
+    WakeCleaner();
+    auto status = FlushLogFor(PageLsn(frame.page.data));
+    if (status.ok()) {
+      status = disk_manager_->WritePage(
+          frame.page.id, reinterpret_cast<const char*>(frame.page.data.data()));
+    }
+    if (!status.ok()) {
+      frame.pin_count.store(0, std::memory_order_release);
+      shard.replacer->SetEvictable(frame_id, true);
+      return status;
+    }
+    if (log_manager_ != nullptr) {
+      log_manager_->NotePageWritten(frame.page.id, PageLsn(frame.page.data));
+    }
+    frame.is_dirty.store(false, std::memory_order_relaxed);
+  }
+  shard.page_table.Erase(frame.page.id);
+  // The frame's history belongs to the page leaving it.
+  shard.replacer->Remove(frame_id);
 
   return frame_id;
 }
 
+// Victim selection for kSequential/kOneShot misses. Until this thread's
+// ring for the shard is full, frames come from GetVictim and join the ring;
+// after that the ring's next frame is reused, unless it is pinned or
+// somebody else has touched its page since, in which case it is left to the
+// pool and replaced in the ring by a fresh victim. Caller holds the latch
+// of page_id's shard.
+Result<frame_id_t> BufferPoolManager::GetRingVictim(PageId page_id) {
+  const size_t index = ShardIndex(page_id);
+  auto& shard = *shards_[index];
+  auto& state = StateFor(id_);
+  if (state.rings.size() != shards_.size()) {
+    state.rings.resize(shards_.size());
+  }
+  auto& ring = state.rings[index];
+  const size_t capacity = std::clamp<size_t>(
+      ring_frames_ / shards_.size(), 1, std::max<size_t>(1, shard.size / 4));
+
+  if (ring.slots.size() < capacity) {
+    auto victim_res = GetVictim(shard);
+    if (victim_res.ok()) {
+      ring.slots.emplace_back(victim_res.value(), page_id);
+    }
+    return victim_res;
+  }
+
+  auto& [frame_id, held] = ring.slots[ring.next];
+  ring.next = (ring.next + 1) % ring.slots.size();
+
+  auto& frame = shard.frames[frame_id];
+  int unpinned = 0;
+  if (frame.page.id == held &&
+      frame.hits.load(std::memory_order_relaxed) == 0 &&
+      frame.pin_count.compare_exchange_strong(unpinned, kClaimed,
+                                              std::memory_order_acquire,
+                                              std::memory_order_relaxed)) {
+    auto victim_res = Evacuate(shard, frame_id);
+    if (victim_res.ok()) {
+      held = page_id;
+    }
+    return victim_res;
+  }
+
+  auto victim_res = GetVictim(shard);
+  if (victim_res.ok()) {
+    frame_id = victim_res.value();
+    held = page_id;
+  }
+  return victim_res;
+}
+
+void BufferPoolManager::WakeCleaner() {
+  if (!cleaner_.joinable()) {
+    return;
+  }
+  {
+    std::scoped_lock lock(cleaner_mutex_);
+    cleaner_wake_ = true;
+  }
+  cleaner_cv_.notify_one();
+}
+
+void BufferPoolManager::CleanerLoop() {
+  std::unique_lock lock(cleaner_mutex_);
+  while (!cleaner_stop_) {
+    cleaner_cv_.wait_for(lock, cleaner_interval_,
+                         [this] { return cleaner_stop_ || cleaner_wake_; });
+    if (cleaner_stop_) {
+      break;
+    }
+    cleaner_wake_ = false;
+    lock.unlock();
+    for (auto& shard : shards_) {
+      // A failed write leaves the page dirty; the next round or the miss
+      // that evicts it retries and reports the error.
+      static_cast<void>(CleanShard(*shard));
+    }
+    lock.lock();
+  }
+}
+
+// One cleaner pass over a shard. Walks the replacer's candidates from the
+// eviction end, counting free and clean unpinned frames and collecting
+// dirty ones, and writes the dirty ones back only if the clean count is
+// under the low watermark.
+Status BufferPoolManager::CleanShard(Shard& shard) {
+  const auto low = static_cast<size_t>(clean_low_watermark_ * shard.size);
+  const auto high = std::max(
+      low, static_cast<size_t>(clean_high_watermark_ * shard.size));
+
+  std::vector<frame_id_t> dirty;
+  std::vector<Frame*> frames;
+  {
+    std::scoped_lock lock(shard.latch);
+    size_t clean = shard.free_list.size();
+    if (clean >= low) {
+      return Status::OK();
+    }
+    shard.replacer->ForEachCandidate([&](frame_id_t frame_id) {
+      auto& frame = shard.frames[frame_id];
+      if (frame.pin_count.load(std::memory_order_relaxed) != 0 ||
+          frame.io_in_progress.load(std::memory_order_relaxed)) {
+        return true;
+      }
+      if (frame.is_dirty.load(std::memory_order_relaxed)) {
+        dirty.push_back(frame_id);
+      } else {
+        ++clean;
+      }
+      return clean + dirty.size() < high && dirty.size() < cleaner_batch_;
+    });
+    if (clean >= low) {
+      return Status::OK();
+    }
+
+    for (const auto frame_id : dirty) {
+      auto& frame = shard.frames[frame_id];
+      PinForWriteBack(frame);
+      frames.push_back(&frame);
+    }
+  }
+
+  return WriteBack(std::move(frames));
+}
+
+// Claims the oldest unpinned frame on shard.prefetched. Pinned ones rotate
+// to the back; stale entries, and frames a kNormal fetch has hit since,
+// are dropped. Caller holds shard.latch.
+std::optional<frame_id_t> BufferPoolManager::TakePrefetched(Shard& shard) {
+  for (size_t tries = shard.prefetched.size(); tries > 0; --tries) {
+    const auto frame_id = shard.prefetched.front();
+    shard.prefetched.pop_front();
+    auto& frame = shard.frames[frame_id];
+    if (!frame.prefetched.load(std::memory_order_relaxed)) {
+      continue;
+    }
+    int unpinned = 0;
+    if (frame.pin_count.compare_exchange_strong(unpinned, kClaimed,
+                                                std::memory_order_acquire,
+                                                std::memory_order_relaxed)) {
+      // Checked again now that the claim orders it after the last unpin: a
+      // lock-free hit may have cleared the flag just before releasing.
+      if (frame.prefetched.load(std::memory_order_relaxed)) {
+        return frame_id;
+      }
+      frame.pin_count.store(0, std::memory_order_release);
+      continue;
+    }
+    shard.prefetched.push_back(frame_id);
+  }
+  return std::nullopt;
+}
+
+// Points a claimed frame at `page_id`, maps it and hands it to the caller
+// with a single pin. Without `record_access` the page starts out as the
+// replacer's coldest. Caller holds shard.latch.
+void BufferPoolManager::Install(Shard& shard, frame_id_t frame_id,
+                                PageId page_id, bool record_access) {
+  auto& frame = shard.frames[frame_id];
+  frame.page.id = page_id;
+  frame.is_dirty.store(false, std::memory_order_relaxed);
+  frame.hits.store(0, std::memory_order_relaxed);
+  frame.prefetched.store(false, std::memory_order_relaxed);
+  // Sized for every frame of the shard, so there is always room.
+  static_cast<void>(shard.page_table.Insert(page_id, frame_id));
+  if (record_access) {
+    shard.replacer->RecordAccess(frame_id);
+  }
+  shard.replacer->SetEvictable(frame_id, true);
+  frame.pin_count.store(1, std::memory_order_release);
+}
+
+// Returns a claimed frame to the free list. Caller holds shard.latch.
+void BufferPoolManager::ResetFrame(Shard& shard, frame_id_t frame_id) {
+  auto& frame = shard.frames[frame_id];
+  frame.page.id = kInvalidPageId;
+  frame.is_dirty.store(false, std::memory_order_relaxed);
+  frame.prefetched.store(false, std::memory_order_relaxed);
+  ClearPage(frame.page);
+  shard.replacer->Remove(frame_id);
+  shard.free_list.emplace_front(frame_id);
+  frame.pin_count.store(0, std::memory_order_release);
+}
+
+// Makes the log durable up to `lsn` ahead of writing a page stamped with
+// it. A no-op without a log manager.
+Status BufferPoolManager::FlushLogFor(Lsn lsn) {
+  if (log_manager_ == nullptr || lsn == kInvalidLsn) {
+    return Status::OK();
+  }
+  return log_manager_->Flush(lsn);
+}
+
 }  // namespace simpledb
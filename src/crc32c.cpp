@@ -0,0 +1,195 @@
+#include "simpledb/crc32c.h"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace simpledb {
+
+namespace {
+
+// Bit-reversed Castagnoli polynomial.
+constexpr std::uint32_t kPolynomial = 0x82f63b78;
+
+using Table = std::array<std::uint32_t, 256>;
+
+// Slicing-by-8: tables[k][n] is the CRC of byte n followed by k zero bytes.
+constexpr std::array<Table, 8> MakeSlicingTables() {
+  std::array<Table, 8> tables{};
+  for (std::uint32_t n = 0; n < 256; ++n) {
+    std::uint32_t crc = n;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc & 1) != 0 ? (crc >> 1) ^ kPolynomial : crc >> 1;
+    }
+    tables[0][n] = crc;
+  }
+  for (std::size_t k = 1; k < 8; ++k) {
+    for (std::size_t n = 0; n < 256; ++n) {
+      const std::uint32_t prev = tables[k - 1][n];
+      tables[k][n] = (prev >> 8) ^ tables[0][prev & 0xff];
+    }
+  }
+  return tables;
+}
+
+constexpr std::array<Table, 8> kSlicing = MakeSlicingTables();
+
+// The hardware path runs three independent crc32 streams over adjacent
+// kStride-byte blocks, which hides the instruction's latency, and then
+// folds them together. Folding a stream's CRC past the kStride bytes that
+// follow it is a linear map over GF(2), applied a byte at a time through
+// the kShift tables.
+constexpr std::size_t kStride = 256;
+
+using Matrix = std::array<std::uint32_t, 32>;
+
+constexpr std::uint32_t MatrixTimes(const Matrix& matrix, std::uint32_t vec) {
+  std::uint32_t sum = 0;
+  for (std::size_t i = 0; vec != 0; ++i, vec >>= 1) {
+    if ((vec & 1) != 0) {
+      sum ^= matrix[i];
+    }
+  }
+  return sum;
+}
+
+constexpr Matrix MatrixSquare(const Matrix& matrix) {
+  Matrix square{};
+  for (std::size_t i = 0; i < 32; ++i) {
+    square[i] = MatrixTimes(matrix, matrix[i]);
+  }
+  return square;
+}
+
+// The map that appends `bytes` zero bytes to a CRC register; `bytes` is a
+// power of two.
+constexpr Matrix ZerosOperator(std::size_t bytes) {
+  Matrix op{};
+  op[0] = kPolynomial;
+  for (std::size_t i = 1; i < 32; ++i) {
+    op[i] = std::uint32_t{1} << (i - 1);
+  }
+  // One zero bit, squared up to one zero byte, then to `bytes` of them.
+  for (int i = 0; i < 3; ++i) {
+    op = MatrixSquare(op);
+  }
+  for (std::size_t n = bytes; n > 1; n >>= 1) {
+    op = MatrixSquare(op);
+  }
+  return op;
+}
+
+constexpr std::array<Table, 4> MakeShiftTables(std::size_t bytes) {
+  const Matrix op = ZerosOperator(bytes);
+  std::array<Table, 4> tables{};
+  for (std::uint32_t n = 0; n < 256; ++n) {
+    for (std::size_t k = 0; k < 4; ++k) {
+      tables[k][n] = MatrixTimes(op, n << (8 * k));
+    }
+  }
+  return tables;
+}
+
+static_assert(std::has_single_bit(kStride));
+constexpr std::array<Table, 4> kShift = MakeShiftTables(kStride);
+
+[[maybe_unused]] std::uint32_t Shift(std::uint32_t crc) {
+  return kShift[0][crc & 0xff] ^ kShift[1][(crc >> 8) & 0xff] ^
+         kShift[2][(crc >> 16) & 0xff] ^ kShift[3][crc >> 24];
+}
+
+std::uint64_t Load64(const unsigned char* bytes) {
+  std::uint64_t word;
+  std::memcpy(&word, bytes, sizeof(word));
+  return word;
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("sse4.2"))) std::uint32_t Crc32cHardware(
+    const void* data, std::size_t size, std::uint32_t crc) {
+  const auto* next = static_cast<const unsigned char*>(data);
+  std::uint64_t crc0 = ~crc;
+  while (size >= 3 * kStride) {
+    std::uint64_t crc1 = 0;
+    std::uint64_t crc2 = 0;
+    const unsigned char* const end = next + kStride;
+    do {
+      crc0 = _mm_crc32_u64(crc0, Load64(next));
+      crc1 = _mm_crc32_u64(crc1, Load64(next + kStride));
+      crc2 = _mm_crc32_u64(crc2, Load64(next + 2 * kStride));
+      next += 8;
+    } while (next < end);
+    crc0 = Shift(static_cast<std::uint32_t>(crc0)) ^ crc1;
+    crc0 = Shift(static_cast<std::uint32_t>(crc0)) ^ crc2;
+    next += 2 * kStride;
+    size -= 3 * kStride;
+  }
+  for (; size >= 8; size -= 8, next += 8) {
+    crc0 = _mm_crc32_u64(crc0, Load64(next));
+  }
+  for (; size > 0; --size, ++next) {
+    crc0 = _mm_crc32_u8(static_cast<std::uint32_t>(crc0), *next);
+  }
+  return ~static_cast<std::uint32_t>(crc0);
+}
+
+#endif
+
+using Crc32cFunction = std::uint32_t (*)(const void*, std::size_t,
+                                         std::uint32_t);
+
+Crc32cFunction SelectImplementation() {
+#if defined(__x86_64__)
+  if (__builtin_cpu_supports("sse4.2")) {
+    return Crc32cHardware;
+  }
+#endif
+  return Crc32cPortable;
+}
+
+// Chosen on first use rather than during static initialization, which
+// another translation unit's initializers may precede.
+Crc32cFunction Implementation() {
+  static const Crc32cFunction implementation = SelectImplementation();
+  return implementation;
+}
+
+}  // namespace
+
+std::uint32_t Crc32c(const void* data, std::size_t size, std::uint32_t crc) {
+  return Implementation()(data, size, crc);
+}
+
+std::uint32_t Crc32cPortable(const void* data, std::size_t size,
+                             std::uint32_t crc) {
+  const auto* next = static_cast<const unsigned char*>(data);
+  crc = ~crc;
+  if constexpr (std::endian::native == std::endian::little) {
+    for (; size >= 8; size -= 8, next += 8) {
+      const std::uint64_t word = Load64(next) ^ crc;
+      crc = kSlicing[7][word & 0xff] ^ kSlicing[6][(word >> 8) & 0xff] ^
+            kSlicing[5][(word >> 16) & 0xff] ^
+            kSlicing[4][(word >> 24) & 0xff] ^
+            kSlicing[3][(word >> 32) & 0xff] ^
+            kSlicing[2][(word >> 40) & 0xff] ^
+            kSlicing[1][(word >> 48) & 0xff] ^ kSlicing[0][word >> 56];
+    }
+  }
+  for (; size > 0; --size, ++next) {
+    crc = kSlicing[0][(crc ^ *next) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+bool Crc32cHardwareAccelerated() {
+  return Implementation() != Crc32cPortable;
+}
+
+}  // namespace simpledb
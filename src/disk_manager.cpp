@@ -1,134 +1,1060 @@
 #include "simpledb/disk_manager.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <climits>
+#include <cstring>
 #include <filesystem>
-#include <fstream>
+#include <future>
+#include <memory>
 #include <utility>
+#include <vector>
 
+#include "simpledb/crc32c.h"
 #include "simpledb/page.h"
 #include "simpledb/status.h"
 
 namespace simpledb {
 
-DiskManager::~DiskManager() {
-  if (file_.is_open()) {
-    file_.close();
+namespace {
+
+off_t PageOffset(PageId id) { return static_cast<off_t>(id * kPageSize); }
+
+// Free-page map layout: each bitmap page covers kPageSize * 8 data pages.
+constexpr std::size_t kBitsPerWord = 64;
+constexpr std::size_t kWordsPerMapPage = kPageSize / sizeof(std::uint64_t);
+constexpr std::size_t kPagesPerMapPage = kWordsPerMapPage * kBitsPerWord;
+
+int AdviceFlag(MmapAdvice advice) {
+  switch (advice) {
+    case MmapAdvice::kNormal:
+      return MADV_NORMAL;
+    case MmapAdvice::kSequential:
+      return MADV_SEQUENTIAL;
+    case MmapAdvice::kRandom:
+      return MADV_RANDOM;
+    case MmapAdvice::kWillNeed:
+      return MADV_WILLNEED;
   }
+  return MADV_NORMAL;
 }
 
-Status DiskManager::Open(const std::filesystem::path& path) {
-  if (file_.is_open()) {
-    file_.close();
+// Double-write file: this header page, then the batch's page images in
+// entry order.
+constexpr std::uint64_t kDoubleWriteMagic = 0x6574697277656c64ULL;
+constexpr std::size_t kMaxDoubleWritePages = 255;
+
+struct DoubleWriteHeader {
+  std::uint64_t magic;
+  std::uint32_t count;
+  // CRC-32C of the entries.
+  std::uint32_t checksum;
+  struct Entry {
+    std::uint64_t page_id;
+    // Of the page image.
+    std::uint32_t checksum;
+    std::uint32_t reserved;
+  } entries[kMaxDoubleWritePages];
+};
+static_assert(sizeof(DoubleWriteHeader) <= kPageSize);
+
+std::size_t MapPagesFor(std::size_t pages) {
+  return (pages + kPagesPerMapPage - 1) / kPagesPerMapPage;
+}
+
+// pread/pwrite may transfer fewer bytes than asked or be interrupted; keep
+// going until the whole range is done or a real error occurs.
+bool PreadFull(int fd, char* data, std::size_t size, off_t offset) {
+  while (size > 0) {
+    const ssize_t n = ::pread(fd, data, size, offset);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    size -= static_cast<std::size_t>(n);
+    offset += n;
   }
+  return true;
+}
 
-  path_ = path;
+bool PwriteFull(int fd, const char* data, std::size_t size, off_t offset) {
+  while (size > 0) {
+    const ssize_t n = ::pwrite(fd, data, size, offset);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    size -= static_cast<std::size_t>(n);
+    offset += n;
+  }
+  return true;
+}
 
-  if (!std::filesystem::exists(path_)) {
-    std::ofstream create(path_, std::ios::binary | std::ios::trunc);
-    if (!create) {
-      return Status::IoError("failed to create database file");
+// Drives preadv/pwritev over an iovec array, advancing past partially
+// transferred entries and splitting batches larger than IOV_MAX.
+template <typename VectorIo>
+bool VectoredFull(std::vector<iovec>& iov, off_t offset, VectorIo io) {
+  std::size_t index = 0;
+  while (index < iov.size()) {
+    const int batch =
+        static_cast<int>(std::min<std::size_t>(iov.size() - index, IOV_MAX));
+    const ssize_t n = io(iov.data() + index, batch, offset);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    offset += n;
+    auto remaining = static_cast<std::size_t>(n);
+    while (remaining > 0) {
+      auto& entry = iov[index];
+      if (remaining >= entry.iov_len) {
+        remaining -= entry.iov_len;
+        ++index;
+      } else {
+        entry.iov_base = static_cast<char*>(entry.iov_base) + remaining;
+        entry.iov_len -= remaining;
+        remaining = 0;
+      }
     }
   }
+  return true;
+}
+
+}  // namespace
+
+DiskManager::~DiskManager() { Close(); }
 
-  file_.open(path_, std::ios::in | std::ios::out | std::ios::binary);
-  if (!file_) {
+Status DiskManager::Open(const std::filesystem::path& path,
+                         const DiskManagerOptions& options) {
+  Close();
+
+  path_ = path;
+
+  const int flags = O_RDWR | O_CREAT | O_CLOEXEC;
+  if (options.direct_io && options.backend != IoBackend::kMmap) {
+    fd_ = ::open(path_.c_str(), flags | O_DIRECT, 0644);
+    direct_io_ = fd_ >= 0;
+  }
+  if (fd_ < 0) {
+    fd_ = ::open(path_.c_str(), flags, 0644);
+  }
+  if (fd_ < 0) {
     return Status::IoError("failed to open database file");
   }
 
-  file_.seekg(0, std::ios::end);
-  const auto size = file_.tellg();
-  if (size < 0) {
+  // From here on, a failed Open closes whatever it has opened.
+  struct stat st {};
+  if (::fstat(fd_, &st) != 0) {
+    Close();
     return Status::IoError("failed to determine database size");
   }
 
-  if (size % static_cast<std::streamoff>(kPageSize) != 0) {
+  const auto size = static_cast<std::size_t>(st.st_size);
+  if (size % kPageSize != 0) {
+    Close();
     return Status::Internal("database file size is not page aligned");
   }
 
-  page_count_ = static_cast<std::size_t>(size) / kPageSize;
+  page_count_.store(size / kPageSize, std::memory_order_release);
+  reserved_pages_ = size / kPageSize;
+  extent_pages_ = std::max<std::size_t>(options.extent_pages, 1);
+  page_checksums_ = options.page_checksums;
+
+  const Status map_status = LoadFreeMap();
+  if (!map_status.ok()) {
+    Close();
+    return map_status;
+  }
+
+  double_write_pages_ = std::clamp<std::size_t>(options.double_write_pages, 1,
+                                                kMaxDoubleWritePages);
+  const Status repair_status = RepairFromDoubleWrite(options.double_write);
+  if (!repair_status.ok()) {
+    Close();
+    return repair_status;
+  }
+
+  if (options.backend == IoBackend::kIoUring) {
+    auto ring = IoUring::Create(options.io_queue_depth);
+    if (ring.ok()) {
+      ring_ = std::move(ring).value();
+    }
+  } else if (options.backend == IoBackend::kMmap) {
+    // Mapping past the end of the file is allowed; those pages only become
+    // accessible as the file grows into them.
+    const std::size_t bytes = options.mmap_bytes / kPageSize * kPageSize;
+    void* mapping = bytes == 0 ? MAP_FAILED
+                               : ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED,
+                                        fd_, 0);
+    if (mapping != MAP_FAILED) {
+      mapping_ = static_cast<std::byte*>(mapping);
+      mapping_bytes_ = bytes;
+      ::madvise(mapping_, mapping_bytes_, AdviceFlag(options.mmap_advice));
+    }
+  }
+
+  durability_ = options.durability;
+  sync_interval_ = std::max(options.sync_interval, std::chrono::milliseconds(1));
+  if (durability_ == Durability::kPeriodic) {
+    syncer_stop_ = false;
+    syncer_ = std::thread([this] { SyncerLoop(); });
+  }
   return Status::OK();
 }
 
-Result<PageId> DiskManager::AllocatePage() {
+Result<PageId> DiskManager::AllocatePage() { return AllocatePages(1); }
+
+Result<PageId> DiskManager::AllocatePages(std::size_t count) {
   const Status open_status = EnsureOpen();
   if (!open_status.ok()) {
     return open_status;
   }
+  if (count == 0) {
+    return Status::InvalidArgument("cannot allocate zero pages");
+  }
+
+  std::scoped_lock lock(allocation_latch_);
 
-  Page page;
-  page.id = static_cast<PageId>(page_count_);
-  ClearPage(page);
+  if (count == 1 && free_pages_ > 0) {
+    // Mark the page used on disk before handing it out: a crash in between
+    // leaks the page instead of letting two owners share it.
+    const PageId id = *LowestFree();
+    const std::size_t word = id / kBitsPerWord;
+    free_map_[word] &= ~(std::uint64_t{1} << (id % kBitsPerWord));
+    const std::size_t map_page = id / kPagesPerMapPage;
+    const Status status = WriteFreeMapPages(map_page, map_page + 1);
+    if (!status.ok()) {
+      free_map_[word] |= std::uint64_t{1} << (id % kBitsPerWord);
+      return status;
+    }
+    --free_pages_;
+    return id;
+  }
 
-  file_.seekp(0, std::ios::end);
-  file_.write(reinterpret_cast<const char*>(page.data.data()),
-              static_cast<std::streamsize>(page.data.size()));
+  const std::size_t first = page_count_.load(std::memory_order_relaxed);
+  const std::size_t end = first + count;
 
-  if (!file_) {
-    return Status::IoError("failed to write new page");
+  if (end > reserved_pages_) {
+    // Grow the file by whole extents, its disk space reserved in the same
+    // call. Filesystems without fallocate just get a sparse file. Either
+    // way the new pages read back as zeros.
+    const std::size_t reserve =
+        (end + extent_pages_ - 1) / extent_pages_ * extent_pages_;
+    if (::fallocate(fd_, 0, PageOffset(reserved_pages_),
+                    PageOffset(reserve - reserved_pages_)) != 0) {
+      if (errno != EOPNOTSUPP || ::ftruncate(fd_, PageOffset(reserve)) != 0) {
+        return Status::IoError("failed to extend database file");
+      }
+    }
+    reserved_pages_ = reserve;
   }
 
-  file_.flush();
-  ++page_count_;
-  return page.id;
+  // Pages inside the current extent need no system call at all.
+  page_count_.store(end, std::memory_order_release);
+  return static_cast<PageId>(first);
 }
 
-Status DiskManager::ReadPage(PageId id, char* data) const {
+Status DiskManager::DeallocatePage(PageId id) {
+  const Status range_status = CheckRange(id, 1);
+  if (!range_status.ok()) {
+    return range_status;
+  }
+
+  std::scoped_lock lock(allocation_latch_);
+
+  if (IsFree(id)) {
+    return Status::InvalidArgument("page is already free");
+  }
+  if (map_fd_ < 0) {
+    const Status status = OpenFreeMap();
+    if (!status.ok()) {
+      return status;
+    }
+  }
+
+  const Status forget_status = ForgetDoubleWrite(id);
+  if (!forget_status.ok()) {
+    return forget_status;
+  }
+
+  // Zero the page before it becomes visible as free, so a reallocation
+  // always sees zeros.
+  if (::fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                  PageOffset(id), kPageSize) != 0) {
+    if (errno != EOPNOTSUPP) {
+      return Status::IoError("failed to release page");
+    }
+    const PageImage zeros;
+    if (!PwriteFull(fd_, reinterpret_cast<const char*>(zeros.bytes.data()),
+                    kPageSize, PageOffset(id))) {
+      return Status::IoError("failed to release page");
+    }
+  }
+
+  const std::size_t map_page = id / kPagesPerMapPage;
+  if (free_map_.size() < (map_page + 1) * kWordsPerMapPage) {
+    free_map_.resize((map_page + 1) * kWordsPerMapPage);
+  }
+  const std::size_t word = id / kBitsPerWord;
+  free_map_[word] |= std::uint64_t{1} << (id % kBitsPerWord);
+  const Status status = WriteFreeMapPages(map_page, map_page + 1);
+  if (!status.ok()) {
+    free_map_[word] &= ~(std::uint64_t{1} << (id % kBitsPerWord));
+    return status;
+  }
+  ++free_pages_;
+
+  return Status::OK();
+}
+
+Result<std::size_t> DiskManager::TruncateFreeTail() {
   const Status open_status = EnsureOpen();
   if (!open_status.ok()) {
     return open_status;
   }
 
-  if (id >= page_count_) {
-    return Status::NotFound("page id out of range");
+  std::scoped_lock lock(allocation_latch_);
+
+  const std::size_t old_count = page_count_.load(std::memory_order_relaxed);
+  std::size_t new_count = old_count;
+  while (new_count > 0 && IsFree(new_count - 1)) {
+    --new_count;
+  }
+  if (new_count == old_count) {
+    return std::size_t{0};
   }
 
-  file_.seekg(static_cast<std::streamoff>(id) * kPageSize, std::ios::beg);
-  file_.read(data, kPageSize);
+  // Shrink the map first: a crash before the file shrinks leaves free pages
+  // at the end that are simply not known to be free.
+  for (PageId id = new_count; id < old_count; ++id) {
+    free_map_[id / kBitsPerWord] &= ~(std::uint64_t{1} << (id % kBitsPerWord));
+  }
+  free_pages_ -= old_count - new_count;
+  const std::size_t map_pages = MapPagesFor(new_count);
+  free_map_.resize(map_pages * kWordsPerMapPage);
+  Status status = WriteFreeMapPages(map_pages == 0 ? 0 : map_pages - 1,
+                                    map_pages);
+  if (status.ok() &&
+      ::ftruncate(map_fd_, PageOffset(map_pages)) != 0) {
+    status = Status::IoError("failed to truncate free-page map");
+  }
+  if (!status.ok()) {
+    return status;
+  }
+
+  if (::ftruncate(fd_, PageOffset(new_count)) != 0) {
+    return Status::IoError("failed to truncate database file");
+  }
+  page_count_.store(new_count, std::memory_order_release);
+  reserved_pages_ = new_count;
+
+  return old_count - new_count;
+}
 
-  if (file_.gcount() != kPageSize ||
-      !file_) {
-    file_.clear();
+Status DiskManager::ReadPage(PageId id, char* data) const {
+  const Status range_status = CheckRange(id, 1);
+  if (!range_status.ok()) {
+    return range_status;
+  }
+
+  if (const auto mapped = MappedPage(id)) {
+    std::memcpy(data, mapped->data(), kPageSize);
+    return Verify(data);
+  }
+
+  if (NeedsBounce(data)) {
+    return ReadBounced(id, data);
+  }
+
+  if (ring_) {
+    return ReadPageAsync(id, data).get();
+  }
+
+  if (!PreadFull(fd_, data, kPageSize, PageOffset(id))) {
     return Status::IoError("failed to read page");
   }
 
-  return Status::OK();
+  return Verify(data);
 }
 
 Status DiskManager::WritePage(PageId id, const char* data) {
-  const Status open_status = EnsureOpen();
-  if (!open_status.ok()) {
-    return open_status;
+  const Status range_status = CheckRange(id, 1);
+  if (!range_status.ok()) {
+    return range_status;
+  }
+
+  PageImage staging;
+  data = Sealed(data, staging);
+
+  if (double_write_fd_ >= 0) {
+    const PageWrite write{id, data};
+    return DoubleWrite({&write, 1});
+  }
+  return WritePageInPlace(id, data);
+}
+
+Status DiskManager::WritePageInPlace(PageId id, const char* data) {
+  if (NeedsBounce(data)) {
+    return WriteBounced(id, data);
+  }
+
+  if (ring_) {
+    return SubmitWrite(id, data).get();
+  }
+
+  if (!PwriteFull(fd_, data, kPageSize, PageOffset(id))) {
+    return Status::IoError("failed to write page");
+  }
+
+  return Status::OK();
+}
+
+Status DiskManager::ReadPages(PageId first,
+                              std::span<char* const> buffers) const {
+  const Status range_status = CheckRange(first, buffers.size());
+  if (!range_status.ok()) {
+    return range_status;
+  }
+
+  if (mapping_ != nullptr &&
+      PageOffset(first + buffers.size()) <=
+          static_cast<off_t>(mapping_bytes_)) {
+    for (std::size_t i = 0; i < buffers.size(); ++i) {
+      std::memcpy(buffers[i], mapping_ + PageOffset(first + i), kPageSize);
+      const Status status = Verify(buffers[i]);
+      if (!status.ok()) {
+        return status;
+      }
+    }
+    return Status::OK();
+  }
+
+  if (std::any_of(buffers.begin(), buffers.end(),
+                  [this](const char* b) { return NeedsBounce(b); })) {
+    for (std::size_t i = 0; i < buffers.size(); ++i) {
+      const Status status = ReadPage(first + i, buffers[i]);
+      if (!status.ok()) {
+        return status;
+      }
+    }
+    return Status::OK();
+  }
+
+  std::vector<iovec> iov;
+  iov.reserve(buffers.size());
+  for (char* buffer : buffers) {
+    iov.push_back(iovec{buffer, kPageSize});
+  }
+
+  const bool ok = VectoredFull(iov, PageOffset(first),
+                               [this](const iovec* v, int n, off_t offset) {
+                                 return ::preadv(fd_, v, n, offset);
+                               });
+  if (!ok) {
+    return Status::IoError("failed to read pages");
+  }
+
+  for (const char* buffer : buffers) {
+    const Status status = Verify(buffer);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  return Status::OK();
+}
+
+Status DiskManager::WritePages(PageId first,
+                               std::span<const char* const> buffers) {
+  const Status range_status = CheckRange(first, buffers.size());
+  if (!range_status.ok()) {
+    return range_status;
+  }
+
+  if (double_write_fd_ >= 0 || page_checksums_) {
+    std::vector<PageWrite> writes;
+    writes.reserve(buffers.size());
+    for (std::size_t i = 0; i < buffers.size(); ++i) {
+      writes.push_back({first + i, buffers[i]});
+    }
+    return WriteBatch(writes);
+  }
+  return WritePagesInPlace(first, buffers);
+}
+
+Status DiskManager::WritePagesInPlace(PageId first,
+                                      std::span<const char* const> buffers) {
+  if (std::any_of(buffers.begin(), buffers.end(),
+                  [this](const char* b) { return NeedsBounce(b); })) {
+    for (std::size_t i = 0; i < buffers.size(); ++i) {
+      const Status status = WritePageInPlace(first + i, buffers[i]);
+      if (!status.ok()) {
+        return status;
+      }
+    }
+    return Status::OK();
+  }
+
+  std::vector<iovec> iov;
+  iov.reserve(buffers.size());
+  for (const char* buffer : buffers) {
+    iov.push_back(iovec{const_cast<char*>(buffer), kPageSize});
+  }
+
+  const bool ok = VectoredFull(iov, PageOffset(first),
+                               [this](const iovec* v, int n, off_t offset) {
+                                 return ::pwritev(fd_, v, n, offset);
+                               });
+  if (!ok) {
+    return Status::IoError("failed to write pages");
+  }
+
+  return Status::OK();
+}
+
+Status DiskManager::WriteBatch(std::span<const PageWrite> writes) {
+  for (const auto& write : writes) {
+    const Status range_status = CheckRange(write.id, 1);
+    if (!range_status.ok()) {
+      return range_status;
+    }
+  }
+  // Sealed copies of the pages go to disk; the caller's are left alone.
+  std::vector<PageImage> staging;
+  std::vector<PageWrite> sealed;
+  if (page_checksums_) {
+    staging.resize(writes.size());
+    sealed.reserve(writes.size());
+    for (std::size_t i = 0; i < writes.size(); ++i) {
+      sealed.push_back({writes[i].id, Sealed(writes[i].data, staging[i])});
+    }
+    writes = sealed;
+  }
+
+  if (double_write_fd_ < 0) {
+    return WriteRuns(writes);
+  }
+  for (std::size_t first = 0; first < writes.size();
+       first += double_write_pages_) {
+    const auto status = DoubleWrite(writes.subspan(
+        first, std::min(double_write_pages_, writes.size() - first)));
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  return Status::OK();
+}
+
+Status DiskManager::WriteRuns(std::span<const PageWrite> writes) {
+  std::vector<const char*> buffers;
+  for (std::size_t begin = 0; begin < writes.size();) {
+    std::size_t end = begin + 1;
+    while (end < writes.size() && writes[end].id == writes[end - 1].id + 1) {
+      ++end;
+    }
+    buffers.clear();
+    for (std::size_t i = begin; i < end; ++i) {
+      buffers.push_back(writes[i].data);
+    }
+    const auto status = WritePagesInPlace(writes[begin].id, buffers);
+    if (!status.ok()) {
+      return status;
+    }
+    begin = end;
+  }
+  return Status::OK();
+}
+
+// One double-write round of at most double_write_pages_ pages: the images
+// go to the sidecar in a single write and are synced, then to their places
+// in the data file, which is synced before the sidecar can be overwritten
+// by the next round.
+Status DiskManager::DoubleWrite(std::span<const PageWrite> writes) {
+  std::scoped_lock lock(double_write_latch_);
+
+  PageImage header_image;
+  auto* header = reinterpret_cast<DoubleWriteHeader*>(header_image.bytes.data());
+  header->magic = kDoubleWriteMagic;
+  header->count = static_cast<std::uint32_t>(writes.size());
+  std::vector<iovec> iov;
+  iov.reserve(writes.size() + 1);
+  iov.push_back(iovec{header_image.bytes.data(), kPageSize});
+  for (std::size_t i = 0; i < writes.size(); ++i) {
+    header->entries[i].page_id = writes[i].id;
+    header->entries[i].checksum = Crc32c(writes[i].data, kPageSize);
+    iov.push_back(iovec{const_cast<char*>(writes[i].data), kPageSize});
+  }
+  header->checksum =
+      Crc32c(header->entries, writes.size() * sizeof(header->entries[0]));
+
+  const bool ok = VectoredFull(iov, 0, [this](const iovec* v, int n,
+                                              off_t offset) {
+    return ::pwritev(double_write_fd_, v, n, offset);
+  });
+  if (!ok || ::fdatasync(double_write_fd_) != 0) {
+    return Status::IoError("failed to write double-write batch");
+  }
+  double_write_ids_.clear();
+  for (const auto& write : writes) {
+    double_write_ids_.push_back(write.id);
+  }
+
+  const auto status = WriteRuns(writes);
+  if (!status.ok()) {
+    return status;
+  }
+  if (::fdatasync(fd_) != 0) {
+    return Status::IoError("failed to sync database file");
+  }
+  return Status::OK();
+}
+
+// A freed page reads back as zeros. If the sidecar still held an image of
+// it, a restart would bring that image back, so the batch is dropped.
+Status DiskManager::ForgetDoubleWrite(PageId id) {
+  std::scoped_lock lock(double_write_latch_);
+  if (double_write_fd_ < 0 ||
+      std::find(double_write_ids_.begin(), double_write_ids_.end(), id) ==
+          double_write_ids_.end()) {
+    return Status::OK();
+  }
+  const PageImage empty;
+  if (!PwriteFull(double_write_fd_,
+                  reinterpret_cast<const char*>(empty.bytes.data()), kPageSize,
+                  0) ||
+      ::fdatasync(double_write_fd_) != 0) {
+    return Status::IoError("failed to clear double-write batch");
+  }
+  double_write_ids_.clear();
+  return Status::OK();
+}
+
+// Restores, from an intact double-write batch, every live page whose copy
+// in the data file differs: the in-place write of that batch may have been
+// torn. With `keep` the sidecar stays open for writing, still holding the
+// batch; otherwise it is removed once the repair is done.
+Status DiskManager::RepairFromDoubleWrite(bool keep) {
+  const auto dw_path = double_write_path();
+  std::error_code error;
+  const bool exists = std::filesystem::exists(dw_path, error);
+  if (!exists && !keep) {
+    return Status::OK();
+  }
+  const int dw_fd = ::open(dw_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (dw_fd < 0) {
+    return Status::IoError("failed to open double-write file");
+  }
+
+  PageImage header_image;
+  const auto* header =
+      reinterpret_cast<const DoubleWriteHeader*>(header_image.bytes.data());
+  if (exists &&
+      PreadFull(dw_fd, reinterpret_cast<char*>(header_image.bytes.data()),
+                kPageSize, 0) &&
+      header->magic == kDoubleWriteMagic &&
+      header->count <= kMaxDoubleWritePages &&
+      header->checksum ==
+          Crc32c(header->entries,
+                 header->count * sizeof(header->entries[0]))) {
+    PageImage copy;
+    PageImage current;
+    char* copy_data = reinterpret_cast<char*>(copy.bytes.data());
+    char* current_data = reinterpret_cast<char*>(current.bytes.data());
+    for (std::size_t i = 0; i < header->count; ++i) {
+      const PageId id = header->entries[i].page_id;
+      // A kept batch must be forgotten, like one written by this process,
+      // if any of its pages is freed.
+      double_write_ids_.push_back(id);
+      if (id >= page_count() || IsFree(id) ||
+          !PreadFull(dw_fd, copy_data, kPageSize, PageOffset(i + 1)) ||
+          Crc32c(copy_data, kPageSize) != header->entries[i].checksum) {
+        continue;
+      }
+      if (!PreadFull(fd_, current_data, kPageSize, PageOffset(id))) {
+        ::close(dw_fd);
+        return Status::IoError("failed to read page");
+      }
+      if (std::memcmp(copy_data, current_data, kPageSize) == 0) {
+        continue;
+      }
+      if (!PwriteFull(fd_, copy_data, kPageSize, PageOffset(id))) {
+        ::close(dw_fd);
+        return Status::IoError("failed to repair page");
+      }
+      ++repaired_pages_;
+    }
+    if (repaired_pages_ > 0 && ::fdatasync(fd_) != 0) {
+      ::close(dw_fd);
+      return Status::IoError("failed to sync database file");
+    }
+  }
+
+  if (!keep) {
+    ::close(dw_fd);
+    std::filesystem::remove(dw_path, error);
+    return Status::OK();
+  }
+  double_write_fd_ = dw_fd;
+  return Status::OK();
+}
+
+Status DiskManager::Sync() {
+  auto status = EnsureOpen();
+  if (!status.ok() || durability_ == Durability::kNone) {
+    return status;
+  }
+
+  std::unique_lock lock(sync_latch_);
+  // A round already running may have started before our writes completed.
+  const std::uint64_t target = syncs_started_ + 1;
+  while (syncs_finished_ < target) {
+    if (sync_running_) {
+      sync_cv_.wait(lock);
+      continue;
+    }
+    sync_running_ = true;
+    ++syncs_started_;
+    lock.unlock();
+    status = SyncFiles();
+    lock.lock();
+    last_sync_ = status;
+    ++syncs_finished_;
+    sync_running_ = false;
+    sync_cv_.notify_all();
+  }
+  return last_sync_;
+}
+
+Status DiskManager::SyncFiles() {
+  sync_count_.fetch_add(1, std::memory_order_relaxed);
+  if (::fdatasync(fd_) != 0) {
+    return Status::IoError("failed to sync database file");
+  }
+  std::scoped_lock lock(allocation_latch_);
+  if (map_fd_ >= 0 && ::fdatasync(map_fd_) != 0) {
+    return Status::IoError("failed to sync free-page map");
+  }
+  return Status::OK();
+}
+
+// Durability::kPeriodic: one Sync() every sync_interval_ until Close.
+void DiskManager::SyncerLoop() {
+  std::unique_lock lock(sync_latch_);
+  while (!sync_cv_.wait_for(lock, sync_interval_,
+                            [this] { return syncer_stop_; })) {
+    lock.unlock();
+    static_cast<void>(Sync());
+    lock.lock();
+  }
+}
+
+std::future<Status> DiskManager::ReadPageAsync(PageId id, char* data) const {
+  std::promise<Status> ready;
+  if (!ring_ || NeedsBounce(data)) {
+    ready.set_value(ReadPage(id, data));
+    return ready.get_future();
+  }
+
+  const Status range_status = CheckRange(id, 1);
+  if (!range_status.ok()) {
+    ready.set_value(range_status);
+    return ready.get_future();
+  }
+
+  auto promise = std::make_shared<std::promise<Status>>();
+  auto future = promise->get_future();
+  const Status status =
+      ring_->SubmitRead(fd_, data, kPageSize, PageOffset(id),
+                        [this, promise, data](Status done) {
+                          promise->set_value(done.ok() ? Verify(data)
+                                                       : std::move(done));
+                        });
+  if (!status.ok()) {
+    promise->set_value(status);
+  }
+  return future;
+}
+
+std::future<Status> DiskManager::WritePageAsync(PageId id, const char* data) {
+  std::promise<Status> ready;
+  if (!ring_ || NeedsBounce(data) || double_write_fd_ >= 0) {
+    ready.set_value(WritePage(id, data));
+    return ready.get_future();
   }
 
-  if (id >= page_count_) {
-    return Status::NotFound("cannot write unknown page id");
+  const Status range_status = CheckRange(id, 1);
+  if (!range_status.ok()) {
+    ready.set_value(range_status);
+    return ready.get_future();
   }
+  if (!page_checksums_) {
+    return SubmitWrite(id, data);
+  }
+  // The sealed copy has to outlive the queued write.
+  auto staging = std::make_shared<PageImage>();
+  const char* sealed = Sealed(data, *staging);
+  return SubmitWrite(id, sealed, std::move(staging));
+}
 
-  file_.seekp(static_cast<std::streamoff>(id) * kPageSize, std::ios::beg);
-  file_.write(data, kPageSize);
+// Queues a write on the ring; the future resolves on completion. owner, if
+// set, is kept alive until then.
+std::future<Status> DiskManager::SubmitWrite(
+    PageId id, const char* data, std::shared_ptr<const PageImage> owner) {
+  auto promise = std::make_shared<std::promise<Status>>();
+  auto future = promise->get_future();
+  const Status status =
+      ring_->SubmitWrite(fd_, data, kPageSize, PageOffset(id),
+                         [promise, owner = std::move(owner)](Status done) {
+                           promise->set_value(std::move(done));
+                         });
+  if (!status.ok()) {
+    promise->set_value(status);
+  }
+  return future;
+}
 
-  if (!file_) {
+const char* DiskManager::Sealed(const char* data, PageImage& staging) const {
+  if (!page_checksums_) {
+    return data;
+  }
+  std::memcpy(staging.bytes.data(), data, kPageSize);
+  SealPage(staging.bytes);
+  return reinterpret_cast<const char*>(staging.bytes.data());
+}
+
+
+Status DiskManager::Verify(const char* data) const {
+  if (!page_checksums_) {
+    return Status::OK();
+  }
+  return VerifyPage({reinterpret_cast<const std::byte*>(data), kPageSize});
+}
+
+bool DiskManager::NeedsBounce(const void* buffer) const {
+  return direct_io_ && reinterpret_cast<std::uintptr_t>(buffer) % kPageSize != 0;
+}
+
+// O_DIRECT transfers of a misaligned caller buffer, through an aligned copy.
+Status DiskManager::ReadBounced(PageId id, char* data) const {
+  PageImage bounce;
+  if (!PreadFull(fd_, reinterpret_cast<char*>(bounce.bytes.data()), kPageSize,
+                 PageOffset(id))) {
+    return Status::IoError("failed to read page");
+  }
+  std::memcpy(data, bounce.bytes.data(), kPageSize);
+  return Verify(data);
+}
+
+Status DiskManager::WriteBounced(PageId id, const char* data) {
+  PageImage bounce;
+  std::memcpy(bounce.bytes.data(), data, kPageSize);
+  if (!PwriteFull(fd_, reinterpret_cast<const char*>(bounce.bytes.data()),
+                  kPageSize, PageOffset(id))) {
     return Status::IoError("failed to write page");
   }
+  return Status::OK();
+}
+
+std::optional<std::span<const std::byte>> DiskManager::MappedPage(
+    PageId id) const {
+  if (mapping_ == nullptr || id >= page_count() ||
+      PageOffset(id + 1) > static_cast<off_t>(mapping_bytes_)) {
+    return std::nullopt;
+  }
+  return std::span<const std::byte>(mapping_ + PageOffset(id), kPageSize);
+}
 
-  file_.flush();
+Status DiskManager::Advise(PageId first, std::size_t count,
+                           MmapAdvice advice) const {
+  if (mapping_ == nullptr || count == 0) {
+    return Status::OK();
+  }
+  const auto begin = std::min<std::size_t>(PageOffset(first), mapping_bytes_);
+  const auto end =
+      std::min<std::size_t>(PageOffset(first + count), mapping_bytes_);
+  if (begin < end &&
+      ::madvise(mapping_ + begin, end - begin, AdviceFlag(advice)) != 0) {
+    return Status::IoError("madvise failed");
+  }
   return Status::OK();
 }
 
 Status DiskManager::EnsureOpen() const {
-  if (file_.is_open()) {
+  if (fd_ >= 0) {
     return Status::OK();
   }
 
   if (path_.empty()) {
-    return Status::InvalidArgument("pager not initialized");
+    return Status::InvalidArgument("disk manager not initialized");
+  }
+
+  return Status::IoError("database file is not open");
+}
+
+Status DiskManager::CheckRange(PageId first, std::size_t count) const {
+  const Status open_status = EnsureOpen();
+  if (!open_status.ok()) {
+    return open_status;
   }
 
-  file_.open(path_, std::ios::in | std::ios::out | std::ios::binary);
-  if (!file_) {
-    return Status::IoError("unable to reopen database file");
+  const auto pages = page_count();
+  if (first >= pages || count > pages - first) {
+    return Status::NotFound("page id out of range");
   }
 
   return Status::OK();
 }
 
+void DiskManager::Close() {
+  if (syncer_.joinable()) {
+    {
+      std::scoped_lock lock(sync_latch_);
+      syncer_stop_ = true;
+    }
+    sync_cv_.notify_all();
+    syncer_.join();
+  }
+  // Drains any in-flight requests before the descriptor goes away.
+  ring_.reset();
+  if (mapping_ != nullptr) {
+    ::munmap(mapping_, mapping_bytes_);
+    mapping_ = nullptr;
+    mapping_bytes_ = 0;
+  }
+  if (fd_ >= 0) {
+    // Give back the unused rest of the last extent, so the next Open sees
+    // the file as exactly its pages.
+    if (reserved_pages_ > page_count()) {
+      static_cast<void>(::ftruncate(fd_, PageOffset(page_count())));
+    }
+    ::close(fd_);
+    fd_ = -1;
+  }
+  reserved_pages_ = 0;
+  direct_io_ = false;
+  if (map_fd_ >= 0) {
+    ::close(map_fd_);
+    map_fd_ = -1;
+  }
+  free_map_.clear();
+  free_pages_ = 0;
+  if (double_write_fd_ >= 0) {
+    ::close(double_write_fd_);
+    double_write_fd_ = -1;
+  }
+  double_write_ids_.clear();
+  repaired_pages_ = 0;
+}
+
+std::filesystem::path DiskManager::double_write_path() const {
+  auto dw_path = path_;
+  dw_path += ".dw";
+  return dw_path;
+}
+
+std::filesystem::path DiskManager::free_map_path() const {
+  auto map_path = path_;
+  map_path += ".fsm";
+  return map_path;
+}
+
+// Loads the free-page map if the sidecar exists. Bits past the end of the
+// data file are stale (the file was truncated or recreated) and are
+// dropped, on disk as well.
+Status DiskManager::LoadFreeMap() {
+  std::error_code error;
+  if (!std::filesystem::exists(free_map_path(), error)) {
+    return Status::OK();
+  }
+  const Status open_status = OpenFreeMap();
+  if (!open_status.ok()) {
+    return open_status;
+  }
+
+  struct stat st {};
+  if (::fstat(map_fd_, &st) != 0) {
+    return Status::IoError("failed to determine free-page map size");
+  }
+  const std::size_t pages = page_count();
+  const std::size_t map_pages = MapPagesFor(pages);
+  free_map_.assign(map_pages * kWordsPerMapPage, 0);
+  const std::size_t stored = std::min<std::size_t>(
+      static_cast<std::size_t>(st.st_size), map_pages * kPageSize);
+  if (stored > 0 &&
+      !PreadFull(map_fd_, reinterpret_cast<char*>(free_map_.data()), stored,
+                 0)) {
+    return Status::IoError("failed to read free-page map");
+  }
+
+  for (std::size_t id = pages; id < map_pages * kPagesPerMapPage; ++id) {
+    free_map_[id / kBitsPerWord] &= ~(std::uint64_t{1} << (id % kBitsPerWord));
+  }
+  for (const std::uint64_t word : free_map_) {
+    free_pages_ += static_cast<std::size_t>(std::popcount(word));
+  }
+
+  const Status status =
+      WriteFreeMapPages(map_pages == 0 ? 0 : map_pages - 1, map_pages);
+  if (!status.ok()) {
+    return status;
+  }
+  if (::ftruncate(map_fd_, PageOffset(map_pages)) != 0) {
+    return Status::IoError("failed to truncate free-page map");
+  }
+  return Status::OK();
+}
+
+Status DiskManager::OpenFreeMap() {
+  map_fd_ = ::open(free_map_path().c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (map_fd_ < 0) {
+    return Status::IoError("failed to open free-page map");
+  }
+  return Status::OK();
+}
+
+// Writes bitmap pages [first_page, end_page) of the free-page map.
+Status DiskManager::WriteFreeMapPages(std::size_t first_page,
+                                      std::size_t end_page) {
+  if (first_page >= end_page) {
+    return Status::OK();
+  }
+  const auto* data = reinterpret_cast<const char*>(
+      free_map_.data() + first_page * kWordsPerMapPage);
+  if (!PwriteFull(map_fd_, data, (end_page - first_page) * kPageSize,
+                  PageOffset(first_page))) {
+    return Status::IoError("failed to write free-page map");
+  }
+  return Status::OK();
+}
+
+bool DiskManager::IsFree(PageId id) const {
+  const std::size_t word = id / kBitsPerWord;
+  return word < free_map_.size() &&
+         (free_map_[word] >> (id % kBitsPerWord) & 1) != 0;
+}
+
+std::optional<PageId> DiskManager::LowestFree() const {
+  for (std::size_t word = 0; word < free_map_.size(); ++word) {
+    if (free_map_[word] != 0) {
+      return word * kBitsPerWord +
+             static_cast<std::size_t>(std::countr_zero(free_map_[word]));
+    }
+  }
+  return std::nullopt;
+}
+
 }  // namespace simpledb
@@ -0,0 +1,580 @@
+#include "simpledb/extendible_hash_index.h"
+
+#include <bit>
+#include <cstring>
+#include <mutex>
+#include <utility>
+
+#include "simpledb/crc32c.h"
+
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#endif
+
+namespace simpledb {
+
+namespace {
+
+constexpr std::size_t kEntriesPerDirectoryPage = 256;
+constexpr std::size_t kMaxDirectoryPages =
+    (std::size_t{1} << ExtendibleHashIndex::kMaxGlobalDepth) /
+    kEntriesPerDirectoryPage;
+
+// The header page, after its PageHeader.
+struct IndexHeader {
+  std::uint32_t global_depth;
+  std::uint32_t directory_page_count;
+  PageId directory_pages[kMaxDirectoryPages];
+};
+static_assert(kPageHeaderSize + sizeof(IndexHeader) <= kPageSize);
+static_assert(kPageHeaderSize + kEntriesPerDirectoryPage * sizeof(PageId) <=
+              kPageSize);
+
+// Bucket layout, after the PageHeader: this header, the fingerprint array,
+// the slot array, and cells of key bytes and value growing down from the
+// end of the page. Entries are dense in [0, count) and in no order.
+struct BucketHeader {
+  std::uint16_t count;
+  std::uint16_t cell_start;
+  // Bytes of removed cells not yet reclaimed by compaction.
+  std::uint16_t fragmented_bytes;
+  std::uint8_t local_depth;
+  std::uint8_t reserved;
+};
+
+struct Slot {
+  std::uint16_t offset;
+  std::uint16_t key_size;
+};
+
+// A multiple of the sixteen fingerprints probed at a time.
+constexpr std::size_t kBucketSlots = 128;
+constexpr std::size_t kFingerprintStart =
+    kPageHeaderSize + sizeof(BucketHeader);
+constexpr std::size_t kSlotStart = kFingerprintStart + kBucketSlots;
+constexpr std::size_t kCellStart = kSlotStart + kBucketSlots * sizeof(Slot);
+constexpr std::size_t kValueSize = sizeof(PageId) + sizeof(std::uint16_t);
+// A split must leave room for at least two of the largest entries.
+static_assert(2 * (ExtendibleHashIndex::kMaxKeySize + kValueSize) <=
+              kPageSize - kCellStart);
+
+// CRC-32C, for its speed here, with a finalizer so that every output bit
+// depends on every input bit: the directory takes the low bits and the
+// fingerprint the top byte.
+std::uint32_t Hash(std::span<const std::byte> key) {
+  std::uint32_t hash = Crc32c(key.data(), key.size());
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6b;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+std::uint8_t Fingerprint(std::uint32_t hash) {
+  return static_cast<std::uint8_t>(hash >> 24);
+}
+
+// Bit i is set where fingerprints[i] == fingerprint, for i < 16.
+std::uint32_t MatchSixteen(const std::byte* fingerprints,
+                           std::uint8_t fingerprint) {
+#if defined(__x86_64__)
+  const __m128i needle = _mm_set1_epi8(static_cast<char>(fingerprint));
+  const __m128i group =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(fingerprints));
+  return static_cast<std::uint32_t>(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(group, needle)));
+#else
+  std::uint32_t mask = 0;
+  for (std::uint32_t i = 0; i < 16; ++i) {
+    if (static_cast<std::uint8_t>(fingerprints[i]) == fingerprint) {
+      mask |= std::uint32_t{1} << i;
+    }
+  }
+  return mask;
+#endif
+}
+
+class BucketView {
+ public:
+  explicit BucketView(std::span<const std::byte> data) : data_(data) {}
+
+  std::uint16_t count() const { return header().count; }
+  std::uint8_t local_depth() const { return header().local_depth; }
+
+  std::span<const std::byte> KeyAt(std::uint16_t index) const {
+    const Slot slot = SlotAt(index);
+    return data_.subspan(slot.offset, slot.key_size);
+  }
+
+  RecordId ValueAt(std::uint16_t index) const {
+    const Slot slot = SlotAt(index);
+    RecordId value;
+    const std::byte* bytes = data_.data() + slot.offset + slot.key_size;
+    std::memcpy(&value.page_id, bytes, sizeof(value.page_id));
+    std::memcpy(&value.slot, bytes + sizeof(value.page_id),
+                sizeof(value.slot));
+    return value;
+  }
+
+  // The index of the entry for key, or count() if there is none.
+  std::uint16_t Find(std::span<const std::byte> key,
+                     std::uint8_t fingerprint) const {
+    const std::byte* const fingerprints = data_.data() + kFingerprintStart;
+    const std::uint16_t n = count();
+    for (std::uint16_t base = 0; base < n; base += 16) {
+      std::uint32_t matches = MatchSixteen(fingerprints + base, fingerprint);
+      if (n - base < 16) {
+        matches &= (std::uint32_t{1} << (n - base)) - 1;
+      }
+      for (; matches != 0; matches &= matches - 1) {
+        const auto index =
+            static_cast<std::uint16_t>(base + std::countr_zero(matches));
+        const auto candidate = KeyAt(index);
+        if (candidate.size() == key.size() &&
+            (key.empty() ||
+             std::memcmp(candidate.data(), key.data(), key.size()) == 0)) {
+          return index;
+        }
+      }
+    }
+    return n;
+  }
+
+ protected:
+  const BucketHeader& header() const {
+    return *reinterpret_cast<const BucketHeader*>(data_.data() +
+                                                  kPageHeaderSize);
+  }
+
+  Slot SlotAt(std::uint16_t index) const {
+    Slot slot;
+    std::memcpy(&slot, data_.data() + kSlotStart + index * sizeof(slot),
+                sizeof(slot));
+    return slot;
+  }
+
+  std::span<const std::byte> data_;
+};
+
+class Bucket : public BucketView {
+ public:
+  explicit Bucket(std::span<std::byte> data)
+      : BucketView(data), mutable_data_(data) {}
+
+  void Format(std::uint8_t local_depth) {
+    SetPageType(mutable_data_, PageType::kHashBucket);
+    auto& hdr = mutable_header();
+    hdr.count = 0;
+    hdr.cell_start = static_cast<std::uint16_t>(kPageSize);
+    hdr.fragmented_bytes = 0;
+    hdr.local_depth = local_depth;
+  }
+
+  // False, with the bucket unchanged, if the entry does not fit.
+  bool Append(std::uint8_t fingerprint, std::span<const std::byte> key,
+              RecordId value) {
+    const std::size_t cell_size = key.size() + kValueSize;
+    auto& hdr = mutable_header();
+    if (hdr.count == kBucketSlots ||
+        hdr.cell_start - kCellStart + hdr.fragmented_bytes < cell_size) {
+      return false;
+    }
+    if (hdr.cell_start - kCellStart < cell_size) {
+      Compact();
+    }
+    hdr.cell_start = static_cast<std::uint16_t>(hdr.cell_start - cell_size);
+    std::byte* const cell = mutable_data_.data() + hdr.cell_start;
+    if (!key.empty()) {
+      std::memcpy(cell, key.data(), key.size());
+    }
+    std::memcpy(cell + key.size(), &value.page_id, sizeof(value.page_id));
+    std::memcpy(cell + key.size() + sizeof(value.page_id), &value.slot,
+                sizeof(value.slot));
+
+    mutable_data_[kFingerprintStart + hdr.count] =
+        static_cast<std::byte>(fingerprint);
+    SetSlot(hdr.count,
+            {hdr.cell_start, static_cast<std::uint16_t>(key.size())});
+    ++hdr.count;
+    return true;
+  }
+
+  // Moves the last entry into the hole.
+  void Remove(std::uint16_t index) {
+    const Slot slot = SlotAt(index);
+    const std::size_t cell_size = slot.key_size + kValueSize;
+    auto& hdr = mutable_header();
+    if (slot.offset == hdr.cell_start) {
+      hdr.cell_start = static_cast<std::uint16_t>(hdr.cell_start + cell_size);
+    } else {
+      hdr.fragmented_bytes =
+          static_cast<std::uint16_t>(hdr.fragmented_bytes + cell_size);
+    }
+    const std::uint16_t last = --hdr.count;
+    mutable_data_[kFingerprintStart + index] =
+        mutable_data_[kFingerprintStart + last];
+    SetSlot(index, SlotAt(last));
+  }
+
+ private:
+  BucketHeader& mutable_header() {
+    return *reinterpret_cast<BucketHeader*>(mutable_data_.data() +
+                                            kPageHeaderSize);
+  }
+
+  void SetSlot(std::uint16_t index, const Slot& slot) {
+    std::memcpy(mutable_data_.data() + kSlotStart + index * sizeof(slot),
+                &slot, sizeof(slot));
+  }
+
+  // Rewrites the cells to the end of the page.
+  void Compact() {
+    PageImage scratch;
+    std::size_t end = kPageSize;
+    for (std::uint16_t index = 0; index < count(); ++index) {
+      Slot slot = SlotAt(index);
+      const std::size_t cell_size = slot.key_size + kValueSize;
+      end -= cell_size;
+      std::memcpy(scratch.bytes.data() + end,
+                  mutable_data_.data() + slot.offset, cell_size);
+      slot.offset = static_cast<std::uint16_t>(end);
+      SetSlot(index, slot);
+    }
+    std::memcpy(mutable_data_.data() + end, scratch.bytes.data() + end,
+                kPageSize - end);
+    auto& hdr = mutable_header();
+    hdr.cell_start = static_cast<std::uint16_t>(end);
+    hdr.fragmented_bytes = 0;
+  }
+
+  std::span<std::byte> mutable_data_;
+};
+
+PageId DirectoryEntry(std::span<const std::byte> page, std::size_t slot) {
+  PageId bucket;
+  std::memcpy(&bucket, page.data() + kPageHeaderSize + slot * sizeof(bucket),
+              sizeof(bucket));
+  return bucket;
+}
+
+void SetDirectoryEntry(std::span<std::byte> page, std::size_t slot,
+                       PageId bucket) {
+  std::memcpy(page.data() + kPageHeaderSize + slot * sizeof(bucket), &bucket,
+              sizeof(bucket));
+}
+
+}  // namespace
+
+ExtendibleHashIndex::ExtendibleHashIndex(BufferPoolManager* pool)
+    : pool_(pool) {}
+
+Status ExtendibleHashIndex::Create() {
+  std::unique_lock lock(directory_latch_);
+  auto header_res = pool_->NewPageWrite();
+  if (!header_res.ok()) {
+    return header_res.status();
+  }
+  WritePageGuard header = std::move(header_res).value();
+  auto directory_res = pool_->NewPageWrite();
+  if (!directory_res.ok()) {
+    return directory_res.status();
+  }
+  WritePageGuard directory = std::move(directory_res).value();
+  auto bucket_res = pool_->NewPageWrite();
+  if (!bucket_res.ok()) {
+    return bucket_res.status();
+  }
+  WritePageGuard bucket = std::move(bucket_res).value();
+
+  Bucket(bucket.data()).Format(0);
+  SetPageType(directory.data(), PageType::kHashDirectory);
+  SetDirectoryEntry(directory.data(), 0, bucket.page_id());
+  SetPageType(header.data(), PageType::kHashIndexHeader);
+  header_page_id_ = header.page_id();
+  global_depth_ = 0;
+  directory_pages_ = {directory.page_id()};
+  header.Release();
+  return WriteHeader(global_depth_, directory_pages_);
+}
+
+Status ExtendibleHashIndex::Open(PageId header_page_id) {
+  std::unique_lock lock(directory_latch_);
+  auto header_res = pool_->FetchPageRead(header_page_id);
+  if (!header_res.ok()) {
+    return header_res.status();
+  }
+  const auto data = header_res.value().data();
+  if (PageTypeOf(data) != PageType::kHashIndexHeader) {
+    return Status::InvalidArgument("not a hash index header page");
+  }
+  IndexHeader header;
+  std::memcpy(&header, data.data() + kPageHeaderSize, sizeof(header));
+  if (header.global_depth > kMaxGlobalDepth ||
+      header.directory_page_count > kMaxDirectoryPages) {
+    return Status::Internal("corrupt hash index header");
+  }
+  header_page_id_ = header_page_id;
+  global_depth_ = header.global_depth;
+  directory_pages_.assign(
+      header.directory_pages,
+      header.directory_pages + header.directory_page_count);
+  return Status::OK();
+}
+
+Result<PageId> ExtendibleHashIndex::BucketFor(std::uint32_t hash) {
+  if (header_page_id_ == kInvalidPageId) {
+    return Status::InvalidArgument("hash index is not open");
+  }
+  const std::size_t index = hash & ((std::uint32_t{1} << global_depth_) - 1);
+  auto directory_res = pool_->FetchPageRead(
+      directory_pages_[index / kEntriesPerDirectoryPage]);
+  if (!directory_res.ok()) {
+    return directory_res.status();
+  }
+  return DirectoryEntry(directory_res.value().data(),
+                        index % kEntriesPerDirectoryPage);
+}
+
+Status ExtendibleHashIndex::Insert(std::span<const std::byte> key,
+                                   RecordId value) {
+  if (key.size() > kMaxKeySize) {
+    return Status::InvalidArgument("key too large");
+  }
+  const std::uint32_t hash = Hash(key);
+  const std::uint8_t fingerprint = Fingerprint(hash);
+  {
+    std::shared_lock lock(directory_latch_);
+    auto bucket_id = BucketFor(hash);
+    if (!bucket_id.ok()) {
+      return bucket_id.status();
+    }
+    auto bucket_res = pool_->FetchPageWrite(bucket_id.value());
+    if (!bucket_res.ok()) {
+      return bucket_res.status();
+    }
+    WritePageGuard guard = std::move(bucket_res).value();
+    Bucket bucket(guard.data());
+    if (bucket.Find(key, fingerprint) != bucket.count()) {
+      return Status::InvalidArgument("duplicate key");
+    }
+    if (bucket.Append(fingerprint, key, value)) {
+      return Status::OK();
+    }
+  }
+
+  // The bucket is full. With the directory to itself, split until the
+  // key's bucket has room; the entries may all land on one side.
+  std::unique_lock lock(directory_latch_);
+  for (;;) {
+    auto bucket_id = BucketFor(hash);
+    if (!bucket_id.ok()) {
+      return bucket_id.status();
+    }
+    auto bucket_res = pool_->FetchPageWrite(bucket_id.value());
+    if (!bucket_res.ok()) {
+      return bucket_res.status();
+    }
+    WritePageGuard guard = std::move(bucket_res).value();
+    Bucket bucket(guard.data());
+    if (bucket.Find(key, fingerprint) != bucket.count()) {
+      return Status::InvalidArgument("duplicate key");
+    }
+    if (bucket.Append(fingerprint, key, value)) {
+      return Status::OK();
+    }
+    const auto status = SplitBucket(hash, guard);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+}
+
+// Moves the entries whose hash has bit local_depth set to a new bucket,
+// and repoints the directory entries that share the old bucket's low bits
+// and have that bit set. Every page the split writes is latched before the
+// first entry moves, so a failed fetch leaves the index as it was.
+Status ExtendibleHashIndex::SplitBucket(std::uint32_t hash,
+                                        WritePageGuard& bucket) {
+  const std::uint8_t depth = BucketView(bucket.data()).local_depth();
+  if (depth == global_depth_) {
+    const auto status = GrowDirectory();
+    if (!status.ok()) {
+      return status;
+    }
+  }
+
+  const auto new_depth = static_cast<std::uint8_t>(depth + 1);
+  const std::uint32_t step = std::uint32_t{1} << new_depth;
+  const std::uint32_t end = std::uint32_t{1} << global_depth_;
+  const std::uint32_t first = (hash & (step / 2 - 1)) | step / 2;
+  std::vector<WritePageGuard> directories;
+  for (std::uint32_t index = first; index < end; index += step) {
+    const std::size_t page = index / kEntriesPerDirectoryPage;
+    if (!directories.empty() &&
+        directories.back().page_id() == directory_pages_[page]) {
+      continue;
+    }
+    auto directory_res = pool_->FetchPageWrite(directory_pages_[page]);
+    if (!directory_res.ok()) {
+      return directory_res.status();
+    }
+    directories.push_back(std::move(directory_res).value());
+  }
+  auto image_res = pool_->NewPageWrite();
+  if (!image_res.ok()) {
+    return image_res.status();
+  }
+  WritePageGuard image = std::move(image_res).value();
+
+  PageImage scratch;
+  std::memcpy(scratch.bytes.data(), bucket.data().data(), kPageSize);
+  const BucketView old(scratch.bytes);
+  Bucket low(bucket.data());
+  Bucket high(image.data());
+  low.Format(new_depth);
+  high.Format(new_depth);
+  for (std::uint16_t index = 0; index < old.count(); ++index) {
+    const auto key = old.KeyAt(index);
+    const std::uint32_t key_hash = Hash(key);
+    Bucket& side = (key_hash >> depth) & 1 ? high : low;
+    side.Append(Fingerprint(key_hash), key, old.ValueAt(index));
+  }
+
+  auto directory = directories.begin();
+  for (std::uint32_t index = first; index < end; index += step) {
+    if (directory->page_id() !=
+        directory_pages_[index / kEntriesPerDirectoryPage]) {
+      ++directory;
+    }
+    SetDirectoryEntry(directory->data(), index % kEntriesPerDirectoryPage,
+                      image.page_id());
+  }
+  return Status::OK();
+}
+
+// Doubles the directory: the new upper half is a copy of the lower, so
+// every bucket gets a second pointer to it and no entry moves. The new
+// depth and page list take effect only once the header has them; on
+// failure the copies made so far are freed again.
+Status ExtendibleHashIndex::GrowDirectory() {
+  if (global_depth_ == kMaxGlobalDepth) {
+    return Status::Internal("hash index directory is full");
+  }
+  const std::size_t entries = std::size_t{1} << global_depth_;
+  if (entries < kEntriesPerDirectoryPage) {
+    auto directory_res = pool_->FetchPageWrite(directory_pages_.front());
+    if (!directory_res.ok()) {
+      return directory_res.status();
+    }
+    std::byte* const first =
+        directory_res.value().data().data() + kPageHeaderSize;
+    // Past the current depth, so unused until the header says otherwise.
+    std::memcpy(first + entries * sizeof(PageId), first,
+                entries * sizeof(PageId));
+  }
+
+  std::vector<PageId> directory_pages = directory_pages_;
+  // Best effort: the failure that got here is the one worth reporting.
+  const auto discard_copies = [&] {
+    for (std::size_t page = directory_pages_.size();
+         page < directory_pages.size(); ++page) {
+      static_cast<void>(pool_->DeletePage(directory_pages[page]));
+    }
+  };
+  if (entries >= kEntriesPerDirectoryPage) {
+    for (const PageId source_id : directory_pages_) {
+      auto source_res = pool_->FetchPageRead(source_id);
+      if (!source_res.ok()) {
+        discard_copies();
+        return source_res.status();
+      }
+      auto copy_res = pool_->NewPageWrite();
+      if (!copy_res.ok()) {
+        discard_copies();
+        return copy_res.status();
+      }
+      WritePageGuard copy = std::move(copy_res).value();
+      std::memcpy(copy.data().data(), source_res.value().data().data(),
+                  kPageSize);
+      directory_pages.push_back(copy.page_id());
+    }
+  }
+
+  const auto status = WriteHeader(global_depth_ + 1, directory_pages);
+  if (!status.ok()) {
+    discard_copies();
+    return status;
+  }
+  ++global_depth_;
+  directory_pages_ = std::move(directory_pages);
+  return Status::OK();
+}
+
+// Caller holds directory_latch_ exclusively.
+Status ExtendibleHashIndex::WriteHeader(
+    std::uint32_t global_depth, const std::vector<PageId>& directory_pages) {
+  if (directory_pages.size() > kMaxDirectoryPages) {
+    return Status::Internal("hash index directory is full");
+  }
+  auto header_res = pool_->FetchPageWrite(header_page_id_);
+  if (!header_res.ok()) {
+    return header_res.status();
+  }
+  IndexHeader header{};
+  header.global_depth = global_depth;
+  header.directory_page_count =
+      static_cast<std::uint32_t>(directory_pages.size());
+  std::memcpy(header.directory_pages, directory_pages.data(),
+              directory_pages.size() * sizeof(PageId));
+  std::memcpy(header_res.value().data().data() + kPageHeaderSize, &header,
+              sizeof(header));
+  return Status::OK();
+}
+
+Result<RecordId> ExtendibleHashIndex::Get(std::span<const std::byte> key) {
+  const std::uint32_t hash = Hash(key);
+  std::shared_lock lock(directory_latch_);
+  auto bucket_id = BucketFor(hash);
+  if (!bucket_id.ok()) {
+    return bucket_id.status();
+  }
+  auto bucket_res = pool_->FetchPageRead(bucket_id.value());
+  if (!bucket_res.ok()) {
+    return bucket_res.status();
+  }
+  const BucketView bucket(bucket_res.value().data());
+  const std::uint16_t index = bucket.Find(key, Fingerprint(hash));
+  if (index == bucket.count()) {
+    return Status::NotFound("key not found");
+  }
+  return bucket.ValueAt(index);
+}
+
+Status ExtendibleHashIndex::Delete(std::span<const std::byte> key) {
+  const std::uint32_t hash = Hash(key);
+  std::shared_lock lock(directory_latch_);
+  auto bucket_id = BucketFor(hash);
+  if (!bucket_id.ok()) {
+    return bucket_id.status();
+  }
+  auto bucket_res = pool_->FetchPageWrite(bucket_id.value());
+  if (!bucket_res.ok()) {
+    return bucket_res.status();
+  }
+  WritePageGuard guard = std::move(bucket_res).value();
+  Bucket bucket(guard.data());
+  const std::uint16_t index = bucket.Find(key, Fingerprint(hash));
+  if (index == bucket.count()) {
+    return Status::NotFound("key not found");
+  }
+  bucket.Remove(index);
+  return Status::OK();
+}
+
+std::uint32_t ExtendibleHashIndex::global_depth() {
+  std::shared_lock lock(directory_latch_);
+  return global_depth_;
+}
+
+}  // namespace simpledb
@@ -0,0 +1,92 @@
+#include "simpledb/frame_arena.h"
+
+#include <sys/mman.h>
+
+#include <cstdint>
+#include <new>
+
+#include "simpledb/page.h"
+
+namespace simpledb {
+
+namespace {
+
+std::size_t RoundUp(std::size_t value, std::size_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+void* MapAnonymous(std::size_t bytes, int extra_flags) {
+  return ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | extra_flags, -1, 0);
+}
+
+}  // namespace
+
+FrameArena::FrameArena(std::size_t pages, bool huge_pages) : pages_(pages) {
+  if (pages_ == 0) {
+    return;
+  }
+  const std::size_t bytes = pages_ * kPageSize;
+
+  if (huge_pages) {
+    // Hugetlb mappings come from the reserved pool, already faulted in by
+    // MAP_POPULATE; this fails when too few pages are reserved.
+    const std::size_t huge_bytes = RoundUp(bytes, kHugePageSize);
+    void* memory = MapAnonymous(huge_bytes, MAP_HUGETLB | MAP_POPULATE);
+    if (memory != MAP_FAILED) {
+      mapping_ = memory;
+      mapping_bytes_ = huge_bytes;
+      memory_ = static_cast<std::byte*>(memory);
+      backing_ = ArenaBacking::kHugeTlb;
+      return;
+    }
+
+    // Transparent huge pages only cover 2 MB-aligned ranges, so map one
+    // huge page extra and start the pages at the first boundary inside.
+    memory = MapAnonymous(huge_bytes + kHugePageSize, 0);
+    if (memory == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+    mapping_ = memory;
+    mapping_bytes_ = huge_bytes + kHugePageSize;
+    const auto address = reinterpret_cast<std::uintptr_t>(memory);
+    memory_ = reinterpret_cast<std::byte*>(RoundUp(address, kHugePageSize));
+    if (::madvise(memory_, huge_bytes, MADV_HUGEPAGE) == 0) {
+      backing_ = ArenaBacking::kTransparentHugePages;
+    }
+    Prefault();
+    return;
+  }
+
+  // Anonymous mappings are page-aligned and zero-filled.
+  void* memory = MapAnonymous(bytes, 0);
+  if (memory == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+  mapping_ = memory;
+  mapping_bytes_ = bytes;
+  memory_ = static_cast<std::byte*>(memory);
+}
+
+FrameArena::~FrameArena() {
+  if (mapping_ != nullptr) {
+    ::munmap(mapping_, mapping_bytes_);
+  }
+}
+
+std::span<std::byte> FrameArena::page(std::size_t index) const {
+  return {memory_ + index * kPageSize, kPageSize};
+}
+
+void FrameArena::Prefault() {
+  // A write fault is needed: a read would map the shared zero page. With
+  // THP each fault in a fresh 2 MB range allocates the whole huge page, and
+  // the rest of the writes then hit memory that is already there.
+  volatile std::byte* bytes = memory_;
+  for (std::size_t offset = 0; offset < pages_ * kPageSize;
+       offset += kPageSize) {
+    bytes[offset] = std::byte{0};
+  }
+}
+
+}  // namespace simpledb
@@ -0,0 +1,271 @@
+#include "simpledb/io_uring.h"
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+namespace simpledb {
+
+namespace {
+
+// user_data value reserved for the wake-up NOP submitted on shutdown.
+constexpr std::uint64_t kShutdownToken = 0;
+
+int SysSetup(unsigned entries, io_uring_params* params) {
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int SysEnter(int fd, unsigned to_submit, unsigned min_complete,
+             unsigned flags) {
+  return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit,
+                                    min_complete, flags, nullptr, 0));
+}
+
+unsigned LoadAcquire(unsigned* p) {
+  return std::atomic_ref<unsigned>(*p).load(std::memory_order_acquire);
+}
+
+void StoreRelease(unsigned* p, unsigned value) {
+  std::atomic_ref<unsigned>(*p).store(value, std::memory_order_release);
+}
+
+template <typename T>
+T* At(void* base, std::uint32_t offset) {
+  return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+}  // namespace
+
+struct IoUring::Request {
+  std::uint8_t opcode;
+  int fd;
+  char* data;
+  std::size_t remaining;
+  off_t offset;
+  Completion done;
+};
+
+Result<std::unique_ptr<IoUring>> IoUring::Create(unsigned queue_depth) {
+  io_uring_params params{};
+  const int ring_fd = SysSetup(std::max(queue_depth, 1U), &params);
+  if (ring_fd < 0) {
+    return Status::IoError("io_uring_setup failed");
+  }
+
+  std::unique_ptr<IoUring> ring(new IoUring(ring_fd, params.sq_entries));
+
+  // Stash the offsets the kernel reported; Map() turns them into pointers.
+  const std::size_t sq_size =
+      params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  const std::size_t cq_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  ring->sq_ring_size_ = single_mmap ? std::max(sq_size, cq_size) : sq_size;
+  ring->cq_ring_size_ = single_mmap ? 0 : cq_size;
+  ring->sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+
+  auto status = ring->Map();
+  if (!status.ok()) {
+    return status;
+  }
+
+  ring->sq_tail_ = At<unsigned>(ring->sq_ring_, params.sq_off.tail);
+  ring->sq_mask_ = *At<unsigned>(ring->sq_ring_, params.sq_off.ring_mask);
+  ring->sq_array_ = At<unsigned>(ring->sq_ring_, params.sq_off.array);
+  ring->cq_head_ = At<unsigned>(ring->cq_ring_, params.cq_off.head);
+  ring->cq_tail_ = At<unsigned>(ring->cq_ring_, params.cq_off.tail);
+  ring->cq_mask_ = *At<unsigned>(ring->cq_ring_, params.cq_off.ring_mask);
+  ring->cqes_ = At<void>(ring->cq_ring_, params.cq_off.cqes);
+
+  ring->reaper_ = std::thread([raw = ring.get()] { raw->Reap(); });
+  return ring;
+}
+
+IoUring::IoUring(int ring_fd, unsigned queue_depth)
+    : ring_fd_(ring_fd),
+      slots_(static_cast<std::ptrdiff_t>(queue_depth)) {}
+
+IoUring::~IoUring() {
+  if (reaper_.joinable()) {
+    stopping_.store(true, std::memory_order_release);
+    {
+      std::scoped_lock lock(submit_latch_);
+      Enqueue(IORING_OP_NOP, -1, 0, 0, 0, kShutdownToken);
+    }
+    reaper_.join();
+  }
+
+  if (sqes_ != nullptr) {
+    ::munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+    ::munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_ != nullptr) {
+    ::munmap(sq_ring_, sq_ring_size_);
+  }
+  ::close(ring_fd_);
+}
+
+Status IoUring::Map() {
+  sq_ring_ = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED) {
+    sq_ring_ = nullptr;
+    return Status::IoError("failed to map io_uring submission ring");
+  }
+
+  if (cq_ring_size_ == 0) {
+    cq_ring_ = sq_ring_;
+  } else {
+    cq_ring_ = ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED) {
+      cq_ring_ = nullptr;
+      return Status::IoError("failed to map io_uring completion ring");
+    }
+  }
+
+  void* sqes = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    return Status::IoError("failed to map io_uring entries");
+  }
+  sqes_ = static_cast<io_uring_sqe*>(sqes);
+  return Status::OK();
+}
+
+Status IoUring::SubmitRead(int fd, char* data, std::size_t size, off_t offset,
+                           Completion done) {
+  return Submit(new Request{IORING_OP_READ, fd, data, size, offset,
+                            std::move(done)});
+}
+
+Status IoUring::SubmitWrite(int fd, const char* data, std::size_t size,
+                            off_t offset, Completion done) {
+  return Submit(new Request{IORING_OP_WRITE, fd, const_cast<char*>(data), size,
+                            offset, std::move(done)});
+}
+
+Status IoUring::Submit(Request* request) {
+  slots_.acquire();
+  in_flight_.fetch_add(1, std::memory_order_relaxed);
+
+  Status status;
+  {
+    std::scoped_lock lock(submit_latch_);
+    status = Enqueue(request->opcode, request->fd,
+                     reinterpret_cast<std::uint64_t>(request->data),
+                     request->remaining, request->offset,
+                     reinterpret_cast<std::uint64_t>(request));
+  }
+
+  if (!status.ok()) {
+    delete request;
+    in_flight_.fetch_sub(1, std::memory_order_relaxed);
+    slots_.release();
+  }
+  return status;
+}
+
+// Caller holds submit_latch_. The semaphore bounds in-flight requests to the
+// ring size, so the submission ring always has a free entry here.
+Status IoUring::Enqueue(std::uint8_t opcode, int fd, std::uint64_t addr,
+                        std::size_t len, off_t offset,
+                        std::uint64_t user_data) {
+  const unsigned tail = *sq_tail_;
+  const unsigned index = tail & sq_mask_;
+
+  io_uring_sqe* sqe = &sqes_[index];
+  std::memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->addr = addr;
+  sqe->len = static_cast<std::uint32_t>(len);
+  sqe->off = static_cast<std::uint64_t>(offset);
+  sqe->user_data = user_data;
+
+  sq_array_[index] = index;
+  StoreRelease(sq_tail_, tail + 1);
+
+  while (true) {
+    const int ret = SysEnter(ring_fd_, 1, 0, 0);
+    if (ret >= 0) {
+      return Status::OK();
+    }
+    if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      // The kernel did not consume the entry; take it back.
+      StoreRelease(sq_tail_, tail);
+      return Status::IoError("io_uring_enter failed");
+    }
+  }
+}
+
+void IoUring::Reap() {
+  auto* cqes = static_cast<io_uring_cqe*>(cqes_);
+  while (true) {
+    unsigned head = *cq_head_;
+    const unsigned tail = LoadAcquire(cq_tail_);
+
+    if (head == tail) {
+      if (stopping_.load(std::memory_order_acquire) &&
+          in_flight_.load(std::memory_order_acquire) == 0) {
+        return;
+      }
+      SysEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS);
+      continue;
+    }
+
+    for (; head != tail; ++head) {
+      const io_uring_cqe cqe = cqes[head & cq_mask_];
+      StoreRelease(cq_head_, head + 1);
+      if (cqe.user_data != kShutdownToken) {
+        Complete(reinterpret_cast<Request*>(cqe.user_data), cqe.res);
+      }
+    }
+  }
+}
+
+void IoUring::Complete(Request* request, int result) {
+  Status status;
+  bool resubmit = false;
+
+  if (result == -EINTR || result == -EAGAIN) {
+    resubmit = true;
+  } else if (result < 0) {
+    status = Status::IoError(std::string("asynchronous I/O failed: ") +
+                             std::strerror(-result));
+  } else if (result == 0) {
+    status = Status::IoError("asynchronous I/O made no progress");
+  } else if (static_cast<std::size_t>(result) < request->remaining) {
+    request->data += result;
+    request->remaining -= static_cast<std::size_t>(result);
+    request->offset += result;
+    resubmit = true;
+  }
+
+  if (resubmit) {
+    // The request keeps its slot, so enqueue directly.
+    std::scoped_lock lock(submit_latch_);
+    status = Enqueue(request->opcode, request->fd,
+                     reinterpret_cast<std::uint64_t>(request->data),
+                     request->remaining, request->offset,
+                     reinterpret_cast<std::uint64_t>(request));
+    if (status.ok()) {
+      return;
+    }
+  }
+
+  request->done(std::move(status));
+  delete request;
+  in_flight_.fetch_sub(1, std::memory_order_acq_rel);
+  slots_.release();
+}
+
+}  // namespace simpledb
@@ -0,0 +1,624 @@
+#include "simpledb/log_manager.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include "simpledb/crc32c.h"
+#include "simpledb/disk_manager.h"
+#include "simpledb/page.h"
+#include "simpledb/status.h"
+
+namespace simpledb {
+
+namespace {
+
+// On-disk record: this header, then `data`. `size` covers both; the
+// checksum covers everything after itself.
+struct RecordHeader {
+  std::uint32_t size;
+  std::uint32_t checksum;
+  std::uint8_t type;
+  std::uint8_t reserved0;
+  std::uint16_t offset;
+  std::uint32_t reserved1;
+  std::uint64_t txn_id;
+  std::uint64_t page_id;
+};
+static_assert(sizeof(RecordHeader) == 32);
+
+constexpr std::size_t kChecksummedFrom =
+    offsetof(RecordHeader, checksum) + sizeof(std::uint32_t);
+constexpr std::size_t kMaxRecordSize = sizeof(RecordHeader) + kPageSize;
+// ReadLog reads the file in chunks of this size; a chunk always holds at
+// least one whole record.
+constexpr std::size_t kReadChunk = std::size_t{1} << 20;
+
+// Master record: the begin position of the latest checkpoint, guarded by a
+// magic number and a checksum, in one write well inside a sector.
+struct MasterRecord {
+  std::uint64_t magic;
+  std::uint64_t begin_lsn;
+  std::uint32_t checksum;
+  std::uint32_t reserved;
+};
+constexpr std::uint64_t kMasterMagic = 0x74706b6362646c73ULL;
+
+void Serialize(const LogRecord& record, std::vector<std::byte>& out) {
+  RecordHeader header{};
+  header.size = static_cast<std::uint32_t>(sizeof(header) + record.data.size());
+  header.type = static_cast<std::uint8_t>(record.type);
+  header.offset = record.offset;
+  header.txn_id = record.txn_id;
+  header.page_id = record.page_id;
+
+  const std::size_t start = out.size();
+  out.resize(start + header.size);
+  std::byte* bytes = out.data() + start;
+  std::memcpy(bytes, &header, sizeof(header));
+  if (!record.data.empty()) {
+    std::memcpy(bytes + sizeof(header), record.data.data(), record.data.size());
+  }
+  header.checksum =
+      Crc32c(bytes + kChecksummedFrom, header.size - kChecksummedFrom);
+  std::memcpy(bytes + offsetof(RecordHeader, checksum), &header.checksum,
+              sizeof(header.checksum));
+}
+
+// Parses the record at the front of `bytes`. Returns its size, or 0 if
+// `bytes` does not start with a whole, intact record.
+std::size_t Parse(std::span<const std::byte> bytes, LogRecord* record) {
+  if (bytes.size() < sizeof(RecordHeader)) {
+    return 0;
+  }
+  RecordHeader header;
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  if (header.size < sizeof(header) || header.size > kMaxRecordSize ||
+      header.size > bytes.size()) {
+    return 0;
+  }
+  if (header.checksum != Crc32c(bytes.data() + kChecksummedFrom,
+                                header.size - kChecksummedFrom)) {
+    return 0;
+  }
+  const auto type = static_cast<LogRecordType>(header.type);
+  if (type < LogRecordType::kUpdate || type > LogRecordType::kCheckpointEnd) {
+    return 0;
+  }
+  if (record != nullptr) {
+    record->type = type;
+    record->txn_id = header.txn_id;
+    record->page_id = header.page_id;
+    record->offset = header.offset;
+    record->data.assign(bytes.data() + sizeof(header),
+                        bytes.data() + header.size);
+  }
+  return header.size;
+}
+
+bool PreadFull(int fd, std::byte* data, std::size_t size, off_t offset) {
+  while (size > 0) {
+    const ssize_t n = ::pread(fd, data, size, offset);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    size -= static_cast<std::size_t>(n);
+    offset += n;
+  }
+  return true;
+}
+
+bool PwriteFull(int fd, const std::byte* data, std::size_t size,
+                off_t offset) {
+  while (size > 0) {
+    const ssize_t n = ::pwrite(fd, data, size, offset);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    size -= static_cast<std::size_t>(n);
+    offset += n;
+  }
+  return true;
+}
+
+}  // namespace
+
+LogManager::~LogManager() { Close(); }
+
+Status LogManager::Open(const std::filesystem::path& path,
+                        const LogManagerOptions& options) {
+  Close();
+
+  path_ = path;
+  buffer_bytes_ = std::max(options.buffer_bytes, kMaxRecordSize);
+  group_commit_delay_ = options.group_commit_delay;
+  group_commit_batch_ = std::max<std::size_t>(1, options.group_commit_batch);
+
+  fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    return Status::IoError("failed to open log file");
+  }
+  const auto status = TrimTornTail();
+  if (!status.ok()) {
+    Close();
+    return status;
+  }
+
+  buffer_.reserve(buffer_bytes_);
+  error_ = Status::OK();
+  stop_ = false;
+  writer_ = std::thread([this] { WriterLoop(); });
+  return Status::OK();
+}
+
+// Finds the end of the last intact record and truncates anything after it,
+// so new records never follow garbage.
+Status LogManager::TrimTornTail() {
+  struct stat st {};
+  if (::fstat(fd_, &st) != 0) {
+    return Status::IoError("failed to stat log file");
+  }
+  const auto file_size = static_cast<Lsn>(st.st_size);
+
+  Lsn end = kInvalidLsn;
+  auto status = ReadLog(kInvalidLsn, [&end](const LogRecord& record) {
+    end = record.lsn;
+    return true;
+  });
+  if (!status.ok()) {
+    return status;
+  }
+  if (end != file_size) {
+    if (::ftruncate(fd_, static_cast<off_t>(end)) != 0 ||
+        ::fdatasync(fd_) != 0) {
+      return Status::IoError("failed to truncate torn log tail");
+    }
+  }
+
+  buffer_lsn_ = end;
+  end_lsn_ = end;
+  flush_target_ = end;
+  flushed_lsn_.store(end, std::memory_order_release);
+  return Status::OK();
+}
+
+void LogManager::Close() {
+  if (writer_.joinable()) {
+    {
+      std::scoped_lock lock(latch_);
+      stop_ = true;
+      flush_target_ = end_lsn_;
+      urgent_ = true;
+    }
+    writer_cv_.notify_one();
+    writer_.join();
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+  buffer_.clear();
+  waiting_commits_ = 0;
+  urgent_ = false;
+  dirty_pages_.clear();
+  active_txns_.clear();
+}
+
+std::filesystem::path LogManager::master_path() const {
+  auto master = path_;
+  master += ".master";
+  return master;
+}
+
+Result<Lsn> LogManager::Append(const LogRecord& record) {
+  if (fd_ < 0) {
+    return Status::Internal("log is not open");
+  }
+  if (record.data.size() > kPageSize) {
+    return Status::InvalidArgument("log record too large");
+  }
+  if (record.type == LogRecordType::kUpdate &&
+      record.offset + record.data.size() > kPageSize) {
+    return Status::InvalidArgument("update outside page");
+  }
+
+  std::unique_lock lock(latch_);
+  return AppendLocked(lock, record);
+}
+
+// Appends under latch_, which is released while waiting for a full buffer to
+// drain. Keeps the dirty page table and the active transactions current.
+Result<Lsn> LogManager::AppendLocked(std::unique_lock<std::mutex>& lock,
+                                     const LogRecord& record) {
+  const std::size_t size = sizeof(RecordHeader) + record.data.size();
+  while (error_.ok() && !buffer_.empty() &&
+         buffer_.size() + size > buffer_bytes_) {
+    RequestFlush(end_lsn_, /*urgent=*/true);
+    const auto status = WaitFlushed(lock, end_lsn_);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  if (!error_.ok()) {
+    return error_;
+  }
+  Serialize(record, buffer_);
+  const Lsn start = end_lsn_;
+  end_lsn_ += size;
+
+  if (record.type == LogRecordType::kUpdate) {
+    auto [it, inserted] =
+        dirty_pages_.try_emplace(record.page_id, DirtyPage{start, end_lsn_});
+    if (!inserted) {
+      it->second.last_lsn = end_lsn_;
+    }
+    active_txns_.insert(record.txn_id);
+  } else if (record.type == LogRecordType::kCommit) {
+    active_txns_.erase(record.txn_id);
+  }
+  return end_lsn_;
+}
+
+Result<Lsn> LogManager::Update(std::uint64_t txn_id, Page& page,
+                               std::size_t offset,
+                               std::span<const std::byte> bytes) {
+  if (offset < kPageHeaderSize || offset + bytes.size() > kPageSize) {
+    return Status::InvalidArgument("update outside page body");
+  }
+  LogRecord record;
+  record.type = LogRecordType::kUpdate;
+  record.txn_id = txn_id;
+  record.page_id = page.id;
+  record.offset = static_cast<std::uint16_t>(offset);
+  record.data.assign(bytes.begin(), bytes.end());
+  auto lsn_res = Append(record);
+  if (!lsn_res.ok()) {
+    return lsn_res.status();
+  }
+
+  std::memcpy(page.data.data() + offset, bytes.data(), bytes.size());
+  SetPageLsn(page.data, lsn_res.value());
+  return lsn_res;
+}
+
+Result<Lsn> LogManager::Commit(std::uint64_t txn_id) {
+  LogRecord record;
+  record.type = LogRecordType::kCommit;
+  record.txn_id = txn_id;
+  auto lsn_res = Append(record);
+  if (!lsn_res.ok()) {
+    return lsn_res.status();
+  }
+
+  std::unique_lock lock(latch_);
+  ++waiting_commits_;
+  RequestFlush(lsn_res.value(), /*urgent=*/false);
+  const auto status = WaitFlushed(lock, lsn_res.value());
+  --waiting_commits_;
+  if (!status.ok()) {
+    return status;
+  }
+  return lsn_res;
+}
+
+Status LogManager::Flush(Lsn lsn) {
+  if (lsn <= flushed_lsn()) {
+    return Status::OK();
+  }
+  std::unique_lock lock(latch_);
+  lsn = std::min(lsn, end_lsn_);
+  RequestFlush(lsn, /*urgent=*/true);
+  return WaitFlushed(lock, lsn);
+}
+
+void LogManager::NotePageWritten(PageId page_id, Lsn lsn) {
+  std::scoped_lock lock(latch_);
+  const auto it = dirty_pages_.find(page_id);
+  if (it == dirty_pages_.end()) {
+    return;
+  }
+  if (it->second.last_lsn <= lsn) {
+    dirty_pages_.erase(it);
+  } else {
+    // Changes logged after the written image all start at or past its LSN.
+    it->second.rec_lsn = std::max(it->second.rec_lsn, lsn);
+  }
+}
+
+void LogManager::NotePageFreed(PageId page_id) {
+  std::scoped_lock lock(latch_);
+  dirty_pages_.erase(page_id);
+}
+
+Result<Lsn> LogManager::Checkpoint(DiskManager& data_file) {
+  if (fd_ < 0) {
+    return Status::Internal("log is not open");
+  }
+
+  // The begin record and the snapshot are taken under one hold of latch_,
+  // so no change slips between them.
+  LogRecord record;
+  record.type = LogRecordType::kCheckpointBegin;
+  Lsn begin_lsn = kInvalidLsn;
+  std::vector<DirtyPageEntry> dirty_pages;
+  std::vector<std::uint64_t> active_txns;
+  {
+    std::unique_lock lock(latch_);
+    auto lsn_res = AppendLocked(lock, record);
+    if (!lsn_res.ok()) {
+      return lsn_res.status();
+    }
+    begin_lsn = lsn_res.value() - sizeof(RecordHeader);
+    dirty_pages.reserve(dirty_pages_.size());
+    for (const auto& [page_id, dirty] : dirty_pages_) {
+      dirty_pages.push_back({page_id, dirty.rec_lsn});
+    }
+    active_txns.assign(active_txns_.begin(), active_txns_.end());
+  }
+
+  // Both lists go out in record-sized pieces; an empty list still gets one
+  // record.
+  auto append_chunks = [this](LogRecordType type, const std::byte* bytes,
+                              std::size_t size, std::size_t entry_size) {
+    const std::size_t chunk = kPageSize / entry_size * entry_size;
+    std::size_t offset = 0;
+    do {
+      const std::size_t length = std::min(chunk, size - offset);
+      LogRecord piece;
+      piece.type = type;
+      piece.data.assign(bytes + offset, bytes + offset + length);
+      auto lsn_res = Append(piece);
+      if (!lsn_res.ok()) {
+        return lsn_res.status();
+      }
+      offset += length;
+    } while (offset < size);
+    return Status::OK();
+  };
+  auto status = append_chunks(
+      LogRecordType::kCheckpointDirtyPages,
+      reinterpret_cast<const std::byte*>(dirty_pages.data()),
+      dirty_pages.size() * sizeof(dirty_pages[0]), sizeof(dirty_pages[0]));
+  if (status.ok()) {
+    status = append_chunks(
+        LogRecordType::kCheckpointTxns,
+        reinterpret_cast<const std::byte*>(active_txns.data()),
+        active_txns.size() * sizeof(active_txns[0]), sizeof(active_txns[0]));
+  }
+  if (!status.ok()) {
+    return status;
+  }
+
+  // Pages written before the snapshot left the table; they must not be
+  // lost in a crash once the checkpoint says they are clean.
+  status = data_file.Sync();
+  if (!status.ok()) {
+    return status;
+  }
+
+  record.type = LogRecordType::kCheckpointEnd;
+  record.data.resize(sizeof(begin_lsn));
+  std::memcpy(record.data.data(), &begin_lsn, sizeof(begin_lsn));
+  auto end_res = Append(record);
+  if (!end_res.ok()) {
+    return end_res.status();
+  }
+  status = Flush(end_res.value());
+  if (status.ok()) {
+    status = WriteMaster(begin_lsn);
+  }
+  if (!status.ok()) {
+    return status;
+  }
+  return begin_lsn;
+}
+
+Status LogManager::WriteMaster(Lsn begin_lsn) {
+  MasterRecord master{};
+  master.magic = kMasterMagic;
+  master.begin_lsn = begin_lsn;
+  master.checksum = Crc32c(reinterpret_cast<const std::byte*>(&master),
+                            offsetof(MasterRecord, checksum));
+
+  const int fd =
+      ::open(master_path().c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return Status::IoError("failed to open master record");
+  }
+  const bool ok = PwriteFull(fd, reinterpret_cast<const std::byte*>(&master),
+                             sizeof(master), 0) &&
+                  ::fdatasync(fd) == 0;
+  ::close(fd);
+  return ok ? Status::OK() : Status::IoError("failed to write master record");
+}
+
+Result<CheckpointRecord> LogManager::LastCheckpoint() const {
+  MasterRecord master{};
+  const int fd = ::open(master_path().c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return Status::NotFound("no checkpoint");
+  }
+  const bool read = PreadFull(fd, reinterpret_cast<std::byte*>(&master),
+                              sizeof(master), 0);
+  ::close(fd);
+  if (!read || master.magic != kMasterMagic ||
+      master.checksum !=
+          Crc32c(reinterpret_cast<const std::byte*>(&master),
+                  offsetof(MasterRecord, checksum))) {
+    return Status::NotFound("no checkpoint");
+  }
+
+  CheckpointRecord checkpoint;
+  checkpoint.begin_lsn = master.begin_lsn;
+  bool complete = false;
+  auto status = ReadLog(master.begin_lsn, [&](const LogRecord& record) {
+    switch (record.type) {
+      case LogRecordType::kCheckpointDirtyPages: {
+        const std::size_t count =
+            record.data.size() / sizeof(checkpoint.dirty_pages[0]);
+        const std::size_t old_size = checkpoint.dirty_pages.size();
+        checkpoint.dirty_pages.resize(old_size + count);
+        std::memcpy(checkpoint.dirty_pages.data() + old_size,
+                    record.data.data(),
+                    count * sizeof(checkpoint.dirty_pages[0]));
+        break;
+      }
+      case LogRecordType::kCheckpointTxns: {
+        const std::size_t count = record.data.size() / sizeof(std::uint64_t);
+        const std::size_t old_size = checkpoint.active_txns.size();
+        checkpoint.active_txns.resize(old_size + count);
+        std::memcpy(checkpoint.active_txns.data() + old_size,
+                    record.data.data(), count * sizeof(std::uint64_t));
+        break;
+      }
+      case LogRecordType::kCheckpointEnd:
+        complete = true;
+        return false;
+      default:
+        break;
+    }
+    return true;
+  });
+  if (!status.ok()) {
+    return status;
+  }
+  if (!complete) {
+    return Status::Internal("checkpoint end record missing");
+  }
+  return checkpoint;
+}
+
+Lsn LogManager::end_lsn() const {
+  std::scoped_lock lock(latch_);
+  return end_lsn_;
+}
+
+// Caller holds latch_.
+void LogManager::RequestFlush(Lsn lsn, bool urgent) {
+  flush_target_ = std::max(flush_target_, lsn);
+  if (urgent || waiting_commits_ >= group_commit_batch_) {
+    urgent_ = true;
+  }
+  writer_cv_.notify_one();
+}
+
+// Caller holds latch_ through `lock` and has requested the flush.
+Status LogManager::WaitFlushed(std::unique_lock<std::mutex>& lock, Lsn lsn) {
+  flushed_cv_.wait(lock, [&] {
+    return flushed_lsn_.load(std::memory_order_relaxed) >= lsn || !error_.ok();
+  });
+  return flushed_lsn_.load(std::memory_order_relaxed) >= lsn ? Status::OK()
+                                                              : error_;
+}
+
+// Writes and syncs whatever is buffered whenever someone waits on an LSN
+// that is not durable yet. For committers alone it first lingers up to the
+// group commit delay so that later commits ride on the same fdatasync.
+void LogManager::WriterLoop() {
+  std::vector<std::byte> batch;
+  batch.reserve(buffer_bytes_);
+  std::unique_lock lock(latch_);
+  while (true) {
+    writer_cv_.wait(lock, [this] {
+      return stop_ ||
+             (error_.ok() &&
+              flush_target_ > flushed_lsn_.load(std::memory_order_relaxed));
+    });
+    if (!error_.ok() ||
+        flush_target_ <= flushed_lsn_.load(std::memory_order_relaxed)) {
+      if (stop_) {
+        return;
+      }
+      continue;
+    }
+    if (!urgent_ && group_commit_delay_.count() > 0) {
+      writer_cv_.wait_for(lock, group_commit_delay_, [this] {
+        return stop_ || urgent_ || waiting_commits_ >= group_commit_batch_;
+      });
+    }
+    urgent_ = false;
+
+    batch.swap(buffer_);
+    const Lsn start = buffer_lsn_;
+    const Lsn end = end_lsn_;
+    buffer_lsn_ = end;
+    lock.unlock();
+
+    Status status;
+    if (!PwriteFull(fd_, batch.data(), batch.size(),
+                    static_cast<off_t>(start))) {
+      status = Status::IoError("failed to write log");
+    } else if (::fdatasync(fd_) != 0) {
+      status = Status::IoError("failed to sync log");
+    }
+    sync_count_.fetch_add(1, std::memory_order_relaxed);
+    batch.clear();
+
+    lock.lock();
+    if (status.ok()) {
+      flushed_lsn_.store(end, std::memory_order_release);
+    } else {
+      error_ = status;
+    }
+    flushed_cv_.notify_all();
+  }
+}
+
+Status LogManager::ReadLog(
+    Lsn from, const std::function<bool(const LogRecord&)>& fn) const {
+  if (fd_ < 0) {
+    return Status::Internal("log is not open");
+  }
+  struct stat st {};
+  if (::fstat(fd_, &st) != 0) {
+    return Status::IoError("failed to stat log file");
+  }
+  const auto file_end = static_cast<Lsn>(st.st_size);
+
+  std::vector<std::byte> chunk(kReadChunk);
+  LogRecord record;
+  Lsn position = from;
+  while (position < file_end) {
+    const std::size_t size =
+        static_cast<std::size_t>(std::min<Lsn>(kReadChunk, file_end - position));
+    if (!PreadFull(fd_, chunk.data(), size, static_cast<off_t>(position))) {
+      return Status::IoError("failed to read log");
+    }
+    std::size_t consumed = 0;
+    while (true) {
+      const std::size_t record_size = Parse(
+          std::span<const std::byte>(chunk.data() + consumed, size - consumed),
+          &record);
+      if (record_size == 0) {
+        break;
+      }
+      consumed += record_size;
+      record.lsn = position + consumed;
+      if (!fn(record)) {
+        return Status::OK();
+      }
+    }
+    // A chunk that ends mid-record is refilled from that record; one that
+    // cannot parse even a single record has reached the end of the log.
+    if (consumed == 0) {
+      break;
+    }
+    position += consumed;
+  }
+  return Status::OK();
+}
+
+}  // namespace simpledb
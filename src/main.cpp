@@ -6,8 +6,8 @@
 #include "simpledb/buffer_pool_manager.h"
 #include "simpledb/disk_manager.h"
 #include "simpledb/page.h"
-#include "simpledb/record.h"
 #include "simpledb/status.h"
+#include "simpledb/table_heap.h"
 
 int main() {
   using namespace simpledb;
@@ -23,58 +23,58 @@ int main() {
   auto buffer_pool_manager =
       std::make_unique<BufferPoolManager>(10, disk_manager.get());
 
-  Result<Page*> page_result = disk_manager->page_count() == 0
-                                  ? buffer_pool_manager->NewPage()
-                                  : buffer_pool_manager->FetchPage(0);
-  if (!page_result.ok()) {
-    std::cerr << "Failed to get page: " << page_result.status().message()
-              << "\n";
+  // The table heap's chain starts at page 0 of an existing database.
+  TableHeap table(buffer_pool_manager.get());
+  status = disk_manager->page_count() == 0 ? table.Create() : table.Open(0);
+  if (!status.ok()) {
+    std::cerr << "Failed to open table: " << status.message() << "\n";
     return 1;
   }
 
-  Page* page = page_result.value();
-  SlottedPage slotted(*page);
-
   const std::string sample = "hello from simple-db";
   const std::span<const std::byte> bytes{
       reinterpret_cast<const std::byte*>(sample.data()), sample.size()};
 
-  const auto slot_id = slotted.Insert(bytes);
-  if (!slot_id.ok()) {
-    std::cerr << "Insert failed: " << slot_id.status().message() << "\n";
-    buffer_pool_manager->UnpinPage(page->id, false);
+  const auto inserted = table.Insert(bytes);
+  if (!inserted.ok()) {
+    std::cerr << "Insert failed: " << inserted.status().message() << "\n";
     return 1;
   }
+  const RecordId record_id = inserted.value();
 
-  status = buffer_pool_manager->UnpinPage(page->id, true);
-  if (!status.ok()) {
-    std::cerr << "Unpin failed: " << status.message() << "\n";
+  auto record = table.Get(record_id);
+  if (!record.ok()) {
+    std::cerr << "Read failed: " << record.status().message() << "\n";
     return 1;
   }
+  const std::string roundtrip(
+      reinterpret_cast<const char*>(record.value().data()),
+      record.value().size());
 
-  auto loaded_page_res = buffer_pool_manager->FetchPage(page->id);
-  if (!loaded_page_res.ok()) {
-    std::cerr << "Reload failed: " << loaded_page_res.status().message() << "\n";
+  auto it_res = table.Begin();
+  if (!it_res.ok()) {
+    std::cerr << "Scan failed: " << it_res.status().message() << "\n";
     return 1;
   }
-  Page* loaded_page = loaded_page_res.value();
-
-  SlottedPage reloaded(*loaded_page);
-  auto record_view = reloaded.Get(slot_id.value());
-  if (!record_view.ok()) {
-    std::cerr << "Read failed: " << record_view.status().message() << "\n";
-    buffer_pool_manager->UnpinPage(loaded_page->id, false);
-    return 1;
+  std::size_t records = 0;
+  for (auto it = std::move(it_res).value(); it.Valid();) {
+    ++records;
+    status = it.Next();
+    if (!status.ok()) {
+      std::cerr << "Scan failed: " << status.message() << "\n";
+      return 1;
+    }
   }
 
-  const auto& viewed = record_view.value().data;
-  const std::string roundtrip(reinterpret_cast<const char*>(viewed.data()),
-                              viewed.size());
-
-  std::cout << "Page " << page->id << " slots=" << reloaded.slot_count()
-            << " free=" << reloaded.free_space() << " bytes\n";
+  std::cout << "Record at page " << record_id.page_id << " slot "
+            << record_id.slot << "; table holds " << records
+            << " records on " << table.page_count() << " pages\n";
   std::cout << "Round-trip record: " << roundtrip << "\n";
 
-  buffer_pool_manager->UnpinPage(loaded_page->id, false);
+  status = buffer_pool_manager->FlushAllPages();
+  if (!status.ok()) {
+    std::cerr << "Flush failed: " << status.message() << "\n";
+    return 1;
+  }
   return 0;
 }
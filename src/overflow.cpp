@@ -0,0 +1,150 @@
+#include "simpledb/overflow.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace simpledb {
+
+namespace {
+
+// After the PageHeader of each overflow page.
+struct OverflowHeader {
+  // The next page of the chain, or kInvalidPageId on the last.
+  PageId next_page_id;
+  std::uint32_t size;
+  std::uint32_t reserved;
+};
+
+constexpr std::size_t kDataStart = kPageHeaderSize + sizeof(OverflowHeader);
+
+OverflowHeader HeaderOf(std::span<const std::byte> page) {
+  OverflowHeader header;
+  std::memcpy(&header, page.data() + kPageHeaderSize, sizeof(header));
+  return header;
+}
+
+}  // namespace
+
+const std::size_t kOverflowPageCapacity = kPageSize - kDataStart;
+
+// Each page is linked to the next once that one exists, so the guard on
+// the previous page is held until then.
+Result<OverflowRef> WriteOverflow(BufferPoolManager* pool,
+                                  std::span<const std::byte> data) {
+  OverflowRef ref;
+  ref.size = data.size();
+  ref.contiguous = 1;
+  WritePageGuard previous;
+  for (std::size_t offset = 0; offset < data.size();
+       offset += kOverflowPageCapacity) {
+    auto guard_res = pool->NewPageWrite();
+    if (!guard_res.ok()) {
+      previous.Release();
+      // Best effort: the allocation failure is the error worth reporting.
+      static_cast<void>(FreeOverflow(pool, ref));
+      return guard_res.status();
+    }
+    WritePageGuard guard = std::move(guard_res).value();
+    const auto chunk = data.subspan(
+        offset, std::min(kOverflowPageCapacity, data.size() - offset));
+    const OverflowHeader header{kInvalidPageId,
+                                static_cast<std::uint32_t>(chunk.size()), 0};
+    SetPageType(guard.data(), PageType::kOverflow);
+    std::memcpy(guard.data().data() + kPageHeaderSize, &header,
+                sizeof(header));
+    std::memcpy(guard.data().data() + kDataStart, chunk.data(), chunk.size());
+
+    if (previous.valid()) {
+      const PageId next = guard.page_id();
+      std::memcpy(previous.data().data() + kPageHeaderSize, &next,
+                  sizeof(next));
+      if (next != previous.page_id() + 1) {
+        ref.contiguous = 0;
+      }
+    } else {
+      ref.first_page_id = guard.page_id();
+    }
+    ++ref.page_count;
+    previous = std::move(guard);
+  }
+  return ref;
+}
+
+Status ReadOverflow(BufferPoolManager* pool, const OverflowRef& ref,
+                    std::span<std::byte> out) {
+  if (out.size() < ref.size) {
+    return Status::InvalidArgument("buffer too small for overflow value");
+  }
+  std::size_t copied = 0;
+  PageId page_id = ref.first_page_id;
+  for (std::uint32_t i = 0; i < ref.page_count; ++i) {
+    if (ref.contiguous != 0 && ref.page_count > 1 &&
+        i % kOverflowPrefetchPages == 0) {
+      // Best effort: a page the pool could not prefetch is read below.
+      pool->Prefetch(ref.first_page_id + i,
+                     std::min<std::size_t>(kOverflowPrefetchPages,
+                                           ref.page_count - i));
+    }
+    auto guard_res = pool->FetchPageRead(page_id, AccessHint::kOneShot);
+    if (!guard_res.ok()) {
+      return guard_res.status();
+    }
+    const auto page = guard_res.value().data();
+    const OverflowHeader header = HeaderOf(page);
+    if (PageTypeOf(page) != PageType::kOverflow ||
+        header.size > kOverflowPageCapacity ||
+        copied + header.size > ref.size) {
+      return Status::Internal("corrupt overflow chain");
+    }
+    std::memcpy(out.data() + copied, page.data() + kDataStart, header.size);
+    copied += header.size;
+    page_id = header.next_page_id;
+  }
+  if (copied != ref.size) {
+    return Status::Internal("corrupt overflow chain");
+  }
+  return Status::OK();
+}
+
+// A contiguous chain is freed by page id alone; otherwise each page is
+// read for its link before it goes. A page that cannot be read leaves the
+// rest of the chain unreachable, so all of it is left over.
+Status FreeOverflow(BufferPoolManager* pool, const OverflowRef& ref,
+                    std::vector<OverflowRef>* left_over) {
+  Status result;
+  PageId page_id = ref.first_page_id;
+  for (std::uint32_t i = 0; i < ref.page_count; ++i) {
+    PageId next = ref.first_page_id + i + 1;
+    if (ref.contiguous == 0) {
+      auto guard_res = pool->FetchPageRead(page_id, AccessHint::kOneShot);
+      if (!guard_res.ok()) {
+        if (left_over != nullptr) {
+          OverflowRef rest;
+          rest.first_page_id = page_id;
+          rest.page_count = ref.page_count - i;
+          left_over->push_back(rest);
+        }
+        return guard_res.status();
+      }
+      next = HeaderOf(guard_res.value().data()).next_page_id;
+    }
+    const auto status = pool->DeletePage(page_id);
+    if (!status.ok()) {
+      if (left_over != nullptr) {
+        OverflowRef page;
+        page.first_page_id = page_id;
+        page.page_count = 1;
+        page.contiguous = 1;
+        left_over->push_back(page);
+      }
+      if (result.ok()) {
+        result = status;
+      }
+    }
+    page_id = next;
+  }
+  return result;
+}
+
+}  // namespace simpledb
@@ -1,11 +1,83 @@
 #include "simpledb/page.h"
 
 #include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "simpledb/crc32c.h"
+#include "simpledb/status.h"
 
 namespace simpledb {
 
+namespace {
+
+// The checksum covers everything after itself.
+constexpr std::size_t kChecksummedOffset =
+    offsetof(PageHeader, checksum) + sizeof(PageHeader::checksum);
+
+std::uint32_t ComputeChecksum(std::span<const std::byte> page) {
+  return Crc32c(page.data() + kChecksummedOffset,
+                kPageSize - kChecksummedOffset);
+}
+
+template <typename T>
+T LoadField(std::span<const std::byte> page, std::size_t offset) {
+  T value;
+  std::memcpy(&value, page.data() + offset, sizeof(value));
+  return value;
+}
+
+}  // namespace
+
 void ClearPage(Page& page) {
   std::fill(page.data.begin(), page.data.end(), std::byte{0});
 }
 
+Lsn PageLsn(std::span<const std::byte> page) {
+  return LoadField<Lsn>(page, offsetof(PageHeader, lsn));
+}
+
+void SetPageLsn(std::span<std::byte> page, Lsn lsn) {
+  std::memcpy(page.data() + offsetof(PageHeader, lsn), &lsn, sizeof(lsn));
+}
+
+PageType PageTypeOf(std::span<const std::byte> page) {
+  return LoadField<PageType>(page, offsetof(PageHeader, type));
+}
+
+void SetPageType(std::span<std::byte> page, PageType type) {
+  std::memcpy(page.data() + offsetof(PageHeader, type), &type, sizeof(type));
+}
+
+void SealPage(std::span<std::byte> page) {
+  const std::uint16_t version = kPageFormatVersion;
+  std::memcpy(page.data() + offsetof(PageHeader, version), &version,
+              sizeof(version));
+  const std::uint32_t checksum = ComputeChecksum(page);
+  std::memcpy(page.data() + offsetof(PageHeader, checksum), &checksum,
+              sizeof(checksum));
+}
+
+Status VerifyPage(std::span<const std::byte> page) {
+  const auto version =
+      LoadField<std::uint16_t>(page, offsetof(PageHeader, version));
+  if (version == 0) {
+    // Allocated but never written, unless something else is in it.
+    if (page[0] == std::byte{0} &&
+        std::memcmp(page.data(), page.data() + 1, kPageSize - 1) == 0) {
+      return Status::OK();
+    }
+    return Status::Internal("page checksum mismatch");
+  }
+  if (version != kPageFormatVersion) {
+    return Status::Internal("unknown page format version");
+  }
+  if (LoadField<std::uint32_t>(page, offsetof(PageHeader, checksum)) !=
+      ComputeChecksum(page)) {
+    return Status::Internal("page checksum mismatch");
+  }
+  return Status::OK();
+}
+
 }  // namespace simpledb
@@ -0,0 +1,104 @@
+#include "simpledb/page_guard.h"
+
+#include <utility>
+
+#include "simpledb/buffer_pool_manager.h"
+
+namespace simpledb {
+
+ReadPageGuard::ReadPageGuard(BufferPoolManager* bpm, Page* page,
+                             std::shared_mutex* latch)
+    : bpm_(bpm), page_(page), latch_(latch) {}
+
+ReadPageGuard::~ReadPageGuard() { Release(); }
+
+ReadPageGuard::ReadPageGuard(ReadPageGuard&& other) noexcept
+    : bpm_(std::exchange(other.bpm_, nullptr)),
+      page_(std::exchange(other.page_, nullptr)),
+      latch_(std::exchange(other.latch_, nullptr)) {}
+
+ReadPageGuard& ReadPageGuard::operator=(ReadPageGuard&& other) noexcept {
+  if (this != &other) {
+    Release();
+    bpm_ = std::exchange(other.bpm_, nullptr);
+    page_ = std::exchange(other.page_, nullptr);
+    latch_ = std::exchange(other.latch_, nullptr);
+  }
+  return *this;
+}
+
+void ReadPageGuard::Release() {
+  if (page_ == nullptr) {
+    return;
+  }
+  // Drop the latch before the pin: once unpinned the frame may be reused.
+  latch_->unlock_shared();
+  bpm_->UnpinPage(page_->id, false);
+  bpm_ = nullptr;
+  page_ = nullptr;
+  latch_ = nullptr;
+}
+
+WritePageGuard::WritePageGuard(BufferPoolManager* bpm, Page* page,
+                               std::shared_mutex* latch)
+    : bpm_(bpm), page_(page), latch_(latch) {}
+
+WritePageGuard::~WritePageGuard() { Release(); }
+
+WritePageGuard::WritePageGuard(WritePageGuard&& other) noexcept
+    : bpm_(std::exchange(other.bpm_, nullptr)),
+      page_(std::exchange(other.page_, nullptr)),
+      latch_(std::exchange(other.latch_, nullptr)) {}
+
+WritePageGuard& WritePageGuard::operator=(WritePageGuard&& other) noexcept {
+  if (this != &other) {
+    Release();
+    bpm_ = std::exchange(other.bpm_, nullptr);
+    page_ = std::exchange(other.page_, nullptr);
+    latch_ = std::exchange(other.latch_, nullptr);
+  }
+  return *this;
+}
+
+void WritePageGuard::Release() {
+  if (page_ == nullptr) {
+    return;
+  }
+  latch_->unlock();
+  bpm_->UnpinPage(page_->id, true);
+  bpm_ = nullptr;
+  page_ = nullptr;
+  latch_ = nullptr;
+}
+
+PageViewGuard::PageViewGuard(ReadPageGuard guard)
+    : guard_(std::move(guard)),
+      page_id_(guard_.page_id()),
+      data_(guard_.data()) {}
+
+PageViewGuard::PageViewGuard(PageId page_id,
+                             std::span<const std::byte> mapped)
+    : page_id_(page_id), data_(mapped) {}
+
+PageViewGuard::PageViewGuard(PageViewGuard&& other) noexcept
+    : guard_(std::move(other.guard_)),
+      page_id_(std::exchange(other.page_id_, kInvalidPageId)),
+      data_(std::exchange(other.data_, {})) {}
+
+PageViewGuard& PageViewGuard::operator=(PageViewGuard&& other) noexcept {
+  if (this != &other) {
+    Release();
+    guard_ = std::move(other.guard_);
+    page_id_ = std::exchange(other.page_id_, kInvalidPageId);
+    data_ = std::exchange(other.data_, {});
+  }
+  return *this;
+}
+
+void PageViewGuard::Release() {
+  guard_.Release();
+  page_id_ = kInvalidPageId;
+  data_ = {};
+}
+
+}  // namespace simpledb
@@ -0,0 +1,119 @@
+#include "simpledb/page_table.h"
+
+#include <algorithm>
+#include <bit>
+#include <utility>
+#include <vector>
+
+namespace simpledb {
+
+PageTable::PageTable(std::size_t max_entries)
+    : capacity_(std::bit_ceil(std::max<std::size_t>(8, max_entries * 2))),
+      mask_(capacity_ - 1),
+      slots_(std::make_unique<Slot[]>(capacity_)) {}
+
+std::size_t PageTable::Home(PageId page_id) const {
+  // murmur3 finalizer; the shard is picked from a different hash of the same
+  // id, so pages of one shard still spread over the whole table.
+  PageId h = page_id;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return static_cast<std::size_t>(h) & mask_;
+}
+
+std::optional<frame_id_t> PageTable::Find(PageId page_id) const {
+  std::size_t index = Home(page_id);
+  for (std::size_t probes = 0; probes < capacity_; ++probes) {
+    const Slot& slot = slots_[index];
+    const PageId key = slot.key.load(std::memory_order_acquire);
+    if (key == kEmpty) {
+      return std::nullopt;
+    }
+    if (key == page_id) {
+      const frame_id_t frame_id = slot.frame.load(std::memory_order_acquire);
+      // If the slot was reused while we read it, report a miss.
+      if (slot.key.load(std::memory_order_relaxed) != page_id) {
+        return std::nullopt;
+      }
+      return frame_id;
+    }
+    index = (index + 1) & mask_;
+  }
+  return std::nullopt;
+}
+
+bool PageTable::Insert(PageId page_id, frame_id_t frame_id) {
+  std::size_t index = Home(page_id);
+  std::optional<std::size_t> reuse;
+  std::size_t probes = 0;
+  for (; probes < capacity_; ++probes) {
+    const PageId key = slots_[index].key.load(std::memory_order_relaxed);
+    if (key == kEmpty) {
+      break;
+    }
+    if (key == kTombstone && !reuse) {
+      reuse = index;
+    }
+    index = (index + 1) & mask_;
+  }
+  if (probes == capacity_ && !reuse) {
+    return false;
+  }
+  if (reuse) {
+    index = *reuse;
+    --tombstones_;
+  }
+
+  // Publish the frame before the key so a reader that sees the key also
+  // sees its frame.
+  slots_[index].frame.store(frame_id, std::memory_order_release);
+  slots_[index].key.store(page_id, std::memory_order_release);
+  ++size_;
+  return true;
+}
+
+bool PageTable::Erase(PageId page_id) {
+  std::size_t index = Home(page_id);
+  for (std::size_t probes = 0; probes < capacity_; ++probes) {
+    const PageId key = slots_[index].key.load(std::memory_order_relaxed);
+    if (key == kEmpty) {
+      return false;
+    }
+    if (key == page_id) {
+      slots_[index].key.store(kTombstone, std::memory_order_release);
+      --size_;
+      ++tombstones_;
+      // Tombstones lengthen every probe; clear them out once they are a
+      // quarter of the table.
+      if (tombstones_ > capacity_ / 4) {
+        Rebuild();
+      }
+      return true;
+    }
+    index = (index + 1) & mask_;
+  }
+  return false;
+}
+
+void PageTable::Rebuild() {
+  std::vector<std::pair<PageId, frame_id_t>> live;
+  live.reserve(size_);
+  ForEach([&live](PageId page_id, frame_id_t frame_id) {
+    live.emplace_back(page_id, frame_id);
+  });
+
+  for (std::size_t i = 0; i < capacity_; ++i) {
+    slots_[i].key.store(kEmpty, std::memory_order_release);
+  }
+  size_ = 0;
+  tombstones_ = 0;
+  // Everything fit before, so everything fits again.
+  for (const auto& [page_id, frame_id] : live) {
+    static_cast<void>(Insert(page_id, frame_id));
+  }
+}
+
+}  // namespace simpledb
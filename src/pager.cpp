@@ -48,19 +48,18 @@ Status Pager::Open(const std::filesystem::path& path) {
   return Status::OK();
 }
 
-Result<Page> Pager::Allocate() {
+Result<PageId> Pager::Allocate() {
   const Status open_status = EnsureOpen();
   if (!open_status.ok()) {
     return open_status;
   }
 
-  Page page;
-  page.id = static_cast<PageId>(page_count_);
-  ClearPage(page);
+  const PageImage zeros;
+  const auto id = static_cast<PageId>(page_count_);
 
   file_.seekp(0, std::ios::end);
-  file_.write(reinterpret_cast<const char*>(page.data.data()),
-              static_cast<std::streamsize>(page.data.size()));
+  file_.write(reinterpret_cast<const char*>(zeros.bytes.data()),
+              static_cast<std::streamsize>(zeros.bytes.size()));
 
   if (!file_) {
     return Status::IoError("failed to write new page");
@@ -68,23 +67,21 @@ Result<Page> Pager::Allocate() {
 
   file_.flush();
   ++page_count_;
-  return page;
+  return id;
 }
 
-Result<Page> Pager::Load(PageId id) const {
+Status Pager::Load(Page& page) const {
   const Status open_status = EnsureOpen();
   if (!open_status.ok()) {
     return open_status;
   }
 
-  if (id >= page_count_) {
+  if (page.id >= page_count_) {
     return Status::NotFound("page id out of range");
   }
 
-  Page page;
-  page.id = id;
-
-  file_.seekg(static_cast<std::streamoff>(id) * kPageSize, std::ios::beg);
+  file_.seekg(static_cast<std::streamoff>(page.id) * kPageSize,
+              std::ios::beg);
   file_.read(reinterpret_cast<char*>(page.data.data()),
              static_cast<std::streamsize>(page.data.size()));
 
@@ -94,7 +91,7 @@ Result<Page> Pager::Load(PageId id) const {
     return Status::IoError("failed to read page");
   }
 
-  return page;
+  return Status::OK();
 }
 
 Status Pager::Flush(const Page& page) {
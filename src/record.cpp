@@ -1,97 +1,263 @@
 #include "simpledb/record.h"
 
+#include <array>
 #include <cstring>
-#include <limits>
 
 #include "simpledb/page.h"
 #include "simpledb/status.h"
 
 namespace simpledb {
 
-SlottedPage::SlottedPage(Page& page) : page_(page) {
-  auto& hdr = header();
+const std::size_t SlottedPageView::kMaxRecordSize =
+    kPageSize - kPageHeaderSize - sizeof(Header) - sizeof(Slot);
+
+SlottedPageView::SlottedPageView(const Page& page) : data_(page.data) {}
+
+SlottedPageView::SlottedPageView(std::span<const std::byte> data)
+    : data_(data) {}
+
+SlottedPage::SlottedPage(Page& page)
+    : SlottedPageView(page), mutable_page_(page) {
+  auto& hdr = mutable_header();
   if (hdr.slot_count == 0 && hdr.free_start == 0) {
-    hdr.free_start = static_cast<std::uint16_t>(sizeof(Header));
+    hdr.free_start =
+        static_cast<std::uint16_t>(kPageHeaderSize + sizeof(Header));
     hdr.slot_count = 0;
+    hdr.free_slots = 0;
+    hdr.fragmented_bytes = 0;
+    hdr.next_page_id = kInvalidPageId;
+    SetPageType(page.data, PageType::kSlotted);
   }
 }
 
-Result<std::uint16_t> SlottedPage::Insert(std::span<const std::byte> record) {
-  if (record.size() >
-      static_cast<std::size_t>(std::numeric_limits<std::uint16_t>::max())) {
+Result<std::uint16_t> SlottedPage::Insert(std::span<const std::byte> record,
+                                          bool overflow) {
+  if (record.size() > kMaxRecordSize) {
     return Status::InvalidArgument("record too large for page");
   }
 
-  const auto& hdr = header();
-  const std::size_t used_for_slots =
-      (static_cast<std::size_t>(hdr.slot_count) + 1) * sizeof(Slot);
-  const std::size_t space_limit =
-      kPageSize > used_for_slots ? kPageSize - used_for_slots : 0;
-
-  if (hdr.free_start + record.size() > space_limit) {
+  const bool reuse = header().free_slots > 0;
+  const auto offset = Allocate(record.size(), reuse ? 0 : sizeof(Slot));
+  if (offset == kTombstone) {
     return Status::InvalidArgument("not enough free space on page");
   }
 
-  auto& mutable_hdr = header();
-  const std::uint16_t slot_id = mutable_hdr.slot_count;
-  const auto offset = mutable_hdr.free_start;
-
-  std::memcpy(page_.data.data() + offset, record.data(), record.size());
-  mutable_hdr.free_start =
-      static_cast<std::uint16_t>(mutable_hdr.free_start + record.size());
-  mutable_hdr.slot_count =
-      static_cast<std::uint16_t>(mutable_hdr.slot_count + 1);
+  auto& hdr = mutable_header();
+  std::uint16_t slot_id = hdr.slot_count;
+  if (reuse) {
+    slot_id = 0;
+    while (IsLive(slot_id)) {
+      ++slot_id;
+    }
+    --hdr.free_slots;
+  } else {
+    ++hdr.slot_count;
+  }
 
-  auto* slot = slot_ptr(slot_id);
+  std::memcpy(mutable_page_.data.data() + offset, record.data(), record.size());
+  auto* slot = mutable_slot_ptr(slot_id);
   slot->offset = offset;
-  slot->size = static_cast<std::uint16_t>(record.size());
+  slot->size = static_cast<std::uint16_t>(record.size() |
+                                          (overflow ? kOverflowFlag : 0));
 
   return slot_id;
 }
 
-Result<RecordView> SlottedPage::Get(std::uint16_t slot_id) const {
+Status SlottedPage::Delete(std::uint16_t slot_id) {
+  if (!IsLive(slot_id)) {
+    return Status::NotFound("no record in slot");
+  }
+
+  auto* slot = mutable_slot_ptr(slot_id);
+  Release(slot->offset, SizeOf(*slot));
+  slot->offset = kTombstone;
+  slot->size = 0;
+
+  // Tombstones at the end of the directory give their space back.
+  auto& hdr = mutable_header();
+  ++hdr.free_slots;
+  while (hdr.slot_count > 0 && !IsLive(hdr.slot_count - 1)) {
+    --hdr.slot_count;
+    --hdr.free_slots;
+  }
+
+  CompactIfFragmented();
+  return Status::OK();
+}
+
+Status SlottedPage::Update(std::uint16_t slot_id,
+                           std::span<const std::byte> record, bool overflow) {
+  if (record.size() > kMaxRecordSize) {
+    return Status::InvalidArgument("record too large for page");
+  }
+  if (!IsLive(slot_id)) {
+    return Status::NotFound("no record in slot");
+  }
+
+  auto* slot = mutable_slot_ptr(slot_id);
+  const std::size_t offset = slot->offset;
+  const std::size_t old_size = SizeOf(*slot);
+  const auto new_size = static_cast<std::uint16_t>(record.size());
+  const auto new_size_field =
+      static_cast<std::uint16_t>(new_size | (overflow ? kOverflowFlag : 0));
+  std::byte* const bytes = mutable_page_.data.data();
+  auto& hdr = mutable_header();
+
+  // In place: shrinking, or growing into the free space that follows.
+  if (new_size <= old_size) {
+    std::memmove(bytes + offset, record.data(), new_size);
+    slot->size = new_size_field;
+    Release(offset + new_size, old_size - new_size);
+    CompactIfFragmented();
+    return Status::OK();
+  }
+  if (offset + old_size == hdr.free_start &&
+      contiguous_space() >= new_size - old_size) {
+    std::memcpy(bytes + offset, record.data(), new_size);
+    slot->size = new_size_field;
+    hdr.free_start = static_cast<std::uint16_t>(offset + new_size);
+    return Status::OK();
+  }
+
+  // Relocate. When the new copy only fits once the old one is gone, the
+  // old one is dropped before compacting.
+  if (contiguous_space() < new_size) {
+    if (contiguous_space() + hdr.fragmented_bytes + old_size < new_size) {
+      return Status::InvalidArgument("not enough free space on page");
+    }
+    slot->offset = kTombstone;
+    hdr.fragmented_bytes = static_cast<std::uint16_t>(hdr.fragmented_bytes +
+                                                      old_size);
+    Compact();
+  } else {
+    Release(offset, old_size);
+  }
+  const auto new_offset = Allocate(new_size, 0);
+  std::memcpy(bytes + new_offset, record.data(), new_size);
+  slot->offset = new_offset;
+  slot->size = new_size_field;
+  CompactIfFragmented();
+  return Status::OK();
+}
+
+// Copies the live records, in slot order, to a scratch page and back, so
+// that no record overwrites another before it has moved.
+void SlottedPage::Compact() {
+  std::array<std::byte, kPageSize> scratch;
+  std::byte* const bytes = mutable_page_.data.data();
+  const std::size_t start = kPageHeaderSize + sizeof(Header);
+  std::size_t end = start;
+  auto& hdr = mutable_header();
+  for (std::uint16_t slot_id = 0; slot_id < hdr.slot_count; ++slot_id) {
+    auto* slot = mutable_slot_ptr(slot_id);
+    if (slot->offset == kTombstone) {
+      continue;
+    }
+    std::memcpy(scratch.data() + end, bytes + slot->offset, SizeOf(*slot));
+    slot->offset = static_cast<std::uint16_t>(end);
+    end += SizeOf(*slot);
+  }
+  std::memcpy(bytes + start, scratch.data() + start, end - start);
+  hdr.free_start = static_cast<std::uint16_t>(end);
+  hdr.fragmented_bytes = 0;
+}
+
+void SlottedPage::CompactIfFragmented() {
+  if (header().fragmented_bytes > kCompactionThreshold) {
+    Compact();
+  }
+}
+
+std::uint16_t SlottedPage::Allocate(std::size_t size, std::size_t slot_bytes) {
+  if (contiguous_space() < size + slot_bytes) {
+    if (contiguous_space() + header().fragmented_bytes < size + slot_bytes) {
+      return kTombstone;
+    }
+    Compact();
+  }
+  auto& hdr = mutable_header();
+  const std::uint16_t offset = hdr.free_start;
+  hdr.free_start = static_cast<std::uint16_t>(offset + size);
+  return offset;
+}
+
+void SlottedPage::Release(std::size_t offset, std::size_t size) {
+  auto& hdr = mutable_header();
+  if (offset + size == hdr.free_start) {
+    hdr.free_start = static_cast<std::uint16_t>(offset);
+  } else {
+    hdr.fragmented_bytes =
+        static_cast<std::uint16_t>(hdr.fragmented_bytes + size);
+  }
+}
+
+Result<RecordView> SlottedPageView::Get(std::uint16_t slot_id) const {
   if (slot_id >= header().slot_count) {
     return Status::NotFound("slot id out of range");
   }
 
   const Slot* slot = slot_ptr(slot_id);
-  if (slot->offset + slot->size > kPageSize) {
+  if (slot->offset == kTombstone) {
+    return Status::NotFound("no record in slot");
+  }
+  if (slot->offset + SizeOf(*slot) > kPageSize) {
     return Status::Internal("slot metadata points outside page");
   }
 
-  const auto* start = page_.data.data() + slot->offset;
-  std::span<const std::byte> data(start, slot->size);
-  return RecordView{data};
+  const auto* start = data_.data() + slot->offset;
+  std::span<const std::byte> data(start, SizeOf(*slot));
+  return RecordView{data, (slot->size & kOverflowFlag) != 0};
 }
 
-std::uint16_t SlottedPage::slot_count() const { return header().slot_count; }
+bool SlottedPageView::IsLive(std::uint16_t slot_id) const {
+  return slot_id < header().slot_count &&
+         slot_ptr(slot_id)->offset != kTombstone;
+}
+
+std::uint16_t SlottedPageView::slot_count() const { return header().slot_count; }
 
-std::size_t SlottedPage::free_space() const {
+std::size_t SlottedPageView::free_space() const {
   const auto& hdr = header();
-  const std::size_t used_for_slots =
-      (static_cast<std::size_t>(hdr.slot_count) + 1) * sizeof(Slot);
-  const std::size_t space_limit =
-      kPageSize > used_for_slots ? kPageSize - used_for_slots : 0;
-  if (hdr.free_start >= space_limit) {
-    return 0;
-  }
-  return space_limit - hdr.free_start;
+  const std::size_t space = contiguous_space() + hdr.fragmented_bytes;
+  const std::size_t new_slot = hdr.free_slots > 0 ? 0 : sizeof(Slot);
+  return space > new_slot ? space - new_slot : 0;
+}
+
+std::size_t SlottedPageView::fragmented_space() const {
+  return header().fragmented_bytes;
+}
+
+PageId SlottedPageView::next_page_id() const { return header().next_page_id; }
+
+void SlottedPage::set_next_page_id(PageId page_id) {
+  mutable_header().next_page_id = page_id;
+}
+
+std::size_t SlottedPageView::contiguous_space() const {
+  const auto& hdr = header();
+  const std::size_t directory_start =
+      kPageSize - static_cast<std::size_t>(hdr.slot_count) * sizeof(Slot);
+  return directory_start > hdr.free_start ? directory_start - hdr.free_start
+                                          : 0;
 }
 
-SlottedPage::Header& SlottedPage::header() {
-  return *reinterpret_cast<Header*>(page_.data.data());
+const SlottedPageView::Header& SlottedPageView::header() const {
+  return *reinterpret_cast<const Header*>(data_.data() + kPageHeaderSize);
 }
 
-const SlottedPage::Header& SlottedPage::header() const {
-  return *reinterpret_cast<const Header*>(page_.data.data());
+const SlottedPageView::Slot* SlottedPageView::slot_ptr(
+    std::uint16_t index) const {
+  return reinterpret_cast<const Slot*>(data_.data() + kPageSize) -
+         (index + 1);
 }
 
-SlottedPage::Slot* SlottedPage::slot_ptr(std::uint16_t index) {
-  return reinterpret_cast<Slot*>(page_.data.data() + kPageSize) - (index + 1);
+SlottedPage::Header& SlottedPage::mutable_header() {
+  return *reinterpret_cast<Header*>(mutable_page_.data.data() +
+                                    kPageHeaderSize);
 }
 
-const SlottedPage::Slot* SlottedPage::slot_ptr(std::uint16_t index) const {
-  return reinterpret_cast<const Slot*>(page_.data.data() + kPageSize) -
+SlottedPage::Slot* SlottedPage::mutable_slot_ptr(std::uint16_t index) {
+  return reinterpret_cast<Slot*>(mutable_page_.data.data() + kPageSize) -
          (index + 1);
 }
 
@@ -0,0 +1,178 @@
+#include "simpledb/recovery.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "simpledb/page_guard.h"
+
+namespace simpledb {
+
+namespace {
+
+// Applies one worker's update records. Sorting by page id, stably, groups
+// each page's records without disturbing their LSN order. Pages are taken
+// `batch` at a time: prefetched as runs of consecutive ids, then fetched
+// one by one and brought up to date.
+Status ReplayPartition(BufferPoolManager& pool, std::vector<LogRecord> records,
+                       std::size_t batch, std::atomic<std::size_t>& applied,
+                       std::atomic<std::size_t>& pages) {
+  std::stable_sort(records.begin(), records.end(),
+                   [](const LogRecord& a, const LogRecord& b) {
+                     return a.page_id < b.page_id;
+                   });
+  std::vector<std::size_t> starts;
+  for (std::size_t i = 0; i < records.size(); ++i) {
+    if (i == 0 || records[i].page_id != records[i - 1].page_id) {
+      starts.push_back(i);
+    }
+  }
+  const std::size_t page_count = starts.size();
+  starts.push_back(records.size());
+  auto page_at = [&](std::size_t index) {
+    return records[starts[index]].page_id;
+  };
+
+  for (std::size_t first = 0; first < page_count; first += batch) {
+    const std::size_t last = std::min(first + batch, page_count);
+    for (std::size_t i = first; i < last;) {
+      std::size_t end = i + 1;
+      while (end < last && page_at(end) == page_at(end - 1) + 1) {
+        ++end;
+      }
+      // Only a hint; a page it could not load is read by the fetch below.
+      static_cast<void>(pool.Prefetch(page_at(i), end - i));
+      i = end;
+    }
+
+    for (std::size_t i = first; i < last; ++i) {
+      auto guard_res = pool.FetchPageWrite(page_at(i));
+      if (!guard_res.ok()) {
+        return guard_res.status();
+      }
+      WritePageGuard guard = std::move(guard_res).value();
+      Page& page = guard.page();
+      Lsn page_lsn = PageLsn(page.data);
+      for (std::size_t r = starts[i]; r < starts[i + 1]; ++r) {
+        const LogRecord& record = records[r];
+        if (record.lsn <= page_lsn) {
+          continue;
+        }
+        std::memcpy(page.data.data() + record.offset, record.data.data(),
+                    record.data.size());
+        page_lsn = record.lsn;
+        applied.fetch_add(1, std::memory_order_relaxed);
+      }
+      SetPageLsn(page.data, page_lsn);
+      pages.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
+Result<RecoveryStats> Recover(LogManager& log, DiskManager& disk_manager,
+                              BufferPoolManager& pool,
+                              const RecoveryOptions& options) {
+  const std::size_t threads = std::max<std::size_t>(1, options.threads);
+  const std::size_t batch = std::max<std::size_t>(1, options.prefetch_batch);
+  RecoveryStats stats;
+
+  // Analysis: the checkpoint bounds how far back the log must be read.
+  std::unordered_map<PageId, Lsn> dirty_pages;
+  std::unordered_set<std::uint64_t> uncommitted;
+  Lsn checkpoint_lsn = kInvalidLsn;
+  auto checkpoint_res = log.LastCheckpoint();
+  if (checkpoint_res.ok()) {
+    const CheckpointRecord& checkpoint = checkpoint_res.value();
+    checkpoint_lsn = checkpoint.begin_lsn;
+    stats.redo_lsn = checkpoint.begin_lsn;
+    for (const auto& entry : checkpoint.dirty_pages) {
+      dirty_pages.emplace(entry.page_id, entry.rec_lsn);
+      stats.redo_lsn = std::min(stats.redo_lsn, entry.rec_lsn);
+    }
+    uncommitted.insert(checkpoint.active_txns.begin(),
+                       checkpoint.active_txns.end());
+  } else if (checkpoint_res.status().code() != StatusCode::kNotFound) {
+    return checkpoint_res.status();
+  }
+
+  // Split the records worth replaying by page. Pages go to workers in
+  // blocks of `batch` consecutive ids, so prefetch runs stay long.
+  std::vector<std::vector<LogRecord>> partitions(threads);
+  PageId end_page = 0;
+  auto status = log.ReadLog(stats.redo_lsn, [&](const LogRecord& record) {
+    ++stats.records_scanned;
+    if (record.type == LogRecordType::kCommit) {
+      uncommitted.erase(record.txn_id);
+      return true;
+    }
+    if (record.type != LogRecordType::kUpdate) {
+      return true;
+    }
+    uncommitted.insert(record.txn_id);
+    if (checkpoint_lsn != kInvalidLsn && record.lsn <= checkpoint_lsn) {
+      // Before the checkpoint, only pages it listed as dirty can be
+      // missing a change, and only from their oldest unwritten one on.
+      const auto it = dirty_pages.find(record.page_id);
+      if (it == dirty_pages.end() || record.lsn <= it->second) {
+        return true;
+      }
+    }
+    end_page = std::max(end_page, record.page_id + 1);
+    partitions[(record.page_id / batch) % threads].push_back(record);
+    return true;
+  });
+  if (!status.ok()) {
+    return status;
+  }
+  stats.uncommitted_txns.assign(uncommitted.begin(), uncommitted.end());
+  std::sort(stats.uncommitted_txns.begin(), stats.uncommitted_txns.end());
+
+  // Pages allocated just before the crash may lie past the end of the file.
+  if (end_page > disk_manager.page_count()) {
+    auto allocated =
+        disk_manager.AllocatePages(end_page - disk_manager.page_count());
+    if (!allocated.ok()) {
+      return allocated.status();
+    }
+  }
+
+  std::atomic<std::size_t> applied{0};
+  std::atomic<std::size_t> pages{0};
+  std::vector<Status> results(threads);
+  std::vector<std::thread> workers;
+  for (std::size_t t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      results[t] = ReplayPartition(pool, std::move(partitions[t]), batch,
+                                   applied, pages);
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  for (const auto& result : results) {
+    if (!result.ok()) {
+      return result;
+    }
+  }
+  stats.records_applied = applied.load();
+  stats.pages = pages.load();
+
+  status = pool.FlushAllPages();
+  if (status.ok()) {
+    status = disk_manager.Sync();
+  }
+  if (!status.ok()) {
+    return status;
+  }
+  return stats;
+}
+
+}  // namespace simpledb
@@ -0,0 +1,221 @@
+#include "simpledb/replacer.h"
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+
+namespace simpledb {
+
+std::unique_ptr<Replacer> MakeReplacer(ReplacerPolicy policy,
+                                       std::size_t num_frames, std::size_t k) {
+  switch (policy) {
+    case ReplacerPolicy::kClock:
+      return std::make_unique<ClockReplacer>(num_frames);
+    case ReplacerPolicy::kLruK:
+      return std::make_unique<LruKReplacer>(num_frames, k);
+  }
+  return nullptr;
+}
+
+FrameList::FrameList(std::size_t num_frames)
+    : prev_(num_frames, kNil), next_(num_frames, kNil), linked_(num_frames, 0) {}
+
+void FrameList::PushBack(frame_id_t frame_id) {
+  prev_[frame_id] = tail_;
+  next_[frame_id] = kNil;
+  if (tail_ != kNil) {
+    next_[tail_] = frame_id;
+  } else {
+    head_ = frame_id;
+  }
+  tail_ = frame_id;
+  linked_[frame_id] = 1;
+  ++size_;
+}
+
+void FrameList::Remove(frame_id_t frame_id) {
+  const auto prev = prev_[frame_id];
+  const auto next = next_[frame_id];
+  if (prev != kNil) {
+    next_[prev] = next;
+  } else {
+    head_ = next;
+  }
+  if (next != kNil) {
+    prev_[next] = prev;
+  } else {
+    tail_ = prev;
+  }
+  prev_[frame_id] = kNil;
+  next_[frame_id] = kNil;
+  linked_[frame_id] = 0;
+  --size_;
+}
+
+ClockReplacer::ClockReplacer(std::size_t num_frames)
+    : ring_(num_frames), referenced_(num_frames, 0) {}
+
+void ClockReplacer::RecordAccess(frame_id_t frame_id) {
+  referenced_[frame_id] = 1;
+}
+
+void ClockReplacer::SetEvictable(frame_id_t frame_id, bool evictable) {
+  if (evictable && !ring_.Contains(frame_id)) {
+    ring_.PushBack(frame_id);
+  } else if (!evictable && ring_.Contains(frame_id)) {
+    ring_.Remove(frame_id);
+  }
+}
+
+std::optional<frame_id_t> ClockReplacer::Evict(
+    const std::function<bool(frame_id_t)>& try_evict) {
+  // Each pass clears at most one reference bit per frame, so the sweep is
+  // amortized O(1) per eviction.
+  std::size_t refusals = 2 * ring_.size() + 1;
+  while (!ring_.empty()) {
+    const auto frame_id = ring_.front();
+    ring_.Remove(frame_id);
+    if (referenced_[frame_id] != 0) {
+      referenced_[frame_id] = 0;
+      ring_.PushBack(frame_id);
+      continue;
+    }
+    if (!try_evict(frame_id)) {
+      referenced_[frame_id] = 1;
+      ring_.PushBack(frame_id);
+      if (--refusals == 0) {
+        break;
+      }
+      continue;
+    }
+    return frame_id;
+  }
+  return std::nullopt;
+}
+
+void ClockReplacer::Remove(frame_id_t frame_id) {
+  if (ring_.Contains(frame_id)) {
+    ring_.Remove(frame_id);
+  }
+  referenced_[frame_id] = 0;
+}
+
+void ClockReplacer::ForEachCandidate(
+    const std::function<bool(frame_id_t)>& fn) const {
+  // Unreferenced frames go on the hand's first pass, the rest on its second.
+  const bool done = ring_.ForEach([&](frame_id_t frame_id) {
+    return referenced_[frame_id] != 0 || fn(frame_id);
+  });
+  if (done) {
+    ring_.ForEach([&](frame_id_t frame_id) {
+      return referenced_[frame_id] == 0 || fn(frame_id);
+    });
+  }
+}
+
+LruKReplacer::LruKReplacer(std::size_t num_frames, std::size_t k)
+    : k_(std::max<std::size_t>(k, 1)),
+      times_(num_frames * k_, 0),
+      accesses_(num_frames, 0),
+      oldest_(num_frames, 0),
+      key_(num_frames, 0),
+      evictable_(num_frames, 0),
+      nodes_(num_frames),
+      positions_(num_frames) {}
+
+LruKReplacer::FrameSet& LruKReplacer::SetFor(frame_id_t frame_id) {
+  return accesses_[frame_id] >= k_ ? cache_ : history_;
+}
+
+void LruKReplacer::Link(frame_id_t frame_id) {
+  FrameSet& frames = SetFor(frame_id);
+  auto& node = nodes_[frame_id];
+  // Keys mostly grow, so the end is usually the right place.
+  if (node.empty()) {
+    positions_[frame_id] =
+        frames.emplace_hint(frames.end(), key_[frame_id], frame_id);
+  } else {
+    node.value().first = key_[frame_id];
+    positions_[frame_id] = frames.insert(frames.end(), std::move(node));
+  }
+}
+
+void LruKReplacer::Unlink(frame_id_t frame_id) {
+  nodes_[frame_id] = SetFor(frame_id).extract(positions_[frame_id]);
+}
+
+void LruKReplacer::RecordAccess(frame_id_t frame_id) {
+  const bool evictable = evictable_[frame_id] != 0;
+  if (evictable) {
+    Unlink(frame_id);
+  }
+
+  std::uint64_t* const times = times_.data() + frame_id * k_;
+  ++now_;
+  if (accesses_[frame_id] < k_) {
+    // Until the ring fills, the oldest access stays at index 0.
+    times[accesses_[frame_id]++] = now_;
+  } else {
+    times[oldest_[frame_id]] = now_;
+    oldest_[frame_id] = (oldest_[frame_id] + 1) % k_;
+  }
+  key_[frame_id] = times[oldest_[frame_id]];
+
+  if (evictable) {
+    Link(frame_id);
+  }
+}
+
+void LruKReplacer::SetEvictable(frame_id_t frame_id, bool evictable) {
+  if (evictable && evictable_[frame_id] == 0) {
+    Link(frame_id);
+  } else if (!evictable && evictable_[frame_id] != 0) {
+    Unlink(frame_id);
+  }
+  evictable_[frame_id] = evictable ? 1 : 0;
+}
+
+std::optional<frame_id_t> LruKReplacer::Evict(
+    const std::function<bool(frame_id_t)>& try_evict) {
+  // Two passes, each offering every frame once in eviction order, so that a
+  // frame refused only for a recent hit can still go on the second.
+  for (int pass = 0; pass < 2; ++pass) {
+    for (FrameSet* frames : {&history_, &cache_}) {
+      for (std::size_t offers = frames->size(); offers > 0; --offers) {
+        const auto frame_id = frames->begin()->second;
+        if (try_evict(frame_id)) {
+          Remove(frame_id);
+          return frame_id;
+        }
+        // To the back of its set, with its access history untouched.
+        Unlink(frame_id);
+        key_[frame_id] = ++now_;
+        Link(frame_id);
+      }
+    }
+  }
+  return std::nullopt;
+}
+
+void LruKReplacer::ForEachCandidate(
+    const std::function<bool(frame_id_t)>& fn) const {
+  for (const FrameSet* frames : {&history_, &cache_}) {
+    for (const auto& [key, frame_id] : *frames) {
+      if (!fn(frame_id)) {
+        return;
+      }
+    }
+  }
+}
+
+void LruKReplacer::Remove(frame_id_t frame_id) {
+  if (evictable_[frame_id] != 0) {
+    Unlink(frame_id);
+    evictable_[frame_id] = 0;
+  }
+  accesses_[frame_id] = 0;
+  oldest_[frame_id] = 0;
+  key_[frame_id] = 0;
+}
+
+}  // namespace simpledb
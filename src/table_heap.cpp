@@ -0,0 +1,457 @@
+#include "simpledb/table_heap.h"
+
+#include <cstring>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace simpledb {
+
+namespace {
+
+// A record in overflow pages is stored in its slotted page as its
+// OverflowRef followed by its prefix.
+static_assert(std::is_trivially_copyable_v<OverflowRef>);
+
+OverflowRef RefOf(const RecordView& view) {
+  OverflowRef ref;
+  std::memcpy(&ref, view.data.data(), sizeof(ref));
+  return ref;
+}
+
+std::span<const std::byte> PrefixOf(const RecordView& view) {
+  return view.data.subspan(sizeof(OverflowRef));
+}
+
+std::vector<std::byte> OverflowStub(const OverflowRef& ref,
+                                    std::span<const std::byte> prefix) {
+  std::vector<std::byte> stub(sizeof(ref) + prefix.size());
+  std::memcpy(stub.data(), &ref, sizeof(ref));
+  std::memcpy(stub.data() + sizeof(ref), prefix.data(), prefix.size());
+  return stub;
+}
+
+std::size_t RecordSizeOf(const RecordView& view) {
+  return view.overflow ? PrefixOf(view).size() + RefOf(view).size
+                       : view.data.size();
+}
+
+// The caller holds a latch on the record's page, which keeps the overflow
+// pages from being freed under the copy.
+Status CopyRecord(BufferPoolManager* pool, const RecordView& view,
+                  std::span<std::byte> out) {
+  if (out.size() < RecordSizeOf(view)) {
+    return Status::InvalidArgument("buffer too small for record");
+  }
+  if (!view.overflow) {
+    std::memcpy(out.data(), view.data.data(), view.data.size());
+    return Status::OK();
+  }
+  const auto prefix = PrefixOf(view);
+  std::memcpy(out.data(), prefix.data(), prefix.size());
+  return ReadOverflow(pool, RefOf(view), out.subspan(prefix.size()));
+}
+
+}  // namespace
+
+TableHeap::Iterator::Iterator(BufferPoolManager* pool, ReadPageGuard guard)
+    : pool_(pool), guard_(std::move(guard)) {}
+
+RecordView TableHeap::Iterator::record() const {
+  const RecordView view = SlottedPageView(guard_.data()).Get(slot_).value();
+  return view.overflow ? RecordView{PrefixOf(view), true} : view;
+}
+
+std::size_t TableHeap::Iterator::record_size() const {
+  return RecordSizeOf(SlottedPageView(guard_.data()).Get(slot_).value());
+}
+
+Status TableHeap::Iterator::Read(std::span<std::byte> out) const {
+  return CopyRecord(pool_, SlottedPageView(guard_.data()).Get(slot_).value(),
+                    out);
+}
+
+Status TableHeap::Iterator::Next() {
+  if (!Valid()) {
+    return Status::InvalidArgument("iterator is past the end");
+  }
+  return Seek(static_cast<std::uint16_t>(slot_ + 1));
+}
+
+Status TableHeap::Iterator::Seek(std::uint16_t from) {
+  for (;;) {
+    const SlottedPageView page(guard_.data());
+    for (std::uint16_t slot = from; slot < page.slot_count(); ++slot) {
+      if (page.IsLive(slot)) {
+        slot_ = slot;
+        return Status::OK();
+      }
+    }
+    const PageId next = page.next_page_id();
+    // Only one page stays pinned: this one goes before the next is read.
+    guard_.Release();
+    if (next == kInvalidPageId) {
+      return Status::OK();
+    }
+    auto guard_res = pool_->FetchPageRead(next, AccessHint::kSequential);
+    if (!guard_res.ok()) {
+      return guard_res.status();
+    }
+    guard_ = std::move(guard_res).value();
+    from = 0;
+  }
+}
+
+TableHeap::TableHeap(BufferPoolManager* pool) : pool_(pool) {}
+
+Status TableHeap::Create() {
+  auto guard_res = pool_->NewPageWrite();
+  if (!guard_res.ok()) {
+    return guard_res.status();
+  }
+  WritePageGuard guard = std::move(guard_res).value();
+  const SlottedPage page(guard.page());
+
+  std::scoped_lock append_lock(append_latch_);
+  std::scoped_lock lock(latch_);
+  first_page_id_ = guard.page_id();
+  last_page_id_ = first_page_id_;
+  free_space_.clear();
+  by_free_space_.clear();
+  NoteFreeSpace(first_page_id_, page.free_space());
+  return Status::OK();
+}
+
+// One pass over the chain rebuilds the free-space map. The walk takes no
+// heap latch, since latch_ may not be held across a page fetch; the result
+// is installed at the end.
+Status TableHeap::Open(PageId first_page_id) {
+  std::vector<std::pair<PageId, std::size_t>> pages;
+  for (PageId page_id = first_page_id; page_id != kInvalidPageId;) {
+    auto guard_res = pool_->FetchPageRead(page_id, AccessHint::kSequential);
+    if (!guard_res.ok()) {
+      return guard_res.status();
+    }
+    const ReadPageGuard guard = std::move(guard_res).value();
+    if (PageTypeOf(guard.data()) != PageType::kSlotted) {
+      return Status::InvalidArgument("not a table heap page");
+    }
+    const SlottedPageView page(guard.data());
+    pages.emplace_back(page_id, page.free_space());
+    page_id = page.next_page_id();
+  }
+
+  std::scoped_lock append_lock(append_latch_);
+  std::scoped_lock lock(latch_);
+  free_space_.clear();
+  by_free_space_.clear();
+  first_page_id_ = first_page_id;
+  last_page_id_ = pages.empty() ? kInvalidPageId : pages.back().first;
+  for (const auto& [page_id, free_space] : pages) {
+    NoteFreeSpace(page_id, free_space);
+  }
+  return Status::OK();
+}
+
+// The overflow pages are written first, so the record is complete before
+// any scan can see its slot.
+Result<RecordId> TableHeap::Insert(std::span<const std::byte> record) {
+  if (record.size() <= kMaxInlineSize) {
+    return InsertInline(record, false);
+  }
+  auto ref_res = WriteOverflow(pool_, record.subspan(kOverflowPrefixSize));
+  if (!ref_res.ok()) {
+    return ref_res.status();
+  }
+  const OverflowRef ref = ref_res.value();
+  auto record_id =
+      InsertInline(OverflowStub(ref, record.first(kOverflowPrefixSize)), true);
+  if (!record_id.ok()) {
+    FreeOverflowPages(ref);
+  }
+  return record_id;
+}
+
+Result<RecordId> TableHeap::InsertInline(std::span<const std::byte> bytes,
+                                         bool overflow) {
+  // The map can be stale by the time the page is latched; a page that
+  // turns out to be full has its entry corrected, and the search repeats.
+  for (;;) {
+    PageId page_id = kInvalidPageId;
+    {
+      std::scoped_lock lock(latch_);
+      const auto it = by_free_space_.lower_bound({bytes.size(), 0});
+      if (it != by_free_space_.end()) {
+        page_id = it->second;
+      }
+    }
+    if (page_id == kInvalidPageId) {
+      return AppendPage(bytes, overflow);
+    }
+
+    auto guard_res = pool_->FetchPageWrite(page_id);
+    if (!guard_res.ok()) {
+      return guard_res.status();
+    }
+    WritePageGuard guard = std::move(guard_res).value();
+    SlottedPage page(guard.page());
+    const auto slot = page.Insert(bytes, overflow);
+    {
+      std::scoped_lock lock(latch_);
+      NoteFreeSpace(page_id, page.free_space());
+    }
+    if (slot.ok()) {
+      return RecordId{page_id, slot.value()};
+    }
+    // A page too full for even a new slot reports zero free space, so an
+    // empty record can still be sent its way.
+    if (page.free_space() >= bytes.size()) {
+      guard.Release();
+      return AppendPage(bytes, overflow);
+    }
+  }
+}
+
+// Chains a new page on after the last one and puts the record there.
+Result<RecordId> TableHeap::AppendPage(std::span<const std::byte> bytes,
+                                       bool overflow) {
+  std::scoped_lock append_lock(append_latch_);
+  if (last_page_id_ == kInvalidPageId) {
+    return Status::InvalidArgument("table heap is not open");
+  }
+
+  auto new_res = pool_->NewPageWrite();
+  if (!new_res.ok()) {
+    return new_res.status();
+  }
+  WritePageGuard new_guard = std::move(new_res).value();
+  // Until it is chained on, the new page is reachable from nowhere; on
+  // failure it is freed again. Best effort: the first error is reported.
+  const auto discard = [this, &new_guard](const Status& status) {
+    const PageId page_id = new_guard.page_id();
+    new_guard.Release();
+    static_cast<void>(pool_->DeletePage(page_id));
+    return status;
+  };
+  SlottedPage new_page(new_guard.page());
+  const auto slot = new_page.Insert(bytes, overflow);
+  if (!slot.ok()) {
+    return discard(slot.status());
+  }
+
+  auto last_res = pool_->FetchPageWrite(last_page_id_);
+  if (!last_res.ok()) {
+    return discard(last_res.status());
+  }
+  WritePageGuard last_guard = std::move(last_res).value();
+  SlottedPage(last_guard.page()).set_next_page_id(new_guard.page_id());
+  last_page_id_ = new_guard.page_id();
+
+  std::scoped_lock lock(latch_);
+  NoteFreeSpace(new_guard.page_id(), new_page.free_space());
+  return RecordId{new_guard.page_id(), slot.value()};
+}
+
+Result<std::vector<std::byte>> TableHeap::Get(RecordId record_id) {
+  auto guard_res = FetchRead(record_id.page_id);
+  if (!guard_res.ok()) {
+    return guard_res.status();
+  }
+  const ReadPageGuard guard = std::move(guard_res).value();
+  const auto view = SlottedPageView(guard.data()).Get(record_id.slot);
+  if (!view.ok()) {
+    return view.status();
+  }
+  std::vector<std::byte> record(RecordSizeOf(view.value()));
+  const auto status = CopyRecord(pool_, view.value(), record);
+  if (!status.ok()) {
+    return status;
+  }
+  return record;
+}
+
+Result<std::size_t> TableHeap::RecordSize(RecordId record_id) {
+  auto guard_res = FetchRead(record_id.page_id);
+  if (!guard_res.ok()) {
+    return guard_res.status();
+  }
+  const ReadPageGuard guard = std::move(guard_res).value();
+  const auto view = SlottedPageView(guard.data()).Get(record_id.slot);
+  if (!view.ok()) {
+    return view.status();
+  }
+  return RecordSizeOf(view.value());
+}
+
+Result<std::size_t> TableHeap::Read(RecordId record_id,
+                                    std::span<std::byte> out) {
+  auto guard_res = FetchRead(record_id.page_id);
+  if (!guard_res.ok()) {
+    return guard_res.status();
+  }
+  const ReadPageGuard guard = std::move(guard_res).value();
+  const auto view = SlottedPageView(guard.data()).Get(record_id.slot);
+  if (!view.ok()) {
+    return view.status();
+  }
+  const auto status = CopyRecord(pool_, view.value(), out);
+  if (!status.ok()) {
+    return status;
+  }
+  return RecordSizeOf(view.value());
+}
+
+// The new overflow pages, if any, are written before the page is latched;
+// the old ones are freed once it has been let go.
+Status TableHeap::Update(RecordId record_id,
+                         std::span<const std::byte> record) {
+  const auto check_status = CheckPage(record_id.page_id);
+  if (!check_status.ok()) {
+    return check_status;
+  }
+  const bool overflow = record.size() > kMaxInlineSize;
+  OverflowRef new_ref;
+  std::vector<std::byte> stub;
+  if (overflow) {
+    auto ref_res = WriteOverflow(pool_, record.subspan(kOverflowPrefixSize));
+    if (!ref_res.ok()) {
+      return ref_res.status();
+    }
+    new_ref = ref_res.value();
+    stub = OverflowStub(new_ref, record.first(kOverflowPrefixSize));
+  }
+
+  std::optional<OverflowRef> old_ref;
+  Status status;
+  {
+    auto guard_res = pool_->FetchPageWrite(record_id.page_id);
+    if (guard_res.ok()) {
+      WritePageGuard guard = std::move(guard_res).value();
+      SlottedPage page(guard.page());
+      const auto old = page.Get(record_id.slot);
+      if (old.ok() && old.value().overflow) {
+        old_ref = RefOf(old.value());
+      }
+      status = page.Update(record_id.slot,
+                           overflow ? std::span<const std::byte>(stub) : record,
+                           overflow);
+      std::scoped_lock lock(latch_);
+      NoteFreeSpace(record_id.page_id, page.free_space());
+    } else {
+      status = guard_res.status();
+    }
+  }
+  if (!status.ok()) {
+    if (overflow) {
+      FreeOverflowPages(new_ref);
+    }
+    return status;
+  }
+  if (old_ref) {
+    FreeOverflowPages(*old_ref);
+  }
+  return Status::OK();
+}
+
+Status TableHeap::Delete(RecordId record_id) {
+  const auto check_status = CheckPage(record_id.page_id);
+  if (!check_status.ok()) {
+    return check_status;
+  }
+  std::optional<OverflowRef> ref;
+  {
+    auto guard_res = pool_->FetchPageWrite(record_id.page_id);
+    if (!guard_res.ok()) {
+      return guard_res.status();
+    }
+    WritePageGuard guard = std::move(guard_res).value();
+    SlottedPage page(guard.page());
+    const auto old = page.Get(record_id.slot);
+    if (old.ok() && old.value().overflow) {
+      ref = RefOf(old.value());
+    }
+    const auto status = page.Delete(record_id.slot);
+    std::scoped_lock lock(latch_);
+    NoteFreeSpace(record_id.page_id, page.free_space());
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  if (ref) {
+    FreeOverflowPages(*ref);
+  }
+  return Status::OK();
+}
+
+// The record is gone by the time its chain is freed, so a failure here is
+// not the caller's; what is left is kept for the next call instead.
+void TableHeap::FreeOverflowPages(const OverflowRef& ref) {
+  std::vector<OverflowRef> chains;
+  {
+    std::scoped_lock lock(latch_);
+    chains.swap(unfreed_overflow_);
+  }
+  chains.push_back(ref);
+  std::vector<OverflowRef> left_over;
+  for (const auto& chain : chains) {
+    static_cast<void>(FreeOverflow(pool_, chain, &left_over));
+  }
+  if (!left_over.empty()) {
+    std::scoped_lock lock(latch_);
+    unfreed_overflow_.insert(unfreed_overflow_.end(), left_over.begin(),
+                             left_over.end());
+  }
+}
+
+Result<TableHeap::Iterator> TableHeap::Begin() {
+  if (first_page_id_ == kInvalidPageId) {
+    return Status::InvalidArgument("table heap is not open");
+  }
+  auto guard_res =
+      pool_->FetchPageRead(first_page_id_, AccessHint::kSequential);
+  if (!guard_res.ok()) {
+    return guard_res.status();
+  }
+  Iterator it(pool_, std::move(guard_res).value());
+  const auto status = it.Seek(0);
+  if (!status.ok()) {
+    return status;
+  }
+  return it;
+}
+
+std::size_t TableHeap::page_count() {
+  std::scoped_lock lock(latch_);
+  return free_space_.size();
+}
+
+Result<ReadPageGuard> TableHeap::FetchRead(PageId page_id) {
+  const auto status = CheckPage(page_id);
+  if (!status.ok()) {
+    return status;
+  }
+  return pool_->FetchPageRead(page_id);
+}
+
+Status TableHeap::CheckPage(PageId page_id) {
+  std::scoped_lock lock(latch_);
+  if (!free_space_.contains(page_id)) {
+    return Status::NotFound("page is not part of the table heap");
+  }
+  return Status::OK();
+}
+
+// Caller holds latch_.
+void TableHeap::NoteFreeSpace(PageId page_id, std::size_t free_space) {
+  const auto [it, inserted] = free_space_.try_emplace(page_id, free_space);
+  if (!inserted) {
+    if (it->second == free_space) {
+      return;
+    }
+    by_free_space_.erase({it->second, page_id});
+    it->second = free_space;
+  }
+  by_free_space_.emplace(free_space, page_id);
+}
+
+}  // namespace simpledb
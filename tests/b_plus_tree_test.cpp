@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "index_test_util.h"
+#include "simpledb/b_plus_tree.h"
+#include "simpledb/buffer_pool_manager.h"
+#include "simpledb/disk_manager.h"
+
+namespace {
+
+using namespace simpledb;
+using namespace simpledb::test;
+
+// Variable-length keys that sort like their numbers.
+std::string Key(std::size_t n) {
+  char digits[16];
+  std::snprintf(digits, sizeof(digits), "%08zu", n);
+  return "key-" + std::string(digits) + std::string(n % 97, 'x');
+}
+
+// A full scan returns exactly the model, in key order.
+void CheckScan(BPlusTree& tree, const std::map<std::string, RecordId>& model) {
+  auto it_res = tree.Begin();
+  assert(it_res.ok());
+  BPlusTree::Iterator it = std::move(it_res).value();
+  auto expected = model.begin();
+  for (; it.Valid(); ++expected) {
+    assert(expected != model.end());
+    assert(Text(it.key()) == expected->first);
+    assert(it.value() == expected->second);
+    const Status next = it.Next();
+    assert(next.ok());
+  }
+  assert(expected == model.end());
+}
+
+void TestInsertGetDelete(const std::filesystem::path& path) {
+  Status status;
+  Fixture fixture(path);
+  BPlusTree tree(&fixture.pool);
+  status = tree.Get(Bytes("a")).status();
+  assert(status.code() == StatusCode::kInvalidArgument);
+  status = tree.Create();
+  assert(status.ok());
+  CheckScan(tree, {});
+  status = tree.Get(Bytes("a")).status();
+  assert(status.code() == StatusCode::kNotFound);
+
+  // Shuffled inserts split leaves and internal nodes alike.
+  std::vector<std::size_t> order(20000);
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::shuffle(order.begin(), order.end(), std::mt19937(7));
+  std::map<std::string, RecordId> model;
+  for (const std::size_t n : order) {
+    status = tree.Insert(Bytes(Key(n)), Value(n));
+    assert(status.ok());
+    model[Key(n)] = Value(n);
+  }
+  status = tree.Insert(Bytes(Key(5)), Value(0));
+  assert(status.code() == StatusCode::kInvalidArgument);
+  status = tree.Insert(Bytes(std::string(BPlusTree::kMaxKeySize + 1, 'k')),
+                       Value(0));
+  assert(status.code() == StatusCode::kInvalidArgument);
+  status =
+      tree.Insert(Bytes(std::string(BPlusTree::kMaxKeySize, 'k')), Value(1));
+  assert(status.ok());
+  model[std::string(BPlusTree::kMaxKeySize, 'k')] = Value(1);
+  status = tree.Insert(Bytes(""), Value(2));
+  assert(status.ok());
+  model[""] = Value(2);
+
+  // O(log n) levels: 20000 keys of ~70 bytes fit in three.
+  const std::size_t height = tree.height().value();
+  assert(height >= 2 && height <= 4);
+  for (std::size_t n = 0; n < order.size(); n += 13) {
+    auto value = tree.Get(Bytes(Key(n)));
+    assert(value.ok() && value.value() == Value(n));
+  }
+  CheckScan(tree, model);
+
+  // Range scan from a key between two others. The iterator holds a read
+  // latch on its leaf, so it goes before the deletes below.
+  {
+    auto range = tree.LowerBound(Bytes(Key(100) + "!"));
+    assert(range.ok());
+    BPlusTree::Iterator it = std::move(range).value();
+    for (std::size_t n = 101; n < 111; ++n) {
+      assert(it.Valid() && Text(it.key()) == Key(n));
+      status = it.Next();
+      assert(status.ok());
+    }
+  }
+
+  // Deletes leave empty leaves behind, which scans skip and inserts refill.
+  for (std::size_t n = 1000; n < 5000; ++n) {
+    status = tree.Delete(Bytes(Key(n)));
+    assert(status.ok());
+    model.erase(Key(n));
+  }
+  status = tree.Delete(Bytes(Key(1000)));
+  assert(status.code() == StatusCode::kNotFound);
+  status = tree.Get(Bytes(Key(1000))).status();
+  assert(status.code() == StatusCode::kNotFound);
+  CheckScan(tree, model);
+  assert(Text(tree.LowerBound(Bytes(Key(1000))).value().key()) == Key(5000));
+  for (std::size_t n = 1000; n < 5000; n += 2) {
+    status = tree.Insert(Bytes(Key(n)), Value(n));
+    assert(status.ok());
+    model[Key(n)] = Value(n);
+  }
+  CheckScan(tree, model);
+  assert(tree.height().value() == height);
+}
+
+void TestBulkLoad(const std::filesystem::path& path) {
+  Status status;
+  std::map<std::string, RecordId> model;
+  for (std::size_t n = 0; n < 50000; ++n) {
+    model[Key(n)] = Value(n);
+  }
+  std::vector<BPlusTree::Entry> entries;
+  for (const auto& [key, value] : model) {
+    entries.push_back({Bytes(key), value});
+  }
+
+  // A load that runs out of frames part way frees the pages it wrote and
+  // leaves the tree empty.
+  {
+    Fixture fixture(path, 2);
+    BPlusTree tree(&fixture.pool);
+    status = tree.Create();
+    assert(status.ok());
+    const std::size_t pages = fixture.disk_manager.page_count();
+    status = tree.BulkLoad(entries);
+    assert(!status.ok());
+    status = fixture.disk_manager.TruncateFreeTail().status();
+    assert(status.ok());
+    assert(fixture.disk_manager.page_count() == pages);
+    auto begin = tree.Begin();
+    assert(begin.ok() && !begin.value().Valid());
+  }
+
+  // A tree emptied by deletes keeps its internal nodes but still takes a
+  // load, and its old pages are freed: a second round reuses them.
+  {
+    Fixture fixture(path);
+    BPlusTree tree(&fixture.pool);
+    status = tree.Create();
+    assert(status.ok());
+    constexpr std::size_t kKeys = 2000;
+    const std::map<std::string, RecordId> loaded(
+        model.begin(), std::next(model.begin(), kKeys));
+    for (std::size_t n = 0; n < kKeys; ++n) {
+      status = tree.Insert(Bytes(Key(n)), Value(n));
+      assert(status.ok());
+    }
+    std::size_t pages = 0;
+    for (int round = 0; round < 2; ++round) {
+      assert(tree.height().value() > 1);
+      for (std::size_t n = 0; n < kKeys; ++n) {
+        status = tree.Delete(Bytes(Key(n)));
+        assert(status.ok());
+      }
+      status = tree.BulkLoad(std::span(entries).first(kKeys));
+      assert(status.ok());
+      CheckScan(tree, loaded);
+      if (round == 0) {
+        pages = fixture.disk_manager.page_count();
+      }
+    }
+    assert(fixture.disk_manager.page_count() == pages);
+  }
+
+  PageId header_page_id = kInvalidPageId;
+  {
+    Fixture fixture(path);
+    BPlusTree tree(&fixture.pool);
+    status = tree.Create();
+    assert(status.ok());
+    header_page_id = tree.header_page_id();
+
+    std::vector<BPlusTree::Entry> unsorted = {entries[1], entries[0]};
+    status = tree.BulkLoad(unsorted);
+    assert(status.code() == StatusCode::kInvalidArgument);
+    status = tree.BulkLoad(entries);
+    assert(status.ok());
+    status = tree.BulkLoad(entries);
+    assert(status.code() == StatusCode::kInvalidArgument);
+    CheckScan(tree, model);
+
+    // Inserts into a bulk-loaded tree find room without splitting at once.
+    for (std::size_t n = 0; n < 50000; n += 500) {
+      const std::string key = Key(n) + "+";
+      status = tree.Insert(Bytes(key), Value(n));
+      assert(status.ok());
+      model[key] = Value(n);
+    }
+    CheckScan(tree, model);
+    status = fixture.pool.FlushAllPages();
+    assert(status.ok());
+  }
+
+  // Found again from the header page alone.
+  DiskManager disk_manager;
+  status = disk_manager.Open(path);
+  assert(status.ok());
+  BufferPoolManager pool(8, &disk_manager);
+  BPlusTree tree(&pool);
+  status = tree.Open(header_page_id + 1);
+  assert(status.code() == StatusCode::kInvalidArgument);
+  status = tree.Open(header_page_id);
+  assert(status.ok());
+  assert(tree.height().value() == 3);
+  CheckScan(tree, model);
+  auto value = tree.Get(Bytes(Key(31337)));
+  assert(value.ok() && value.value() == Value(31337));
+}
+
+// Writers on disjoint key ranges split the same nodes while readers look
+// up keys that are already in.
+void TestConcurrent(const std::filesystem::path& path) {
+  Status status;
+  Fixture fixture(path, 64);
+  BPlusTree tree(&fixture.pool);
+  status = tree.Create();
+  assert(status.ok());
+  constexpr std::size_t kThreads = 4;
+  constexpr std::size_t kPerThread = 3000;
+  for (std::size_t n = 0; n < kPerThread; ++n) {
+    status = tree.Insert(Bytes(Key(n * kThreads * 2)), Value(n));
+    assert(status.ok());
+  }
+
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&tree, t] {
+      for (std::size_t n = 0; n < kPerThread; ++n) {
+        const std::size_t k = n * kThreads * 2 + 1 + t;
+        const Status inserted = tree.Insert(Bytes(Key(k)), Value(k));
+        assert(inserted.ok());
+        const std::size_t old = ((n * 31) % kPerThread) * kThreads * 2;
+        auto value = tree.Get(Bytes(Key(old)));
+        assert(value.ok() && value.value() == Value(old / (kThreads * 2)));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::size_t count = 0;
+  std::string previous;
+  auto it_res = tree.Begin();
+  assert(it_res.ok());
+  for (auto it = std::move(it_res).value(); it.Valid();) {
+    assert(count == 0 || previous < Text(it.key()));
+    previous = Text(it.key());
+    ++count;
+    status = it.Next();
+    assert(status.ok());
+  }
+  assert(count == kPerThread * (kThreads + 1));
+}
+
+}  // namespace
+
+int main() {
+  const auto path =
+      std::filesystem::temp_directory_path() / "simpledb_b_plus_tree_test.db";
+  TestInsertGetDelete(path);
+  TestBulkLoad(path);
+  TestConcurrent(path);
+  std::filesystem::remove(path);
+  std::cout << "b_plus_tree_test: success\n";
+  return 0;
+}
@@ -1,7 +1,11 @@
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "simpledb/buffer_pool_manager.h"
@@ -89,8 +93,563 @@ int main() {
   status = buffer_pool_manager->UnpinPage(fetched_page0->id, false);
   assert(status.ok());
 
+  // Page guards: two read guards share a page; a write guard unpins dirty
+  // and its changes survive eviction.
+  {
+    auto write_res = buffer_pool_manager->FetchPageWrite(1);
+    assert(write_res.ok());
+    WritePageGuard writer = std::move(write_res).value();
+    assert(writer.page_id() == 1);
+    writer.data()[100] = std::byte{0x5a};
+  }
+  {
+    auto first = buffer_pool_manager->FetchPageRead(1);
+    auto second = buffer_pool_manager->FetchPageRead(1);
+    assert(first.ok() && second.ok());
+    assert(first.value().data()[100] == std::byte{0x5a});
+    assert(&first.value().page() == &second.value().page());
+
+    // Both frames pinned by guards: nothing left to evict in a 2-frame pool.
+    auto other = buffer_pool_manager->FetchPageRead(2);
+    assert(other.ok());
+    status = buffer_pool_manager->FetchPage(0).status();
+    assert(status.code() == StatusCode::kInternal);
+
+    ReadPageGuard moved = std::move(other).value();
+    moved.Release();
+    assert(!moved.valid());
+  }
+  for (PageId id : {0, 2, 0, 2}) {
+    auto read_res = buffer_pool_manager->FetchPageRead(id);
+    assert(read_res.ok());
+  }
+  {
+    auto read_res = buffer_pool_manager->FetchPageRead(1);
+    assert(read_res.ok());
+    assert(read_res.value().data()[100] == std::byte{0x5a});
+  }
+
+  // Write guards serialize concurrent read-modify-write on one page.
+  {
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t) {
+      writers.emplace_back([&buffer_pool_manager] {
+        for (int i = 0; i < 200; ++i) {
+          auto res = buffer_pool_manager->FetchPageWrite(1);
+          assert(res.ok());
+          WritePageGuard guard = std::move(res).value();
+          auto& counter = guard.data()[200];
+          counter = static_cast<std::byte>(static_cast<int>(counter) + 1);
+        }
+      });
+    }
+    for (auto& writer : writers) {
+      writer.join();
+    }
+    auto res = buffer_pool_manager->FetchPageRead(1);
+    assert(res.ok());
+    assert(res.value().data()[200] == static_cast<std::byte>(800 % 256));
+  }
+
+  // Concurrent misses on the same page issue a single read; the other
+  // fetchers wait for it to complete and then pin the loaded frame.
+  buffer_pool_manager.reset();
+  DiskManagerOptions async_options;
+  async_options.backend = IoBackend::kIoUring;
+  status = disk_manager->Open(path, async_options);
+  assert(status.ok());
+  buffer_pool_manager =
+      std::make_unique<BufferPoolManager>(4, disk_manager.get());
+
+  std::vector<std::thread> fetchers;
+  for (int t = 0; t < 8; ++t) {
+    fetchers.emplace_back([&buffer_pool_manager, &slot_id0, &payload0] {
+      for (int round = 0; round < 100; ++round) {
+        for (PageId id = 0; id < 3; ++id) {
+          auto res = buffer_pool_manager->FetchPage(id);
+          assert(res.ok());
+          assert(res.value()->id == id);
+          if (id == 0) {
+            SlottedPage slotted(*res.value());
+            auto view = slotted.Get(slot_id0.value());
+            assert(view.ok());
+            assert(view.value().data.size() == payload0.size());
+          }
+          const Status unpinned = buffer_pool_manager->UnpinPage(id, false);
+          assert(unpinned.ok());
+        }
+      }
+    });
+  }
+  for (auto& fetcher : fetchers) {
+    fetcher.join();
+  }
+
+  // A failed read releases the frame instead of leaving a placeholder.
+  fetch_res = buffer_pool_manager->FetchPage(1000);
+  assert(fetch_res.status().code() == StatusCode::kNotFound);
+
+  // A sharded pool behaves like a single one: pages written through it
+  // survive eviction and are readable from any thread.
+  buffer_pool_manager.reset();
+  BufferPoolOptions sharded;
+  sharded.num_shards = 4;
+  buffer_pool_manager =
+      std::make_unique<BufferPoolManager>(16, disk_manager.get(), sharded);
+  assert(buffer_pool_manager->num_shards() == 4);
+
+  std::vector<PageId> ids;
+  for (int i = 0; i < 40; ++i) {
+    page_res = buffer_pool_manager->NewPage();
+    assert(page_res.ok());
+    Page* page = page_res.value();
+    page->data[kPageHeaderSize] = static_cast<std::byte>(page->id & 0xff);
+    ids.push_back(page->id);
+    status = buffer_pool_manager->UnpinPage(page->id, true);
+    assert(status.ok());
+  }
+
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t) {
+    readers.emplace_back([&buffer_pool_manager, &ids, t] {
+      for (int round = 0; round < 50; ++round) {
+        for (size_t i = t; i < ids.size(); i += 3) {
+          auto res = buffer_pool_manager->FetchPage(ids[i]);
+          assert(res.ok());
+          assert(res.value()->data[kPageHeaderSize] ==
+                 static_cast<std::byte>(ids[i] & 0xff));
+          const Status unpinned = buffer_pool_manager->UnpinPage(ids[i], false);
+          assert(unpinned.ok());
+        }
+      }
+    });
+  }
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  // Hits race with misses that evict the very frames being hit: every fetch
+  // must still return the page asked for, never a frame in transition.
+  buffer_pool_manager.reset();
+  BufferPoolOptions racy;
+  racy.num_shards = 2;
+  buffer_pool_manager =
+      std::make_unique<BufferPoolManager>(6, disk_manager.get(), racy);
+
+  std::vector<std::thread> racers;
+  for (int t = 0; t < 6; ++t) {
+    racers.emplace_back([&buffer_pool_manager, &ids, t] {
+      for (int round = 0; round < 200; ++round) {
+        // Even threads stay on a hot pair; odd ones sweep all pages.
+        const size_t i =
+            t % 2 == 0 ? (round % 2) : (round * 7 + t) % ids.size();
+        auto res = buffer_pool_manager->FetchPage(ids[i]);
+        if (!res.ok()) {
+          // Every frame of the shard can be momentarily pinned.
+          assert(res.status().code() == StatusCode::kInternal);
+          continue;
+        }
+        assert(res.value()->id == ids[i]);
+        assert(res.value()->data[kPageHeaderSize] ==
+               static_cast<std::byte>(ids[i] & 0xff));
+        const Status unpinned = buffer_pool_manager->UnpinPage(ids[i], false);
+        assert(unpinned.ok());
+      }
+    });
+  }
+  for (auto& racer : racers) {
+    racer.join();
+  }
+
+  // Prefetch fills free frames and recycles its own, never the hot set. A
+  // clean in-memory change to page 0 shows whether it was ever re-read.
+  buffer_pool_manager.reset();
+  buffer_pool_manager =
+      std::make_unique<BufferPoolManager>(8, disk_manager.get());
+  page_res = buffer_pool_manager->FetchPage(ids[0]);
+  assert(page_res.ok());
+  const std::byte marker = ~page_res.value()->data[kPageHeaderSize + 1];
+  page_res.value()->data[kPageHeaderSize + 1] = marker;
+  status = buffer_pool_manager->UnpinPage(ids[0], false);
+  assert(status.ok());
+
+  status = buffer_pool_manager->Prefetch(ids[1], 100);
+  assert(status.ok());
+  status = buffer_pool_manager->Prefetch(ids[20], 10);
+  assert(status.ok());
+  page_res = buffer_pool_manager->FetchPage(ids[0]);
+  assert(page_res.ok());
+  assert(page_res.value()->data[kPageHeaderSize + 1] == marker);
+  status = buffer_pool_manager->UnpinPage(ids[0], false);
+  assert(status.ok());
+
+  // A read-ahead page that a point fetch then hits has joined the hot set,
+  // and the next Prefetch leaves it alone.
+  buffer_pool_manager.reset();
+  buffer_pool_manager =
+      std::make_unique<BufferPoolManager>(8, disk_manager.get());
+  status = buffer_pool_manager->Prefetch(ids[0], 8);
+  assert(status.ok());
+  page_res = buffer_pool_manager->FetchPage(ids[0]);
+  assert(page_res.ok());
+  page_res.value()->data[kPageHeaderSize + 1] = marker;
+  status = buffer_pool_manager->UnpinPage(ids[0], false);
+  assert(status.ok());
+  status = buffer_pool_manager->Prefetch(ids[8], 8);
+  assert(status.ok());
+  page_res = buffer_pool_manager->FetchPage(ids[0]);
+  assert(page_res.ok());
+  assert(page_res.value()->data[kPageHeaderSize + 1] == marker);
+  status = buffer_pool_manager->UnpinPage(ids[0], false);
+  assert(status.ok());
+
+  // A sequential scan through a pool much smaller than the table triggers
+  // read-ahead and still sees every page intact.
+  for (int pass = 0; pass < 2; ++pass) {
+    for (const PageId id : ids) {
+      auto res = buffer_pool_manager->FetchPage(id);
+      assert(res.ok());
+      assert(res.value()->id == id);
+      assert(res.value()->data[kPageHeaderSize] ==
+             static_cast<std::byte>(id & 0xff));
+      status = buffer_pool_manager->UnpinPage(id, false);
+      assert(status.ok());
+    }
+  }
+
+  // Hinted scans recycle a small ring of frames and leave the hot set alone;
+  // the same scan without a hint flushes it. Hot pages carry a clean
+  // in-memory marker that survives only if they are never re-read.
+  for (const auto hint : {AccessHint::kOneShot, AccessHint::kSequential,
+                          AccessHint::kNormal}) {
+    buffer_pool_manager.reset();
+    BufferPoolOptions no_read_ahead;
+    no_read_ahead.read_ahead_pages = 0;
+    buffer_pool_manager = std::make_unique<BufferPoolManager>(
+        8, disk_manager.get(), no_read_ahead);
+    for (int i = 0; i < 4; ++i) {
+      page_res = buffer_pool_manager->FetchPage(ids[i]);
+      assert(page_res.ok());
+      page_res.value()->data[kPageHeaderSize + 1] = marker;
+      status = buffer_pool_manager->UnpinPage(ids[i], false);
+      assert(status.ok());
+    }
+
+    for (size_t i = 4; i < ids.size(); ++i) {
+      auto res = buffer_pool_manager->FetchPage(ids[i], hint);
+      assert(res.ok());
+      assert(res.value()->data[kPageHeaderSize] ==
+             static_cast<std::byte>(ids[i] & 0xff));
+      status = buffer_pool_manager->UnpinPage(ids[i], false);
+      assert(status.ok());
+    }
+
+    for (int i = 0; i < 4; ++i) {
+      page_res = buffer_pool_manager->FetchPage(ids[i]);
+      assert(page_res.ok());
+      assert((page_res.value()->data[kPageHeaderSize + 1] == marker) ==
+             (hint != AccessHint::kNormal));
+      status = buffer_pool_manager->UnpinPage(ids[i], false);
+      assert(status.ok());
+    }
+  }
+
+  // LRU-K keeps pages fetched more than once through a one-pass scan of
+  // point fetches, which CLOCK lets flush them. Their repeat fetches are
+  // lock-free hits, so this holds only if the pool passes those on to the
+  // replacer as accesses.
+  for (const auto policy : {ReplacerPolicy::kLruK, ReplacerPolicy::kClock}) {
+    buffer_pool_manager.reset();
+    BufferPoolOptions scan_options;
+    scan_options.replacer = policy;
+    scan_options.read_ahead_pages = 0;
+    buffer_pool_manager = std::make_unique<BufferPoolManager>(
+        8, disk_manager.get(), scan_options);
+    for (int round = 0; round < 3; ++round) {
+      for (int i = 0; i < 4; ++i) {
+        page_res = buffer_pool_manager->FetchPage(ids[i]);
+        assert(page_res.ok());
+        page_res.value()->data[kPageHeaderSize + 1] = marker;
+        status = buffer_pool_manager->UnpinPage(ids[i], false);
+        assert(status.ok());
+      }
+    }
+
+    for (size_t i = 4; i < ids.size(); ++i) {
+      page_res = buffer_pool_manager->FetchPage(ids[i]);
+      assert(page_res.ok());
+      status = buffer_pool_manager->UnpinPage(ids[i], false);
+      assert(status.ok());
+    }
+
+    for (int i = 0; i < 4; ++i) {
+      page_res = buffer_pool_manager->FetchPage(ids[i]);
+      assert(page_res.ok());
+      assert((page_res.value()->data[kPageHeaderSize + 1] == marker) ==
+             (policy == ReplacerPolicy::kLruK));
+      status = buffer_pool_manager->UnpinPage(ids[i], false);
+      assert(status.ok());
+    }
+  }
+
+  // With both watermarks at the whole shard, the page cleaner writes every
+  // dirty unpinned page back on its own, without a flush.
+  buffer_pool_manager.reset();
+  BufferPoolOptions eager_cleaner;
+  eager_cleaner.clean_low_watermark = 1.0;
+  eager_cleaner.clean_high_watermark = 1.0;
+  eager_cleaner.cleaner_interval = std::chrono::milliseconds(1);
+  buffer_pool_manager = std::make_unique<BufferPoolManager>(
+      8, disk_manager.get(), eager_cleaner);
+  for (int i = 0; i < 8; ++i) {
+    page_res = buffer_pool_manager->FetchPage(ids[i]);
+    assert(page_res.ok());
+    page_res.value()->data[kPageHeaderSize + 2] = std::byte{0x5a};
+    status = buffer_pool_manager->UnpinPage(ids[i], true);
+    assert(status.ok());
+  }
+
+  std::vector<char> on_disk(kPageSize);
+  for (int i = 0; i < 8; ++i) {
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    do {
+      status = disk_manager->ReadPage(ids[i], on_disk.data());
+      assert(status.ok());
+      if (on_disk[kPageHeaderSize + 2] == 0x5a) {
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    } while (std::chrono::steady_clock::now() < deadline);
+    assert(on_disk[kPageHeaderSize + 2] == 0x5a);
+  }
+
+  // FlushAllPages writes runs of adjacent pages that span shards; every page
+  // lands at its own offset.
+  buffer_pool_manager.reset();
+  BufferPoolOptions flushing;
+  flushing.num_shards = 4;
+  flushing.page_cleaner = false;
+  buffer_pool_manager = std::make_unique<BufferPoolManager>(
+      64, disk_manager.get(), flushing);
+  for (const PageId id : ids) {
+    page_res = buffer_pool_manager->FetchPage(id);
+    assert(page_res.ok());
+    page_res.value()->data[kPageHeaderSize + 3] =
+        static_cast<std::byte>(~id & 0xff);
+    // Leave a gap so the flush has more than one run.
+    status = buffer_pool_manager->UnpinPage(id, id % 10 != 5);
+    assert(status.ok());
+  }
+  status = buffer_pool_manager->FlushAllPages();
+  assert(status.ok());
+  for (const PageId id : ids) {
+    status = disk_manager->ReadPage(id, on_disk.data());
+    assert(status.ok());
+    assert(on_disk[kPageHeaderSize] == static_cast<char>(id & 0xff));
+    assert(on_disk[kPageHeaderSize + 3] ==
+           (id % 10 != 5 ? static_cast<char>(~id & 0xff) : 0));
+  }
+
+  // Deleting a pinned page fails; deleting it once unpinned drops the
+  // frame, and the next NewPage reuses the page id, zero-filled.
+  page_res = buffer_pool_manager->FetchPage(ids[7]);
+  assert(page_res.ok());
+  status = buffer_pool_manager->DeletePage(ids[7]);
+  assert(status.code() == StatusCode::kInternal);
+  status = buffer_pool_manager->UnpinPage(ids[7], true);
+  assert(status.ok());
+  status = buffer_pool_manager->DeletePage(ids[7]);
+  assert(status.ok());
+  status = buffer_pool_manager->UnpinPage(ids[7], false);
+  assert(status.code() == StatusCode::kInternal);
+  page_res = buffer_pool_manager->NewPage();
+  assert(page_res.ok());
+  assert(page_res.value()->id == ids[7]);
+  assert(page_res.value()->data[kPageHeaderSize] == std::byte{0});
+  status = buffer_pool_manager->UnpinPage(ids[7], false);
+  assert(status.ok());
+  status = disk_manager->ReadPage(ids[7], on_disk.data());
+  assert(status.ok());
+  assert(on_disk[kPageHeaderSize] == 0);
+
+  // A write-back's pin does not make a delete fail: the delete waits for
+  // the write to finish. The flush pins both dirty pages, then stalls
+  // copying ids[0] while another thread holds its write latch.
+  {
+    page_res = buffer_pool_manager->NewPage();
+    assert(page_res.ok());
+    const PageId id = page_res.value()->id;
+    assert(id > ids[0]);
+    status = buffer_pool_manager->UnpinPage(id, true);
+    assert(status.ok());
+    status = buffer_pool_manager->FetchPage(ids[0]).status();
+    assert(status.ok());
+    status = buffer_pool_manager->UnpinPage(ids[0], true);
+    assert(status.ok());
+    std::atomic<bool> latched{false};
+    std::thread writer([&buffer_pool_manager, &ids, &latched] {
+      auto guard_res = buffer_pool_manager->FetchPageWrite(ids[0]);
+      assert(guard_res.ok());
+      latched.store(true);
+      latched.notify_one();
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    });
+    latched.wait(false);
+    std::thread flusher([&buffer_pool_manager] {
+      const Status flushed = buffer_pool_manager->FlushAllPages();
+      assert(flushed.ok());
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    status = buffer_pool_manager->DeletePage(id);
+    assert(status.ok());
+    writer.join();
+    flusher.join();
+    auto truncated = disk_manager->TruncateFreeTail();
+    assert(truncated.ok() && truncated.value() == 1);
+  }
+
+  // A NewPage that finds every frame pinned gives its page back: the file
+  // does not grow, and a free page stays free for the next NewPage.
+  buffer_pool_manager.reset();
+  buffer_pool_manager =
+      std::make_unique<BufferPoolManager>(2, disk_manager.get());
+  for (const bool reuse : {false, true}) {
+    if (reuse) {
+      status = buffer_pool_manager->DeletePage(ids[7]);
+      assert(status.ok());
+    }
+    const size_t pages = disk_manager->page_count();
+    for (int i = 0; i < 2; ++i) {
+      status = buffer_pool_manager->FetchPage(ids[i]).status();
+      assert(status.ok());
+    }
+    status = buffer_pool_manager->NewPage().status();
+    assert(status.code() == StatusCode::kInternal);
+    assert(disk_manager->page_count() == pages);
+    for (int i = 0; i < 2; ++i) {
+      status = buffer_pool_manager->UnpinPage(ids[i], false);
+      assert(status.ok());
+    }
+    page_res = buffer_pool_manager->NewPage();
+    assert(page_res.ok());
+    assert(page_res.value()->id == (reuse ? ids[7] : pages));
+    status = buffer_pool_manager->UnpinPage(page_res.value()->id, false);
+    assert(status.ok());
+  }
+
+  // Over an mmap DiskManager, FetchPageView serves pages the pool does not
+  // hold straight from the mapping, and resident pages from their frames.
+  buffer_pool_manager.reset();
+  DiskManagerOptions mmap_options;
+  mmap_options.backend = IoBackend::kMmap;
+  status = disk_manager->Open(path, mmap_options);
+  assert(status.ok());
+  assert(disk_manager->backend() == IoBackend::kMmap);
+  buffer_pool_manager =
+      std::make_unique<BufferPoolManager>(8, disk_manager.get());
+  {
+    auto view_res = buffer_pool_manager->FetchPageView(0);
+    assert(view_res.ok());
+    PageViewGuard view = std::move(view_res).value();
+    assert(view.mapped());
+    const SlottedPageView slotted(view.data());
+    auto record = slotted.Get(slot_id0.value());
+    assert(record.ok());
+    assert(record.value().data.size() == payload0.size());
+
+    page_res = buffer_pool_manager->FetchPage(ids[1]);
+    assert(page_res.ok());
+    page_res.value()->data[kPageHeaderSize + 4] = std::byte{0x77};
+    status = buffer_pool_manager->UnpinPage(ids[1], true);
+    assert(status.ok());
+    view_res = buffer_pool_manager->FetchPageView(ids[1]);
+    assert(view_res.ok());
+    assert(!view_res.value().mapped());
+    assert(view_res.value().data()[kPageHeaderSize + 4] == std::byte{0x77});
+  }
+
+  // Frames are page-aligned slices of one arena, so the pool can run over
+  // an O_DIRECT file; pages round-trip through eviction and flushes.
+  buffer_pool_manager.reset();
+  DiskManagerOptions direct_options;
+  direct_options.direct_io = true;
+  status = disk_manager->Open(path, direct_options);
+  assert(status.ok());
+  buffer_pool_manager =
+      std::make_unique<BufferPoolManager>(4, disk_manager.get());
+  for (const PageId id : ids) {
+    page_res = buffer_pool_manager->FetchPage(id);
+    assert(page_res.ok());
+    Page* page = page_res.value();
+    assert(reinterpret_cast<std::uintptr_t>(page->data.data()) % kPageSize ==
+           0);
+    // ids[7] was deleted and reallocated zero-filled above.
+    assert(page->data[kPageHeaderSize] ==
+           (id == ids[7] ? std::byte{0} : static_cast<std::byte>(id & 0xff)));
+    page->data[kPageHeaderSize + 5] = std::byte{0x42};
+    status = buffer_pool_manager->UnpinPage(id, true);
+    assert(status.ok());
+  }
+  status = buffer_pool_manager->FlushAllPages();
+  assert(status.ok());
+  for (const PageId id : ids) {
+    status = disk_manager->ReadPage(id, on_disk.data());
+    assert(status.ok());
+    assert(on_disk[kPageHeaderSize + 5] == 0x42);
+  }
+
+  // A huge-page pool behaves like any other, whatever backing it obtained;
+  // its frames are 2 MB-aligned unless it fell back to base pages.
+  buffer_pool_manager.reset();
+  BufferPoolOptions huge;
+  huge.huge_pages = true;
+  buffer_pool_manager =
+      std::make_unique<BufferPoolManager>(16, disk_manager.get(), huge);
+  for (const PageId id : ids) {
+    page_res = buffer_pool_manager->FetchPage(id);
+    assert(page_res.ok());
+    assert(page_res.value()->data[kPageHeaderSize + 5] == std::byte{0x42});
+    if (id == ids[0] &&
+        buffer_pool_manager->memory_backing() != ArenaBacking::kBasePages) {
+      assert(reinterpret_cast<std::uintptr_t>(page_res.value()->data.data()) %
+                 FrameArena::kHugePageSize ==
+             0);
+    }
+    status = buffer_pool_manager->UnpinPage(id, false);
+    assert(status.ok());
+  }
+
+  // With double-write, write-back still lands every page in place.
+  buffer_pool_manager.reset();
+  DiskManagerOptions dw_options;
+  dw_options.double_write = true;
+  status = disk_manager->Open(path, dw_options);
+  assert(status.ok());
+  buffer_pool_manager =
+      std::make_unique<BufferPoolManager>(8, disk_manager.get());
+  for (const PageId id : ids) {
+    page_res = buffer_pool_manager->FetchPage(id);
+    assert(page_res.ok());
+    page_res.value()->data[kPageHeaderSize + 6] = std::byte{0x66};
+    status = buffer_pool_manager->UnpinPage(id, true);
+    assert(status.ok());
+  }
+  status = buffer_pool_manager->FlushAllPages();
+  assert(status.ok());
+  for (const PageId id : ids) {
+    status = disk_manager->ReadPage(id, on_disk.data());
+    assert(status.ok());
+    assert(on_disk[kPageHeaderSize + 6] == 0x66);
+  }
+  buffer_pool_manager.reset();
+  status = disk_manager->Open(path);
+  assert(status.ok());
+  assert(disk_manager->repaired_pages() == 0);
+
   std::cout << "buffer_pool_manager_test: success\n";
 
+  fs::remove(disk_manager->free_map_path());
   fs::remove(path);
   return 0;
 }
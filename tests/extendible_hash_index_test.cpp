@@ -0,0 +1,155 @@
+#include <cassert>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "index_test_util.h"
+#include "simpledb/buffer_pool_manager.h"
+#include "simpledb/disk_manager.h"
+#include "simpledb/extendible_hash_index.h"
+
+namespace {
+
+using namespace simpledb;
+using namespace simpledb::test;
+
+std::string Key(std::size_t n) {
+  char digits[16];
+  std::snprintf(digits, sizeof(digits), "%zu", n);
+  return "user:" + std::string(digits) + std::string(n % 23, '#');
+}
+
+void CheckAll(ExtendibleHashIndex& index, std::size_t begin, std::size_t end,
+              bool present) {
+  for (std::size_t n = begin; n < end; ++n) {
+    auto value = index.Get(Bytes(Key(n)));
+    if (present) {
+      assert(value.ok() && value.value() == Value(n));
+    } else {
+      assert(value.status().code() == StatusCode::kNotFound);
+    }
+  }
+}
+
+void TestInsertGetDelete(const std::filesystem::path& path) {
+  Status status;
+  constexpr std::size_t kKeys = 40000;
+  PageId header_page_id = kInvalidPageId;
+  std::uint32_t depth = 0;
+  {
+    Fixture fixture(path);
+    ExtendibleHashIndex index(&fixture.pool);
+    status = index.Get(Bytes("a")).status();
+    assert(status.code() == StatusCode::kInvalidArgument);
+    status = index.Create();
+    assert(status.ok());
+    header_page_id = index.header_page_id();
+    assert(index.global_depth() == 0);
+    status = index.Get(Bytes("a")).status();
+    assert(status.code() == StatusCode::kNotFound);
+
+    // Enough keys to split buckets past one directory page.
+    for (std::size_t n = 0; n < kKeys; ++n) {
+      status = index.Insert(Bytes(Key(n)), Value(n));
+      assert(status.ok());
+    }
+    depth = index.global_depth();
+    assert(depth > 8 && depth < ExtendibleHashIndex::kMaxGlobalDepth);
+    CheckAll(index, 0, kKeys, true);
+    CheckAll(index, kKeys, kKeys + 1000, false);
+
+    status = index.Insert(Bytes(Key(7)), Value(0));
+    assert(status.code() == StatusCode::kInvalidArgument);
+    const std::string big(ExtendibleHashIndex::kMaxKeySize, 'b');
+    status = index.Insert(Bytes(big + "b"), Value(0));
+    assert(status.code() == StatusCode::kInvalidArgument);
+    status = index.Insert(Bytes(big), Value(1));
+    assert(status.ok());
+    status = index.Insert(Bytes(""), Value(2));
+    assert(status.ok());
+    assert(index.Get(Bytes(big)).value() == Value(1));
+    assert(index.Get(Bytes("")).value() == Value(2));
+
+    // Deleted keys are gone, the rest stay, and the space is reused.
+    for (std::size_t n = 0; n < kKeys; n += 2) {
+      status = index.Delete(Bytes(Key(n)));
+      assert(status.ok());
+    }
+    status = index.Delete(Bytes(Key(0)));
+    assert(status.code() == StatusCode::kNotFound);
+    for (std::size_t n = 0; n < kKeys; ++n) {
+      auto value = index.Get(Bytes(Key(n)));
+      assert(n % 2 == 0 ? value.status().code() == StatusCode::kNotFound
+                        : value.ok() && value.value() == Value(n));
+    }
+    for (std::size_t n = 0; n < kKeys; n += 2) {
+      status = index.Insert(Bytes(Key(n)), Value(n));
+      assert(status.ok());
+    }
+    assert(index.global_depth() == depth);
+    status = fixture.pool.FlushAllPages();
+    assert(status.ok());
+  }
+
+  // Found again from the header page alone.
+  DiskManager disk_manager;
+  status = disk_manager.Open(path);
+  assert(status.ok());
+  BufferPoolManager pool(8, &disk_manager);
+  ExtendibleHashIndex index(&pool);
+  status = index.Open(header_page_id + 1);
+  assert(status.code() == StatusCode::kInvalidArgument);
+  status = index.Open(header_page_id);
+  assert(status.ok());
+  assert(index.global_depth() == depth);
+  CheckAll(index, 0, kKeys, true);
+}
+
+// Inserts that split buckets race with lookups of keys already in.
+void TestConcurrent(const std::filesystem::path& path) {
+  Status status;
+  Fixture fixture(path, 64);
+  ExtendibleHashIndex index(&fixture.pool);
+  status = index.Create();
+  assert(status.ok());
+  constexpr std::size_t kThreads = 4;
+  constexpr std::size_t kPerThread = 5000;
+  constexpr std::size_t kPreloaded = 2000;
+  for (std::size_t n = 0; n < kPreloaded; ++n) {
+    status = index.Insert(Bytes(Key(n)), Value(n));
+    assert(status.ok());
+  }
+
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&index, t] {
+      for (std::size_t i = 0; i < kPerThread; ++i) {
+        const std::size_t n = kPreloaded + i * kThreads + t;
+        const Status inserted = index.Insert(Bytes(Key(n)), Value(n));
+        assert(inserted.ok());
+        const std::size_t old = (i * 37) % kPreloaded;
+        auto value = index.Get(Bytes(Key(old)));
+        assert(value.ok() && value.value() == Value(old));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  CheckAll(index, 0, kPreloaded + kThreads * kPerThread, true);
+}
+
+}  // namespace
+
+int main() {
+  const auto path = std::filesystem::temp_directory_path() /
+                    "simpledb_extendible_hash_index_test.db";
+  TestInsertGetDelete(path);
+  TestConcurrent(path);
+  std::filesystem::remove(path);
+  std::cout << "extendible_hash_index_test: success\n";
+  return 0;
+}
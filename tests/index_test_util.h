@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+
+#include "simpledb/buffer_pool_manager.h"
+#include "simpledb/disk_manager.h"
+#include "simpledb/table_heap.h"
+
+// Helpers shared by the index tests.
+namespace simpledb::test {
+
+inline std::span<const std::byte> Bytes(const std::string& s) {
+  return {reinterpret_cast<const std::byte*>(s.data()), s.size()};
+}
+
+inline std::string Text(std::span<const std::byte> bytes) {
+  return {reinterpret_cast<const char*>(bytes.data()), bytes.size()};
+}
+
+// The value stored for key number n.
+inline RecordId Value(std::size_t n) {
+  return {n / 7, static_cast<std::uint16_t>(n % 7)};
+}
+
+// A pool over a fresh file.
+struct Fixture {
+  explicit Fixture(const std::filesystem::path& path, std::size_t frames = 16)
+      : pool(frames, &disk_manager) {
+    std::filesystem::remove(path);
+    const Status status = disk_manager.Open(path);
+    assert(status.ok());
+  }
+
+  DiskManager disk_manager;
+  BufferPoolManager pool;
+};
+
+}  // namespace simpledb::test
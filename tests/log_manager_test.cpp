@@ -0,0 +1,305 @@
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "simpledb/buffer_pool_manager.h"
+#include "simpledb/disk_manager.h"
+#include "simpledb/log_manager.h"
+#include "simpledb/page.h"
+
+namespace {
+
+using namespace simpledb;
+
+std::vector<std::byte> Bytes(std::size_t size, std::byte value) {
+  return std::vector<std::byte>(size, value);
+}
+
+void TestAppendAndRead(const std::filesystem::path& path) {
+  Status status;
+  LogManager log;
+  status = log.Open(path);
+  assert(status.ok());
+  assert(log.end_lsn() == kInvalidLsn);
+
+  PageImage image;
+  Page page{3, image.bytes};
+  auto lsn_res = log.Update(7, page, 100, Bytes(16, std::byte{0xab}));
+  assert(lsn_res.ok());
+  const Lsn first = lsn_res.value();
+  assert(first > kInvalidLsn);
+  assert(PageLsn(page.data) == first);
+  assert(page.data[100] == std::byte{0xab} && page.data[115] == std::byte{0xab});
+
+  // The header belongs to the log; updates must stay in the page body.
+  status = log.Update(7, page, 0, Bytes(4, std::byte{1})).status();
+  assert(status.code() == StatusCode::kInvalidArgument);
+  status = log.Update(7, page, kPageSize - 2, Bytes(4, std::byte{1})).status();
+  assert(status.code() == StatusCode::kInvalidArgument);
+
+  // Appended but not durable until a commit or flush covers it.
+  assert(log.flushed_lsn() < first);
+  auto commit_res = log.Commit(7);
+  assert(commit_res.ok());
+  assert(commit_res.value() > first);
+  assert(log.flushed_lsn() >= commit_res.value());
+
+  std::vector<LogRecord> records;
+  status = log.ReadLog(kInvalidLsn, [&records](const LogRecord& record) {
+    records.push_back(record);
+    return true;
+  });
+  assert(status.ok());
+  assert(records.size() == 2);
+  assert(records[0].type == LogRecordType::kUpdate);
+  assert(records[0].lsn == first);
+  assert(records[0].page_id == 3 && records[0].offset == 100);
+  assert(records[0].txn_id == 7 && records[0].data.size() == 16);
+  assert(records[1].type == LogRecordType::kCommit);
+  assert(records[1].lsn == commit_res.value());
+
+  // Reading from an LSN skips the records up to it.
+  size_t after_first = 0;
+  status = log.ReadLog(first, [&after_first](const LogRecord& record) {
+    assert(record.type == LogRecordType::kCommit);
+    ++after_first;
+    return true;
+  });
+  assert(status.ok());
+  assert(after_first == 1);
+}
+
+// A crash can leave half a record at the end of the log; reopening cuts it
+// off and appends after the last intact record.
+void TestTornTail(const std::filesystem::path& path) {
+  Status status;
+  Lsn end = kInvalidLsn;
+  {
+    LogManager log;
+    status = log.Open(path);
+    assert(status.ok());
+    end = log.end_lsn();
+    assert(end > kInvalidLsn);
+  }
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::app);
+    const char garbage[20] = {40, 0, 0, 0, 1, 2, 3};
+    out.write(garbage, sizeof(garbage));
+  }
+  assert(std::filesystem::file_size(path) == end + 20);
+
+  LogManager log;
+  status = log.Open(path);
+  assert(status.ok());
+  assert(log.end_lsn() == end);
+  assert(std::filesystem::file_size(path) == end);
+  auto lsn_res = log.Commit(8);
+  assert(lsn_res.ok());
+  size_t count = 0;
+  status = log.ReadLog(kInvalidLsn, [&count](const LogRecord&) {
+    ++count;
+    return true;
+  });
+  assert(status.ok());
+  assert(count == 3);
+}
+
+// Concurrent committers share fdatasyncs.
+void TestGroupCommit(const std::filesystem::path& path) {
+  Status status;
+  std::filesystem::remove(path);
+  LogManagerOptions options;
+  options.group_commit_delay = std::chrono::milliseconds(2);
+  options.group_commit_batch = 8;
+  LogManager log;
+  status = log.Open(path, options);
+  assert(status.ok());
+
+  constexpr size_t kThreads = 8;
+  constexpr size_t kCommitsPerThread = 25;
+  std::vector<std::thread> committers;
+  for (size_t t = 0; t < kThreads; ++t) {
+    committers.emplace_back([&log, t] {
+      for (size_t i = 0; i < kCommitsPerThread; ++i) {
+        LogRecord record;
+        record.txn_id = t;
+        record.page_id = t;
+        record.offset = kPageHeaderSize;
+        record.data = Bytes(64, std::byte{1});
+        const auto append_res = log.Append(record);
+        assert(append_res.ok());
+        auto lsn_res = log.Commit(t);
+        assert(lsn_res.ok());
+        assert(log.flushed_lsn() >= lsn_res.value());
+      }
+    });
+  }
+  for (auto& committer : committers) {
+    committer.join();
+  }
+  std::cout << "group commit: " << kThreads * kCommitsPerThread
+            << " commits, " << log.sync_count() << " syncs\n";
+  assert(log.sync_count() < kThreads * kCommitsPerThread);
+
+  size_t commits = 0;
+  status = log.ReadLog(kInvalidLsn, [&commits](const LogRecord& record) {
+    commits += record.type == LogRecordType::kCommit ? 1 : 0;
+    return true;
+  });
+  assert(status.ok());
+  assert(commits == kThreads * kCommitsPerThread);
+}
+
+// Appends beyond the buffer wait for it to drain rather than fail.
+void TestSmallBuffer(const std::filesystem::path& path) {
+  Status status;
+  std::filesystem::remove(path);
+  LogManagerOptions options;
+  options.buffer_bytes = 1;
+  LogManager log;
+  status = log.Open(path, options);
+  assert(status.ok());
+  Lsn last = kInvalidLsn;
+  for (int i = 0; i < 50; ++i) {
+    LogRecord record;
+    record.offset = kPageHeaderSize;
+    record.data = Bytes(kPageSize / 2, std::byte{2});
+    auto lsn_res = log.Append(record);
+    assert(lsn_res.ok());
+    assert(lsn_res.value() > last);
+    last = lsn_res.value();
+  }
+  status = log.Flush(last);
+  assert(status.ok());
+  assert(log.flushed_lsn() == last);
+}
+
+// The buffer pool never writes a page ahead of its log records, even when
+// the page leaves the pool by eviction. A long group commit delay shows
+// that such flushes do not wait for it.
+void TestWriteAheadOnEviction(const std::filesystem::path& db_path,
+                              const std::filesystem::path& log_path) {
+  std::filesystem::remove(db_path);
+  std::filesystem::remove(log_path);
+  Status status;
+  DiskManager disk_manager;
+  status = disk_manager.Open(db_path);
+  assert(status.ok());
+  LogManagerOptions log_options;
+  log_options.group_commit_delay = std::chrono::seconds(10);
+  LogManager log;
+  status = log.Open(log_path, log_options);
+  assert(status.ok());
+
+  BufferPoolOptions options;
+  options.log_manager = &log;
+  options.page_cleaner = false;
+  BufferPoolManager pool(2, &disk_manager, options);
+
+  std::vector<PageId> ids;
+  std::vector<Lsn> lsns;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 6; ++i) {
+    auto guard_res = pool.NewPageWrite();
+    assert(guard_res.ok());
+    WritePageGuard guard = std::move(guard_res).value();
+    auto lsn_res =
+        log.Update(1, guard.page(), kPageHeaderSize, Bytes(8, std::byte{0x5c}));
+    assert(lsn_res.ok());
+    ids.push_back(guard.page_id());
+    lsns.push_back(lsn_res.value());
+  }
+  // Four pages were evicted to make room; their records are durable and
+  // the pages on disk carry their LSNs.
+  assert(log.flushed_lsn() >= lsns[3]);
+  PageImage on_disk;
+  for (int i = 0; i < 4; ++i) {
+    status = disk_manager.ReadPage(
+        ids[i], reinterpret_cast<char*>(on_disk.bytes.data()));
+    assert(status.ok());
+    assert(PageLsn(on_disk.bytes) == lsns[i]);
+    assert(on_disk.bytes[kPageHeaderSize] == std::byte{0x5c});
+  }
+
+  status = pool.FlushAllPages();
+  assert(status.ok());
+  assert(log.flushed_lsn() >= lsns.back());
+  assert(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+}
+
+// A deleted page's unwritten changes leave the dirty page table with it,
+// so the next checkpoint no longer sends recovery back to them.
+void TestDeleteReleasesRedoPoint(const std::filesystem::path& db_path,
+                                 const std::filesystem::path& log_path) {
+  std::filesystem::remove(db_path);
+  std::filesystem::remove(log_path);
+  std::filesystem::remove(std::filesystem::path(log_path) += ".master");
+  Status status;
+  DiskManager disk_manager;
+  status = disk_manager.Open(db_path);
+  assert(status.ok());
+  LogManager log;
+  status = log.Open(log_path);
+  assert(status.ok());
+
+  BufferPoolOptions options;
+  options.log_manager = &log;
+  options.page_cleaner = false;
+  BufferPoolManager pool(4, &disk_manager, options);
+
+  PageId page_id = kInvalidPageId;
+  {
+    auto guard_res = pool.NewPageWrite();
+    assert(guard_res.ok());
+    WritePageGuard guard = std::move(guard_res).value();
+    page_id = guard.page_id();
+    const auto lsn_res =
+        log.Update(1, guard.page(), kPageHeaderSize, Bytes(8, std::byte{1}));
+    assert(lsn_res.ok());
+  }
+  auto checkpoint_res = log.Checkpoint(disk_manager);
+  assert(checkpoint_res.ok());
+  auto checkpoint = log.LastCheckpoint();
+  assert(checkpoint.ok());
+  assert(checkpoint.value().dirty_pages.size() == 1);
+  assert(checkpoint.value().dirty_pages[0].page_id == page_id);
+
+  status = pool.DeletePage(page_id);
+  assert(status.ok());
+  checkpoint_res = log.Checkpoint(disk_manager);
+  assert(checkpoint_res.ok());
+  checkpoint = log.LastCheckpoint();
+  assert(checkpoint.ok());
+  assert(checkpoint.value().begin_lsn == checkpoint_res.value());
+  assert(checkpoint.value().dirty_pages.empty());
+}
+
+}  // namespace
+
+int main() {
+  namespace fs = std::filesystem;
+  const fs::path path = fs::temp_directory_path() / "simpledb_log_manager_test.log";
+  const fs::path db_path =
+      fs::temp_directory_path() / "simpledb_log_manager_test.db";
+  fs::remove(path);
+
+  TestAppendAndRead(path);
+  TestTornTail(path);
+  TestGroupCommit(path);
+  TestSmallBuffer(path);
+  TestWriteAheadOnEviction(db_path, path);
+  TestDeleteReleasesRedoPoint(db_path, path);
+
+  std::cout << "log_manager_test: success\n";
+
+  fs::remove(path);
+  fs::remove(fs::path(path) += ".master");
+  fs::remove(db_path);
+  return 0;
+}
@@ -0,0 +1,104 @@
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "simpledb/page_table.h"
+
+namespace {
+
+using namespace simpledb;
+
+void TestBasic() {
+  PageTable table(4);
+  assert(!table.Find(7).has_value());
+
+  bool inserted = table.Insert(7, 0);
+  assert(inserted);
+  inserted = table.Insert(9, 1);
+  assert(inserted);
+  assert(table.Find(7) == frame_id_t{0});
+  assert(table.Find(9) == frame_id_t{1});
+  assert(table.size() == 2);
+
+  bool erased = table.Erase(7);
+  assert(erased);
+  erased = table.Erase(7);
+  assert(!erased);
+  assert(!table.Find(7).has_value());
+  assert(table.Find(9) == frame_id_t{1});
+
+  // Churn far past the capacity; tombstones must not fill the table.
+  for (PageId id = 100; id < 10000; ++id) {
+    inserted = table.Insert(id, 2);
+    assert(inserted);
+    assert(table.Find(id) == frame_id_t{2});
+    erased = table.Erase(id);
+    assert(erased);
+  }
+  assert(table.size() == 1);
+  assert(table.Find(9) == frame_id_t{1});
+
+  size_t seen = 0;
+  table.ForEach([&seen](PageId id, frame_id_t frame_id) {
+    assert(id == 9 && frame_id == 1);
+    ++seen;
+  });
+  assert(seen == 1);
+
+  // Past its capacity the table refuses an insert rather than probing
+  // forever.
+  PageTable full(4);
+  PageId id = 0;
+  while (full.Insert(id, 0)) {
+    ++id;
+  }
+  assert(full.size() == 8 && !full.Find(id).has_value());
+}
+
+// Readers never see a page mapped to another page's frame while a single
+// writer remaps entries underneath them.
+void TestConcurrentFind() {
+  constexpr PageId kPages = 16;
+  PageTable table(kPages);
+  for (PageId id = 0; id < kPages; ++id) {
+    const bool inserted = table.Insert(id, id);
+    assert(inserted);
+  }
+
+  std::atomic<bool> done{false};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 3; ++t) {
+    readers.emplace_back([&table, &done] {
+      while (!done.load()) {
+        for (PageId id = 0; id < kPages; ++id) {
+          const auto frame_id = table.Find(id);
+          assert(!frame_id || *frame_id == id);
+        }
+      }
+    });
+  }
+
+  for (int round = 0; round < 20000; ++round) {
+    const PageId id = round % kPages;
+    const bool erased = table.Erase(id);
+    assert(erased);
+    const bool inserted = table.Insert(id, id);
+    assert(inserted);
+  }
+  done.store(true);
+  for (auto& reader : readers) {
+    reader.join();
+  }
+}
+
+}  // namespace
+
+int main() {
+  TestBasic();
+  TestConcurrentFind();
+
+  std::cout << "page_table_test: success\n";
+  return 0;
+}
@@ -18,10 +18,11 @@ int main() {
   assert(status.ok());
   assert(pager.page_count() == 0);
 
-  auto page_result = pager.Allocate();
-  assert(page_result.ok());
+  auto id_result = pager.Allocate();
+  assert(id_result.ok());
 
-  Page page = std::move(page_result.value());
+  PageImage image;
+  Page page{id_result.value(), image.bytes};
   SlottedPage slotted(page);
 
   const std::string payload = "pager roundtrip payload";
@@ -36,10 +37,12 @@ int main() {
   assert(status.ok());
   assert(pager.page_count() == 1);
 
-  auto loaded = pager.Load(page.id);
-  assert(loaded.ok());
+  PageImage loaded_image;
+  Page loaded{page.id, loaded_image.bytes};
+  status = pager.Load(loaded);
+  assert(status.ok());
 
-  SlottedPage reloaded(loaded.value());
+  SlottedPage reloaded(loaded);
   auto record_view = reloaded.Get(slot_id.value());
   assert(record_view.ok());
 
@@ -0,0 +1,210 @@
+#include <cassert>
+#include <cstddef>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "simpledb/page.h"
+#include "simpledb/record.h"
+
+namespace {
+
+using namespace simpledb;
+
+std::vector<std::byte> Record(std::size_t size, char fill) {
+  return std::vector<std::byte>(size, static_cast<std::byte>(fill));
+}
+
+bool Holds(const SlottedPageView& page, std::uint16_t slot_id,
+           const std::vector<std::byte>& expected) {
+  auto view = page.Get(slot_id);
+  return view.ok() && std::equal(view.value().data.begin(),
+                                 view.value().data.end(), expected.begin(),
+                                 expected.end());
+}
+
+// Deleted slots become tombstones that inserts reuse; the ids of the other
+// records never change.
+void TestDeleteAndReuse() {
+  Status status;
+  PageImage image;
+  Page page{0, image.bytes};
+  SlottedPage slotted(page);
+  assert(PageTypeOf(page.data) == PageType::kSlotted);
+
+  std::vector<std::vector<std::byte>> records;
+  for (int i = 0; i < 4; ++i) {
+    records.push_back(Record(100, static_cast<char>('a' + i)));
+    const auto slot_res = slotted.Insert(records.back());
+    assert(slot_res.ok() && slot_res.value() == i);
+  }
+  status = slotted.Delete(1);
+  assert(status.ok());
+  assert(!slotted.IsLive(1));
+  status = slotted.Get(1).status();
+  assert(status.code() == StatusCode::kNotFound);
+  status = slotted.Delete(1);
+  assert(status.code() == StatusCode::kNotFound);
+  status = slotted.Delete(9);
+  assert(status.code() == StatusCode::kNotFound);
+  assert(slotted.fragmented_space() == 100);
+  assert(slotted.slot_count() == 4);
+
+  const auto reused = Record(30, 'z');
+  const auto reused_slot = slotted.Insert(reused);
+  assert(reused_slot.ok() && reused_slot.value() == 1);
+  assert(Holds(slotted, 1, reused));
+  assert(Holds(slotted, 0, records[0]) && Holds(slotted, 2, records[2]) &&
+         Holds(slotted, 3, records[3]));
+
+  // Deleting the last records shrinks the directory and the record area.
+  const std::size_t before = slotted.free_space();
+  status = slotted.Delete(3);
+  assert(status.ok());
+  status = slotted.Delete(2);
+  assert(status.ok());
+  assert(slotted.slot_count() == 2);
+  assert(slotted.free_space() >= before + 200);
+}
+
+// Updates keep the slot id whether the record shrinks, grows in place or
+// moves, and fail without damage when the page cannot hold the new size.
+void TestUpdate() {
+  Status status;
+  PageImage image;
+  Page page{0, image.bytes};
+  SlottedPage slotted(page);
+  const auto first = Record(200, 'f');
+  const auto second = Record(200, 's');
+  auto slot_res = slotted.Insert(first);
+  assert(slot_res.ok() && slot_res.value() == 0);
+  slot_res = slotted.Insert(second);
+  assert(slot_res.ok() && slot_res.value() == 1);
+
+  const auto shorter = Record(50, 'F');
+  status = slotted.Update(0, shorter);
+  assert(status.ok());
+  assert(Holds(slotted, 0, shorter));
+  assert(slotted.fragmented_space() == 150);
+
+  // The last record grows into the free space after it.
+  const auto longer = Record(400, 'S');
+  status = slotted.Update(1, longer);
+  assert(status.ok());
+  assert(Holds(slotted, 1, longer));
+  assert(slotted.fragmented_space() == 150);
+
+  // The first record cannot grow in place, so it moves.
+  const auto moved = Record(300, 'M');
+  status = slotted.Update(0, moved);
+  assert(status.ok());
+  assert(Holds(slotted, 0, moved) && Holds(slotted, 1, longer));
+  assert(slotted.fragmented_space() == 200);
+
+  status = slotted.Update(2, moved);
+  assert(status.code() == StatusCode::kNotFound);
+  const auto huge = Record(kPageSize, 'H');
+  status = slotted.Update(0, huge);
+  assert(status.code() == StatusCode::kInvalidArgument);
+  assert(Holds(slotted, 0, moved) && Holds(slotted, 1, longer));
+
+  // Growing to fill the page needs the fragmented space and the record's
+  // own old bytes; the page is compacted on the way.
+  const auto filling = Record(slotted.free_space() + 300, 'X');
+  status = slotted.Update(0, filling);
+  assert(status.ok());
+  assert(Holds(slotted, 0, filling) && Holds(slotted, 1, longer));
+  assert(slotted.fragmented_space() == 0);
+  assert(slotted.free_space() == 0);
+}
+
+// Random inserts, updates and deletes against a model: the page never
+// loses a record or its id, and compaction keeps the fragmented space
+// available to inserts.
+void TestRandomOperations() {
+  Status status;
+  PageImage image;
+  Page page{0, image.bytes};
+  SlottedPage slotted(page);
+  std::map<std::uint16_t, std::vector<std::byte>> model;
+  std::mt19937 rng(7);
+  std::size_t compactions = 0;
+  for (int i = 0; i < 20000; ++i) {
+    const auto record =
+        Record(rng() % 300, static_cast<char>('A' + rng() % 26));
+    const int op = static_cast<int>(rng() % 3);
+    const std::size_t fragmented = slotted.fragmented_space();
+    if (op == 0 || model.empty()) {
+      const bool fits = record.size() <= slotted.free_space();
+      auto slot_id = slotted.Insert(record);
+      assert(slot_id.ok() == fits);
+      if (fits) {
+        assert(model.count(slot_id.value()) == 0);
+        model[slot_id.value()] = record;
+      }
+    } else {
+      auto it = model.begin();
+      std::advance(it, rng() % model.size());
+      if (op == 1) {
+        if (slotted.Update(it->first, record).ok()) {
+          it->second = record;
+        }
+      } else {
+        status = slotted.Delete(it->first);
+        assert(status.ok());
+        model.erase(it);
+      }
+    }
+    if (slotted.fragmented_space() < fragmented) {
+      ++compactions;
+    }
+    assert(slotted.fragmented_space() <= SlottedPage::kCompactionThreshold);
+  }
+  assert(compactions > 0);
+  for (const auto& [slot_id, record] : model) {
+    assert(Holds(slotted, slot_id, record));
+  }
+  std::cout << "random operations: " << model.size() << " records, "
+            << compactions << " compactions\n";
+}
+
+}  // namespace
+
+// The overflow flag rides along with a record through updates and
+// compaction, and never counts toward its size.
+void TestOverflowFlag() {
+  Status status;
+  PageImage image;
+  Page page{0, image.bytes};
+  SlottedPage slotted(page);
+  const auto stub = Record(40, 's');
+  const auto plain = Record(60, 'p');
+  const auto slot = slotted.Insert(stub, true).value();
+  const auto other = slotted.Insert(plain).value();
+  assert(slotted.Get(slot).value().overflow);
+  assert(Holds(slotted, slot, stub));
+  assert(!slotted.Get(other).value().overflow);
+
+  status = slotted.Delete(other);
+  assert(status.ok());
+  slotted.Compact();
+  assert(slotted.Get(slot).value().overflow && Holds(slotted, slot, stub));
+  status = slotted.Update(slot, plain);
+  assert(status.ok());
+  assert(!slotted.Get(slot).value().overflow && Holds(slotted, slot, plain));
+  status = slotted.Update(slot, Record(500, 'b'), true);
+  assert(status.ok());
+  assert(slotted.Get(slot).value().overflow);
+  assert(slotted.Get(slot).value().data.size() == 500);
+}
+
+int main() {
+  TestDeleteAndReuse();
+  TestUpdate();
+  TestRandomOperations();
+  TestOverflowFlag();
+  std::cout << "record_test: success\n";
+  return 0;
+}
@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "simpledb/buffer_pool_manager.h"
+#include "simpledb/disk_manager.h"
+#include "simpledb/log_manager.h"
+#include "simpledb/page.h"
+#include "simpledb/recovery.h"
+
+namespace {
+
+using namespace simpledb;
+namespace fs = std::filesystem;
+
+// Expected page bodies, kept in step with every logged update.
+using Model = std::map<PageId, std::vector<std::byte>>;
+
+void LoggedWrite(BufferPoolManager& pool, LogManager& log, Model& model,
+                 std::uint64_t txn_id, PageId page_id, std::size_t slot,
+                 std::byte value) {
+  auto guard_res = pool.FetchPageWrite(page_id);
+  assert(guard_res.ok());
+  WritePageGuard guard = std::move(guard_res).value();
+  const std::vector<std::byte> bytes(8, value);
+  const std::size_t offset = kPageHeaderSize + slot * bytes.size();
+  const auto lsn_res = log.Update(txn_id, guard.page(), offset, bytes);
+  assert(lsn_res.ok());
+  auto& expected = model[page_id];
+  expected.resize(kPageSize);
+  std::copy(bytes.begin(), bytes.end(), expected.begin() + offset);
+}
+
+PageId NewLoggedPage(BufferPoolManager& pool) {
+  auto guard_res = pool.NewPageWrite();
+  assert(guard_res.ok());
+  return guard_res.value().page_id();
+}
+
+void CheckPages(DiskManager& disk_manager, const Model& model) {
+  PageImage image;
+  for (const auto& [page_id, expected] : model) {
+    const Status status = disk_manager.ReadPage(
+        page_id, reinterpret_cast<char*>(image.bytes.data()));
+    assert(status.ok());
+    assert(std::equal(expected.begin() + kPageHeaderSize, expected.end(),
+                      image.bytes.begin() + kPageHeaderSize));
+  }
+}
+
+}  // namespace
+
+int main() {
+  const fs::path dir = fs::temp_directory_path();
+  const fs::path db_path = dir / "simpledb_recovery_test.db";
+  const fs::path log_path = dir / "simpledb_recovery_test.log";
+  const fs::path crash_db = dir / "simpledb_recovery_test_crash.db";
+  const fs::path crash_log = dir / "simpledb_recovery_test_crash.log";
+  for (const auto& path : {db_path, log_path, crash_db, crash_log}) {
+    fs::remove(path);
+    fs::remove(fs::path(path) += ".master");
+  }
+
+  Status status;
+  Model model;
+  Lsn checkpoint_lsn = kInvalidLsn;
+  std::size_t records_written = 0;
+  {
+    DiskManager disk_manager;
+    status = disk_manager.Open(db_path);
+    assert(status.ok());
+    LogManager log;
+    status = log.Open(log_path);
+    assert(status.ok());
+    BufferPoolOptions options;
+    options.log_manager = &log;
+    options.page_cleaner = false;
+    BufferPoolManager pool(16, &disk_manager, options);
+
+    status = log.LastCheckpoint().status();
+    assert(status.code() == StatusCode::kNotFound);
+
+    // Lots of history, all of it written back before the checkpoint.
+    for (int i = 0; i < 50; ++i) {
+      const PageId page_id = NewLoggedPage(pool);
+      for (std::size_t slot = 0; slot < 16; ++slot) {
+        LoggedWrite(pool, log, model, 1, page_id, slot,
+                    static_cast<std::byte>(i + slot));
+      }
+    }
+    status = log.Commit(1).status();
+    assert(status.ok());
+    status = pool.FlushAllPages();
+    assert(status.ok());
+
+    // Another thread keeps updating pages 0-9 while the checkpoint runs;
+    // pages 0-4 are dirty in the pool when it starts.
+    for (PageId page_id = 0; page_id < 5; ++page_id) {
+      LoggedWrite(pool, log, model, 2, page_id, 5, std::byte{0x20});
+    }
+    Model concurrent;
+    std::thread updater([&] {
+      for (int round = 0; round < 20; ++round) {
+        for (PageId page_id = 0; page_id < 10; ++page_id) {
+          LoggedWrite(pool, log, concurrent, 2, page_id, 6,
+                      static_cast<std::byte>(round));
+        }
+      }
+    });
+    auto checkpoint_res = log.Checkpoint(disk_manager);
+    assert(checkpoint_res.ok());
+    checkpoint_lsn = checkpoint_res.value();
+    updater.join();
+    for (PageId page_id = 0; page_id < 10; ++page_id) {
+      std::copy(concurrent[page_id].begin() + kPageHeaderSize + 48,
+                concurrent[page_id].begin() + kPageHeaderSize + 56,
+                model[page_id].begin() + kPageHeaderSize + 48);
+    }
+    status = log.Commit(2).status();
+    assert(status.ok());
+
+    auto checkpoint = log.LastCheckpoint();
+    assert(checkpoint.ok());
+    assert(checkpoint.value().begin_lsn == checkpoint_lsn);
+    assert(!checkpoint.value().dirty_pages.empty());
+    assert(std::find(checkpoint.value().active_txns.begin(),
+                     checkpoint.value().active_txns.end(),
+                     2) != checkpoint.value().active_txns.end());
+
+    // After the checkpoint: updates to old pages and to new ones, and a
+    // transaction that never commits.
+    for (int i = 0; i < 10; ++i) {
+      NewLoggedPage(pool);
+    }
+    for (PageId page_id = 40; page_id < 60; ++page_id) {
+      LoggedWrite(pool, log, model, 3, page_id, 7, std::byte{0x33});
+    }
+    status = log.Commit(3).status();
+    assert(status.ok());
+    LoggedWrite(pool, log, model, 4, 7, 8, std::byte{0x44});
+    status = log.Flush(log.end_lsn());
+    assert(status.ok());
+
+    status = log.ReadLog(kInvalidLsn, [&records_written](const LogRecord&) {
+      ++records_written;
+      return true;
+    });
+    assert(status.ok());
+
+    // Crash: what is on disk now is all a restart gets.
+    fs::copy_file(db_path, crash_db);
+    fs::copy_file(log_path, crash_log);
+    fs::copy_file(log.master_path(), fs::path(crash_log) += ".master");
+  }
+
+  {
+    DiskManager disk_manager;
+    status = disk_manager.Open(crash_db);
+    assert(status.ok());
+    LogManager log;
+    status = log.Open(crash_log);
+    assert(status.ok());
+    BufferPoolOptions options;
+    options.log_manager = &log;
+    BufferPoolManager pool(8, &disk_manager, options);
+
+    RecoveryOptions recovery_options;
+    recovery_options.threads = 4;
+    recovery_options.prefetch_batch = 4;
+    auto stats_res = Recover(log, disk_manager, pool, recovery_options);
+    assert(stats_res.ok());
+    const RecoveryStats& stats = stats_res.value();
+    std::cout << "recovery: scanned " << stats.records_scanned << " of "
+              << records_written << " records, applied "
+              << stats.records_applied << " to " << stats.pages << " pages\n";
+    // The history before the checkpoint's oldest dirty page is skipped.
+    assert(stats.redo_lsn > kInvalidLsn && stats.redo_lsn <= checkpoint_lsn);
+    assert(stats.records_scanned < records_written / 2);
+    assert(stats.records_applied > 0);
+    assert(stats.uncommitted_txns == std::vector<std::uint64_t>{4});
+    assert(disk_manager.page_count() >= 60);
+    CheckPages(disk_manager, model);
+
+    // Redo is idempotent: a second pass finds every page up to date.
+    auto again = Recover(log, disk_manager, pool, recovery_options);
+    assert(again.ok());
+    assert(again.value().records_applied == 0);
+
+    // A checkpoint of the recovered database leaves nothing to redo.
+    status = log.Checkpoint(disk_manager).status();
+    assert(status.ok());
+    again = Recover(log, disk_manager, pool, recovery_options);
+    assert(again.ok());
+    assert(again.value().pages == 0);
+    CheckPages(disk_manager, model);
+  }
+
+  std::cout << "recovery_test: success\n";
+
+  for (const auto& path : {db_path, log_path, crash_db, crash_log}) {
+    fs::remove(path);
+    fs::remove(fs::path(path) += ".master");
+  }
+  return 0;
+}
@@ -0,0 +1,203 @@
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "simpledb/replacer.h"
+
+namespace {
+
+using namespace simpledb;
+
+void TestClock() {
+  std::optional<frame_id_t> victim;
+  ClockReplacer replacer(4);
+  for (frame_id_t f = 0; f < 4; ++f) {
+    replacer.RecordAccess(f);
+    replacer.SetEvictable(f, true);
+  }
+  assert(replacer.size() == 4);
+
+  // Everything was referenced once, so the first sweep clears all bits and
+  // the hand comes back around to frame 0.
+  victim = replacer.Evict();
+  assert(victim == frame_id_t{0});
+
+  // A pinned frame is skipped; a re-referenced frame gets a second chance.
+  replacer.SetEvictable(1, false);
+  replacer.RecordAccess(2);
+  victim = replacer.Evict();
+  assert(victim == frame_id_t{3});
+  victim = replacer.Evict();
+  assert(victim == frame_id_t{2});
+  assert(replacer.size() == 0);
+  victim = replacer.Evict();
+  assert(!victim.has_value());
+
+  replacer.SetEvictable(1, true);
+  replacer.Remove(1);
+  victim = replacer.Evict();
+  assert(!victim.has_value());
+}
+
+void TestLruK() {
+  std::optional<frame_id_t> victim;
+  LruKReplacer replacer(6, 2);
+
+  // Frames 0 and 1 are hot (two accesses); 2..5 are touched once, as a scan
+  // would.
+  for (frame_id_t f = 0; f < 6; ++f) {
+    replacer.RecordAccess(f);
+  }
+  replacer.RecordAccess(0);
+  replacer.RecordAccess(1);
+  for (frame_id_t f = 0; f < 6; ++f) {
+    replacer.SetEvictable(f, true);
+  }
+
+  // Scan pages go first, oldest first, before any hot page.
+  victim = replacer.Evict();
+  assert(victim == frame_id_t{2});
+  victim = replacer.Evict();
+  assert(victim == frame_id_t{3});
+
+  // A second access promotes a history frame over the cache frames.
+  replacer.RecordAccess(4);
+  victim = replacer.Evict();
+  assert(victim == frame_id_t{5});
+  victim = replacer.Evict();
+  assert(victim == frame_id_t{0});
+  victim = replacer.Evict();
+  assert(victim == frame_id_t{1});
+  victim = replacer.Evict();
+  assert(victim == frame_id_t{4});
+  victim = replacer.Evict();
+  assert(!victim.has_value());
+
+  // Eviction forgets history: the frame starts over on the history list.
+  replacer.RecordAccess(0);
+  replacer.RecordAccess(2);
+  replacer.RecordAccess(2);
+  replacer.SetEvictable(2, true);
+  replacer.SetEvictable(0, true);
+  victim = replacer.Evict();
+  assert(victim == frame_id_t{0});
+
+  replacer.SetEvictable(2, false);
+  assert(replacer.size() == 0);
+}
+
+// Cache frames go by their K-th most recent access, not their latest: a
+// frame used long ago and again just now is older than one used twice in
+// between.
+void TestLruKDistance() {
+  std::optional<frame_id_t> victim;
+  LruKReplacer replacer(3, 2);
+  for (frame_id_t f : {0, 1, 1, 2, 2, 0}) {
+    replacer.RecordAccess(f);
+  }
+  for (frame_id_t f = 0; f < 3; ++f) {
+    replacer.SetEvictable(f, true);
+  }
+  victim = replacer.Evict();
+  assert(victim == frame_id_t{0});
+  victim = replacer.Evict();
+  assert(victim == frame_id_t{1});
+  victim = replacer.Evict();
+  assert(victim == frame_id_t{2});
+}
+
+// A refusal is not an access: a frame seen once and then refused, as a
+// pinned or recently hit scan page is, still goes before any cache frame.
+// Refusals in the history set do not keep cache frames from being offered.
+void TestLruKRefusal() {
+  std::optional<frame_id_t> victim;
+  LruKReplacer replacer(3, 2);
+  for (frame_id_t f : {0, 1, 1, 2, 2}) {
+    replacer.RecordAccess(f);
+  }
+  for (frame_id_t f = 0; f < 3; ++f) {
+    replacer.SetEvictable(f, true);
+  }
+  victim = replacer.Evict([](frame_id_t f) { return f != 0; });
+  assert(victim == frame_id_t{1});
+  victim = replacer.Evict();
+  assert(victim == frame_id_t{0});
+  victim = replacer.Evict();
+  assert(victim == frame_id_t{2});
+}
+
+// The buffer pool refuses candidates that are pinned or were hit since the
+// last sweep; refused frames stay evictable and count as accessed.
+void TestEvictFilter() {
+  for (auto policy : {ReplacerPolicy::kClock, ReplacerPolicy::kLruK}) {
+    auto replacer = MakeReplacer(policy, 3);
+    for (frame_id_t f = 0; f < 3; ++f) {
+      replacer->RecordAccess(f);
+      replacer->SetEvictable(f, true);
+    }
+
+    auto victim = replacer->Evict([](frame_id_t f) { return f == 1; });
+    assert(victim == frame_id_t{1});
+    assert(replacer->size() == 2);
+
+    // Nothing acceptable: gives up instead of spinning.
+    victim = replacer->Evict([](frame_id_t) { return false; });
+    assert(!victim.has_value());
+    assert(replacer->size() == 2);
+  }
+}
+
+std::vector<frame_id_t> Candidates(const Replacer& replacer) {
+  std::vector<frame_id_t> order;
+  replacer.ForEachCandidate([&order](frame_id_t f) {
+    order.push_back(f);
+    return true;
+  });
+  return order;
+}
+
+// Candidate order matches what Evict would pick, without changing it.
+void TestCandidates() {
+  std::optional<frame_id_t> victim;
+  ClockReplacer clock(4);
+  for (frame_id_t f = 0; f < 4; ++f) {
+    clock.SetEvictable(f, true);
+  }
+  clock.RecordAccess(1);
+  assert((Candidates(clock) == std::vector<frame_id_t>{0, 2, 3, 1}));
+  victim = clock.Evict();
+  assert(victim == frame_id_t{0});
+
+  LruKReplacer lru_k(4, 2);
+  for (frame_id_t f = 0; f < 4; ++f) {
+    lru_k.RecordAccess(f);
+  }
+  lru_k.RecordAccess(0);
+  for (frame_id_t f = 0; f < 4; ++f) {
+    lru_k.SetEvictable(f, true);
+  }
+  assert((Candidates(lru_k) == std::vector<frame_id_t>{1, 2, 3, 0}));
+
+  // Stops early when asked to.
+  size_t seen = 0;
+  lru_k.ForEachCandidate([&seen](frame_id_t) { return ++seen < 2; });
+  assert(seen == 2);
+  victim = lru_k.Evict();
+  assert(victim == frame_id_t{1});
+}
+
+}  // namespace
+
+int main() {
+  TestClock();
+  TestLruK();
+  TestLruKDistance();
+  TestLruKRefusal();
+  TestEvictFilter();
+  TestCandidates();
+
+  std::cout << "replacer_test: success\n";
+  return 0;
+}
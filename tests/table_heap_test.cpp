@@ -0,0 +1,351 @@
+#include <algorithm>
+#include <cassert>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "simpledb/buffer_pool_manager.h"
+#include "simpledb/disk_manager.h"
+#include "simpledb/table_heap.h"
+
+namespace {
+
+using namespace simpledb;
+
+std::vector<std::byte> Record(std::size_t index, std::size_t size) {
+  std::vector<std::byte> record(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    record[i] = static_cast<std::byte>(index * 31 + i);
+  }
+  return record;
+}
+
+struct RecordIdLess {
+  bool operator()(const RecordId& a, const RecordId& b) const {
+    return a.page_id != b.page_id ? a.page_id < b.page_id : a.slot < b.slot;
+  }
+};
+
+using Model = std::map<RecordId, std::vector<std::byte>, RecordIdLess>;
+
+// A scan visits every live record once, and nothing else.
+void CheckScan(TableHeap& heap, const Model& model) {
+  Status status;
+  auto it_res = heap.Begin();
+  assert(it_res.ok());
+  TableHeap::Iterator it = std::move(it_res).value();
+  std::size_t seen = 0;
+  while (it.Valid()) {
+    const auto found = model.find(it.record_id());
+    assert(found != model.end());
+    std::vector<std::byte> data(it.record_size());
+    assert(it.Read(data).ok() && data == found->second);
+    ++seen;
+    status = it.Next();
+    assert(status.ok());
+  }
+  assert(seen == model.size());
+  status = it.Next();
+  assert(status.code() == StatusCode::kInvalidArgument);
+}
+
+// Records past kMaxInlineSize go to overflow pages, and come back whole
+// through Get, Read and the iterator; a pool smaller than one record's
+// pages still reads it.
+void TestOverflow(const std::filesystem::path& path) {
+  Status status;
+  std::filesystem::remove(path);
+  DiskManager disk_manager;
+  status = disk_manager.Open(path);
+  assert(status.ok());
+  BufferPoolManager pool(8, &disk_manager);
+  TableHeap heap(&pool);
+  status = heap.Create();
+  assert(status.ok());
+
+  Model model;
+  const std::size_t sizes[] = {TableHeap::kMaxInlineSize,
+                               TableHeap::kMaxInlineSize + 1, 5000,
+                               TableHeap::kOverflowPrefixSize +
+                                   2 * kOverflowPageCapacity,
+                               100000, 300};
+  for (std::size_t i = 0; i < std::size(sizes); ++i) {
+    const auto record = Record(i, sizes[i]);
+    auto rid = heap.Insert(record);
+    assert(rid.ok());
+    model[rid.value()] = record;
+  }
+  // Six records, one of them about 25 overflow pages, on one heap page.
+  assert(heap.page_count() == 1);
+  const std::size_t file_pages = disk_manager.page_count();
+  CheckScan(heap, model);
+
+  for (const auto& [rid, record] : model) {
+    auto got = heap.Get(rid);
+    assert(got.ok() && got.value() == record);
+    assert(heap.RecordSize(rid).value() == record.size());
+    std::vector<std::byte> out(record.size() + 7);
+    assert(heap.Read(rid, out).value() == record.size());
+    assert(std::equal(record.begin(), record.end(), out.begin()));
+    if (!record.empty()) {
+      out.resize(record.size() - 1);
+      status = heap.Read(rid, out).status();
+      assert(status.code() == StatusCode::kInvalidArgument);
+    }
+  }
+
+  // The iterator shows the prefix in place and reads the rest on request.
+  {
+    auto it_res = heap.Begin();
+    assert(it_res.ok());
+    std::size_t overflow = 0;
+    for (auto it = std::move(it_res).value(); it.Valid();) {
+      const auto& record = model.at(it.record_id());
+      assert(it.record_size() == record.size());
+      const RecordView view = it.record();
+      assert(view.overflow == (record.size() > TableHeap::kMaxInlineSize));
+      if (view.overflow) {
+        ++overflow;
+        assert(view.data.size() == TableHeap::kOverflowPrefixSize);
+      }
+      assert(std::equal(view.data.begin(), view.data.end(), record.begin()));
+      std::vector<std::byte> out(it.record_size());
+      assert(it.Read(out).ok() && out == record);
+      status = it.Next();
+      assert(status.ok());
+    }
+    assert(overflow == 4);
+  }
+
+  // Updates move records into and out of overflow pages; freed pages are
+  // reused, so the file stops growing.
+  const RecordId big = model.rbegin()->first;
+  for (int round = 0; round < 3; ++round) {
+    for (auto& [rid, record] : model) {
+      record = Record(rid.slot + round,
+                      record.size() > TableHeap::kMaxInlineSize ? 100
+                                                                : 20000);
+      status = heap.Update(rid, record);
+      assert(status.ok());
+    }
+    CheckScan(heap, model);
+  }
+  assert(disk_manager.page_count() <= file_pages + 16);
+  status = heap.Delete(big);
+  assert(status.ok());
+  model.erase(big);
+  status = heap.Get(big).status();
+  assert(status.code() == StatusCode::kNotFound);
+  CheckScan(heap, model);
+  std::filesystem::remove(path);
+}
+
+// Overflow pages a delete cannot free, here because a reader has one
+// pinned, are freed by a later delete rather than leaked.
+void TestDeferredOverflowFree(const std::filesystem::path& path) {
+  Status status;
+  std::filesystem::remove(path);
+  DiskManager disk_manager;
+  status = disk_manager.Open(path);
+  assert(status.ok());
+  BufferPoolManager pool(8, &disk_manager);
+  TableHeap heap(&pool);
+  status = heap.Create();
+  assert(status.ok());
+
+  // Page 0 is the heap; the record's chain is pages 1-3.
+  auto rid = heap.Insert(
+      Record(0, TableHeap::kOverflowPrefixSize + 3 * kOverflowPageCapacity));
+  assert(rid.ok());
+  assert(disk_manager.page_count() == 4);
+  {
+    auto pinned = pool.FetchPageRead(2);
+    assert(pinned.ok());
+    status = heap.Delete(rid.value());
+    assert(status.ok());
+  }
+
+  // One overflow page each: pages 1 and 3 are free, page 2 is not yet.
+  const std::size_t one_page = TableHeap::kMaxInlineSize + 1;
+  std::vector<RecordId> rids;
+  for (std::size_t i = 0; i < 3; ++i) {
+    rid = heap.Insert(Record(i, one_page));
+    assert(rid.ok());
+    rids.push_back(rid.value());
+  }
+  assert(disk_manager.page_count() == 5);
+
+  // The next delete frees page 2 along with its own page.
+  status = heap.Delete(rids[0]);
+  assert(status.ok());
+  for (std::size_t i = 0; i < 2; ++i) {
+    status = heap.Insert(Record(i, one_page)).status();
+    assert(status.ok());
+  }
+  assert(disk_manager.page_count() == 5);
+  std::filesystem::remove(path);
+}
+
+// A page appended for an insert is freed again if it cannot be chained
+// on, here because the last page cannot get a frame.
+void TestAppendFailure(const std::filesystem::path& path) {
+  Status status;
+  std::filesystem::remove(path);
+  DiskManager disk_manager;
+  status = disk_manager.Open(path);
+  assert(status.ok());
+  BufferPoolOptions options;
+  options.page_cleaner = false;
+  BufferPoolManager pool(2, &disk_manager, options);
+  TableHeap heap(&pool);
+  status = heap.Create();
+  assert(status.ok());
+
+  // One record of kMaxInlineSize fills a page.
+  const auto record = Record(0, TableHeap::kMaxInlineSize);
+  while (heap.page_count() < 2) {
+    status = heap.Insert(record).status();
+    assert(status.ok());
+  }
+  const std::size_t file_pages = disk_manager.page_count();
+  {
+    auto pinned = pool.FetchPageRead(heap.first_page_id());
+    assert(pinned.ok());
+    status = heap.Insert(record).status();
+    assert(!status.ok());
+  }
+  status = heap.Insert(record).status();
+  assert(status.ok());
+  assert(heap.page_count() == 3);
+  assert(disk_manager.page_count() == file_pages + 1);
+  std::filesystem::remove(path);
+}
+
+}  // namespace
+
+int main() {
+  Status status;
+  namespace fs = std::filesystem;
+  const fs::path path = fs::temp_directory_path() / "simpledb_table_heap_test.db";
+  TestOverflow(path);
+  TestDeferredOverflowFree(path);
+  TestAppendFailure(path);
+  fs::remove(path);
+
+  Model model;
+  PageId first_page_id = kInvalidPageId;
+  std::size_t pages = 0;
+  {
+    DiskManager disk_manager;
+    status = disk_manager.Open(path);
+    assert(status.ok());
+    BufferPoolManager pool(8, &disk_manager);
+    TableHeap heap(&pool);
+    status = heap.Insert(Record(0, 10)).status();
+    assert(status.code() == StatusCode::kInvalidArgument);
+    status = heap.Create();
+    assert(status.ok());
+    first_page_id = heap.first_page_id();
+    CheckScan(heap, model);
+
+    for (std::size_t i = 0; i < 2000; ++i) {
+      const auto record = Record(i, 20 + i % 200);
+      auto rid = heap.Insert(record);
+      assert(rid.ok());
+      model[rid.value()] = record;
+    }
+    pages = heap.page_count();
+    assert(pages > 8);
+    CheckScan(heap, model);
+
+    // Space freed anywhere in the heap is found again by inserts: deleting
+    // every other record makes room for as many again without new pages.
+    std::vector<RecordId> deleted;
+    bool odd = false;
+    for (const auto& [rid, record] : model) {
+      if ((odd = !odd)) {
+        deleted.push_back(rid);
+      }
+    }
+    for (const auto& rid : deleted) {
+      status = heap.Delete(rid);
+      assert(status.ok());
+      model.erase(rid);
+    }
+    status = heap.Delete(deleted[0]);
+    assert(status.code() == StatusCode::kNotFound);
+    status = heap.Get(deleted[0]).status();
+    assert(status.code() == StatusCode::kNotFound);
+    CheckScan(heap, model);
+    for (std::size_t i = 0; i < deleted.size(); ++i) {
+      const auto record = Record(5000 + i, 20);
+      auto rid = heap.Insert(record);
+      assert(rid.ok());
+      assert(model.count(rid.value()) == 0);
+      model[rid.value()] = record;
+    }
+    assert(heap.page_count() == pages);
+
+    // Updates keep the record id.
+    const RecordId target = model.begin()->first;
+    const auto updated = Record(9, 300);
+    status = heap.Update(target, updated);
+    assert(status.ok());
+    model[target] = updated;
+    auto fetched = heap.Get(target);
+    assert(fetched.ok() && fetched.value() == updated);
+    status = heap.Get(RecordId{first_page_id + 1000, 0}).status();
+    assert(status.code() == StatusCode::kNotFound);
+
+    // Concurrent inserts land on distinct ids.
+    std::vector<std::vector<RecordId>> inserted(4);
+    std::vector<std::thread> inserters;
+    for (std::size_t t = 0; t < inserted.size(); ++t) {
+      inserters.emplace_back([&heap, &inserted, t] {
+        for (std::size_t i = 0; i < 300; ++i) {
+          auto rid = heap.Insert(Record(t * 1000 + i, 50));
+          assert(rid.ok());
+          inserted[t].push_back(rid.value());
+        }
+      });
+    }
+    for (auto& inserter : inserters) {
+      inserter.join();
+    }
+    for (std::size_t t = 0; t < inserted.size(); ++t) {
+      for (std::size_t i = 0; i < inserted[t].size(); ++i) {
+        assert(model.count(inserted[t][i]) == 0);
+        model[inserted[t][i]] = Record(t * 1000 + i, 50);
+      }
+    }
+    CheckScan(heap, model);
+    pages = heap.page_count();
+    status = pool.FlushAllPages();
+    assert(status.ok());
+  }
+
+  // Reopening walks the chain and rebuilds the free-space map.
+  {
+    DiskManager disk_manager;
+    status = disk_manager.Open(path);
+    assert(status.ok());
+    BufferPoolManager pool(4, &disk_manager);
+    TableHeap heap(&pool);
+    status = heap.Open(first_page_id);
+    assert(status.ok());
+    assert(heap.page_count() == pages);
+    CheckScan(heap, model);
+    auto rid = heap.Insert(Record(1, 20));
+    assert(rid.ok());
+    assert(heap.page_count() == pages);
+  }
+
+  std::cout << "table_heap_test: " << model.size() << " records on " << pages
+            << " pages\n";
+  std::cout << "table_heap_test: success\n";
+  fs::remove(path);
+  return 0;
+}